@@ -23,6 +23,17 @@
 #include "fire.h"
 #include "ambulance.h"
 #include "corona.h"
+#include "stack_monitor.h"
+#include "heap_tracker.h"
+#include "profiler.h"
+#include "checkpoint.h"
+#include "scenario.h"
+#include "console.h"
+#include "telemetry.h"
+#include "benchmark.h"
+#include "rebalancer.h"
+#include "priority_controller.h"
+#include "timer_wheel.h"
 
 #include "logger.h"
 
@@ -31,12 +42,91 @@
 /// @brief Main function initializes.
 int CitySim_main(void)
 {
-	initVehicleManagement();
-	initPolice();
+#if PROFILER_ENABLED
+    profilerInit();
+#endif
+
+    // Scenario first: fleets, priorities and stack sizes of everything below come from it
+#if defined(STM32F746xx)
+    scenarioLoad(SCENARIO_TEXT);
+#else
+    const char *scenarioPath = getenv("CITYSIM_SCENARIO");
+    if (scenarioPath == NULL || !scenarioLoadFile(scenarioPath)) {
+        scenarioLoadDefaults();
+    }
+#endif
+    scenarioReport();
+
+    // Each subsystem's heap allocations are charged to its own tag
+    heapTrackerSetTag(HEAP_TAG_LOGGER);
+    initLogger();
+#if BENCHMARK_ENABLED
+    // Benchmark build: only the allocation and logging paths, no simulation tasks
+    heapTrackerSetTag(HEAP_TAG_DIAGNOSTICS);
+    initBenchmark();
+    heapTrackerSetTag(HEAP_TAG_SYSTEM);
+    vTaskStartScheduler();
+    while (1) {
+        // Should never reach here
+    }
+#endif
+    heapTrackerSetTag(HEAP_TAG_VEHICLE);
+    initVehicleManagement();
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_TASKS
+    // In the other modes incidents run on the dispatcher's incident pool instead
+    heapTrackerSetTag(HEAP_TAG_POLICE);
+    initPolice();
+    heapTrackerSetTag(HEAP_TAG_FIRE);
     initFire();
+    heapTrackerSetTag(HEAP_TAG_AMBULANCE);
     initAmbulance();
+    heapTrackerSetTag(HEAP_TAG_CORONA);
     initCorona();
+#endif
+    heapTrackerSetTag(HEAP_TAG_DISPATCHER);
+#if TIMER_WHEEL_ENABLED
+    initTimerWheel();
+#endif
     initDispatcher();
+#if REBALANCER_ENABLED
+    initRebalancer();
+#endif
+#if PRIORITY_CONTROLLER_ENABLED
+    initPriorityController();
+#endif
+#if STACK_MONITOR_ENABLED
+    heapTrackerSetTag(HEAP_TAG_DIAGNOSTICS);
+    initStackMonitor();
+#endif
+#if CONSOLE_ENABLED
+    heapTrackerSetTag(HEAP_TAG_DIAGNOSTICS);
+    initConsole();
+#endif
+#if TELEMETRY_ENABLED
+    heapTrackerSetTag(HEAP_TAG_DIAGNOSTICS);
+    initTelemetry();
+#endif
+    heapTrackerSetTag(HEAP_TAG_SYSTEM);
+
+#if CHECKPOINT_ENABLED
+    initCheckpoint();
+#if defined(STM32F746xx)
+    bool restore = CHECKPOINT_RESTORE_AT_STARTUP != 0;
+#else
+    // A run forked from a state saved by "checkpoint export"
+    const char *checkpointPath = getenv("CITYSIM_CHECKPOINT");
+    bool restore = (checkpointPath != NULL) ? checkpointImportFile(checkpointPath)
+                                            : CHECKPOINT_RESTORE_AT_STARTUP != 0;
+    if (checkpointPath != NULL && !restore) {
+        logMessage("Cannot load checkpoint %s, starting cold\r\n", checkpointPath);
+    }
+#endif
+    if (restore) {
+        checkpointRestore();
+    } else {
+        checkpointDiscard();
+    }
+#endif
 
     vTaskStartScheduler();
     while (1) {
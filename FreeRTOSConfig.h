@@ -50,6 +50,7 @@
 /* Ensure definitions are only used by the compiler, and not by the assembler. */
 #if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
   #include <stdint.h>
+  #include "project_defines.h"
   extern uint32_t SystemCoreClock;
   void xPortSysTickHandler(void);
 #endif
@@ -65,7 +66,8 @@
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
 #define configMAX_PRIORITIES                     ( 56 )
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
-#define configTOTAL_HEAP_SIZE                    ((size_t)15360)
+/* 20 KB with the four original departments; see project_defines.h */
+#define configTOTAL_HEAP_SIZE                    ((size_t)(FIXED_HEAP_BYTES + NUM_DEPARTMENTS * SHARD_HEAP_BYTES + SCALED_TASKS_HEAP_BYTES))
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_TRACE_FACILITY                 1
 #define configUSE_16_BIT_TICKS                   0
@@ -87,7 +89,7 @@
 /* Software timer definitions. */
 #define configUSE_TIMERS                         1
 #define configTIMER_TASK_PRIORITY                ( 2 )
-#define configTIMER_QUEUE_LENGTH                 10
+#define configTIMER_QUEUE_LENGTH                 24
 #define configTIMER_TASK_STACK_DEPTH             256
 
 /* Set the following definitions to 1 to include the API function, or zero
@@ -154,6 +156,29 @@ standard names. */
 
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+/* Per-subsystem heap accounting, implemented in heap_tracker.c */
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+  #include <stddef.h>
+  void heapTrackerOnMalloc(void *address, size_t size);
+  void heapTrackerOnFree(void *address, size_t size);
+#endif
+#define traceMALLOC( pvAddress, uiSize )  heapTrackerOnMalloc( ( pvAddress ), ( uiSize ) )
+#define traceFREE( pvAddress, uiSize )    heapTrackerOnFree( ( pvAddress ), ( uiSize ) )
+
+/* Profiler slots are released when their task is deleted (profiler.c) */
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+  void profilerTaskDeleted(void *task);
+#endif
+#define traceTASK_DELETE( pxTaskToDelete )  profilerTaskDeleted( ( pxTaskToDelete ) )
+
+/* Run-time statistics on the DWT cycle counter (profiler.c), used for the CPU load in telemetry */
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+  void profilerStartClock(void);
+  uint32_t profilerRunTimeCounter(void);
+#endif
+#define configGENERATE_RUN_TIME_STATS              1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()   profilerStartClock()
+#define portGET_RUN_TIME_COUNTER_VALUE()           profilerRunTimeCounter()
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
@@ -13,6 +13,8 @@
 #include "dispatcher.h"
 #include "logger.h"
 #include "project_defines.h"
+#include "scenario.h"
+#include "vehicle_management.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
@@ -34,7 +36,8 @@ void initAmbulance(void) {
         return;
     }
 
-    if (xTaskCreate(ambulanceTask, "AmbulanceTask", AMBULANCE_STACK_SIZE, NULL, AMBULANCE_TASK_PRIORITY, NULL) == pdPASS) {
+    if (xTaskCreate(ambulanceTask, "AmbulanceTask", scenarioDepartment(AMBULANCE)->stackWords, NULL,
+                    scenarioDepartment(AMBULANCE)->priority, NULL) == pdPASS) {
         logMessage("Ambulance task created successfully\r\n");
     } else {
         logMessage("Failed to create Ambulance task\r\n");
@@ -53,7 +56,7 @@ void ambulanceTask(void *params) {
     while (1) {
         if (xSemaphoreTake(ambulanceSemaphore, portMAX_DELAY) == pdTRUE) {
             // Simulate event handling
-            vTaskDelay(Short_DELAY);
+            vTaskDelay(getIncidentHandlingTime(AMBULANCE));
 
             // Signal completion
             xSemaphoreGive(ambulanceCompletionSemaphore);
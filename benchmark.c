@@ -0,0 +1,471 @@
+/**
+ * @file benchmark.c
+ * @brief Microbenchmarks for the vehicle allocation and logging hot paths.
+ *
+ * Built instead of the simulation when BENCHMARK_ENABLED is 1. Each operation
+ * (getVehicleCount, borrowVehicles, reallocateVehicles,
+ * checkAndAllocateVehicles, logMessage) runs in isolation, first in one task
+ * and then in 2..BENCHMARK_MAX_CONTENDERS equal-priority tasks running it
+ * concurrently. Per contention level the report gives the wall time per
+ * operation (ns/op) and the aggregate throughput (ops/s).
+ *
+ * Log output of the vehicle and dispatcher modules is switched off while the
+ * allocation paths run, so they are measured without the UART.
+ *
+ * A second sweep schedules and then cancels 100..BENCHMARK_TIMER_COUNT
+ * long-running timeouts, once as FreeRTOS software timers and once on the
+ * timing wheel, and reports the cost per operation at each scale. FreeRTOS
+ * applies timer commands in its timer task, so those figures include waiting
+ * for the command queue to drain.
+ *
+ * A scaling run then gives the fleet BENCHMARK_SCALE_FLEET vehicles in each of
+ * the NUM_DEPARTMENTS departments. It times largest-idle donor selection,
+ * which keeps the donors in a heap, against a linear scan for the largest
+ * donor, for requests that drain more and more donors; then every policy on
+ * the largest request; then allocations across the whole fleet. Building with
+ * a larger NUM_DEPARTMENTS shows how these grow with the number of departments.
+ *
+ * With INCIDENT_HANDLER_PROTOTHREADS a last run measures how many concurrent
+ * incidents fit in the free heap: first as blocking handler tasks with their
+ * own stacks, then as protothread records run by the incident worker.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "benchmark.h"
+#include "dispatcher.h"
+#include "vehicle_management.h"
+#include "profiler.h"
+#include "logger.h"
+#include "reallocation_policy.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "timers.h"
+#include "timer_wheel.h"
+#include "incident.h"
+#include <string.h>
+
+typedef void (*BenchmarkOperation)(int worker, uint32_t iteration);
+
+/**
+ * @brief One benchmarked operation.
+ */
+typedef struct {
+    const char *name;                /**< Name in the report */
+    BenchmarkOperation operation;    /**< Runs one iteration */
+    uint32_t iterations;             /**< Iterations per contending task */
+    bool quiet;                      /**< Mute the allocation modules while it runs */
+} Benchmark;
+
+static SemaphoreHandle_t workerDone = NULL;    /**< Given by each worker when it finishes */
+static const Benchmark *currentBenchmark;      /**< Benchmark run by the workers */
+static int borrowCounts[2 * BENCHMARK_MAX_CONTENDERS]; /**< Private vehicle counters for borrowVehicles */
+
+#if BENCHMARK_ENABLED
+static StaticTimer_t benchmarkTimerBuffers[BENCHMARK_TIMER_COUNT];   /**< Storage of the FreeRTOS timers */
+static TimerHandle_t benchmarkTimers[BENCHMARK_TIMER_COUNT];         /**< FreeRTOS timers under test */
+static TimerWheelEntry benchmarkWheelEntries[BENCHMARK_TIMER_COUNT]; /**< Timing wheel entries under test */
+static SemaphoreHandle_t timerQueueDrained = NULL;                   /**< Given from the timer task */
+#endif
+
+#if BENCHMARK_ENABLED && INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+static void *capacityItems[BENCHMARK_CAPACITY_MAX]; /**< Handler tasks or incident records under test */
+static TaskHandle_t capacityTask = NULL;            /**< Notified for every finished incident */
+#endif
+
+static void runGetVehicleCount(int worker, uint32_t iteration) {
+    (void)getVehicleCount((uint8_t)(iteration % NUM_DEPARTMENTS));
+}
+
+static void runBorrowVehicles(int worker, uint32_t iteration) {
+    // Each worker moves one vehicle back and forth between its own two counters
+    int *from = &borrowCounts[worker * 2 + (int)(iteration & 1U)];
+    int *to = &borrowCounts[worker * 2 + 1 - (int)(iteration & 1U)];
+    if (*from == 0) {
+        *from = 1;
+    }
+    (void)borrowVehicles(from, to, 1, 0, 1);
+}
+
+static void runReallocateVehicles(int worker, uint32_t iteration) {
+    // Rotating the requesting department keeps vehicles circulating
+    DispatchRequest request = {.department = (uint8_t)(iteration % NUM_DEPARTMENTS), .requiredVehicles = 1};
+    reallocateVehicles(request);
+}
+
+static void runCheckAndAllocateVehicles(int worker, uint32_t iteration) {
+    (void)checkAndAllocateVehicles((uint8_t)(iteration % NUM_DEPARTMENTS), 1, SEVERITY_LOW);
+}
+
+static void runLogMessage(int worker, uint32_t iteration) {
+    logMessage("bench %lu\r\n", (unsigned long)iteration);
+}
+
+static const Benchmark benchmarks[] = {
+    {"getVehicleCount",          runGetVehicleCount,          BENCHMARK_ITERATIONS, true},
+    {"borrowVehicles",           runBorrowVehicles,           BENCHMARK_ITERATIONS, true},
+    {"reallocateVehicles",       runReallocateVehicles,       BENCHMARK_ITERATIONS, true},
+    {"checkAndAllocateVehicles", runCheckAndAllocateVehicles, BENCHMARK_ITERATIONS, true},
+    {"logMessage",               runLogMessage,               BENCHMARK_LOG_ITERATIONS, false},
+};
+
+/**
+ * @brief Worker task: runs the current benchmark, reports completion and exits.
+ *
+ * @param params The worker's index, 0..BENCHMARK_MAX_CONTENDERS-1.
+ */
+static void benchmarkWorker(void *params) {
+    const Benchmark *benchmark = currentBenchmark;
+    int worker = (int)(uintptr_t)params;
+    for (uint32_t i = 0; i < benchmark->iterations; i++) {
+        benchmark->operation(worker, i);
+    }
+    xSemaphoreGive(workerDone);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Runs one benchmark with a given number of contending tasks.
+ *
+ * @param benchmark The benchmark.
+ * @param contenders Number of tasks running it concurrently.
+ */
+static void runBenchmark(const Benchmark *benchmark, int contenders) {
+    int started = 0;
+
+    currentBenchmark = benchmark;
+    for (int i = 0; i < contenders; i++) {
+        if (xTaskCreate(benchmarkWorker, "BenchWorker", BENCHMARK_STACK_SIZE, (void *)(uintptr_t)started,
+                        BENCHMARK_WORKER_PRIORITY, NULL) == pdPASS) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        logMessage("  %-24s %d tasks: could not create workers\r\n", benchmark->name, contenders);
+        return;
+    }
+
+    // Workers have a lower priority, so they only start once this task blocks
+    uint32_t start = profilerNow();
+    for (int i = 0; i < started; i++) {
+        xSemaphoreTake(workerDone, portMAX_DELAY);
+    }
+    uint64_t elapsedNs = profilerToNs(profilerNow() - start);
+
+    uint64_t operations = (uint64_t)benchmark->iterations * (uint64_t)started;
+    uint64_t nsPerOp = elapsedNs / operations;
+    uint64_t opsPerSecond = (elapsedNs > 0) ? (operations * 1000000000ULL) / elapsedNs : 0;
+    logMessage("  %-24s %d tasks: %lu ns/op, %lu ops/s\r\n", benchmark->name, started,
+               (unsigned long)nsPerOp, (unsigned long)opsPerSecond);
+
+    vTaskDelay(1); // Let the idle task free the deleted workers
+}
+
+#if BENCHMARK_ENABLED
+static void benchmarkTimerCallback(TimerHandle_t timer) {
+}
+
+static void benchmarkWheelCallback(TimerWheelEntry *entry) {
+}
+
+static void signalTimerQueueDrained(void *context, uint32_t value) {
+    xSemaphoreGive(timerQueueDrained);
+}
+
+/**
+ * @brief Waits until the timer task has applied every command sent so far.
+ */
+static void waitTimerQueueDrained(void) {
+    xTimerPendFunctionCall(signalTimerQueueDrained, NULL, 0, portMAX_DELAY);
+    xSemaphoreTake(timerQueueDrained, portMAX_DELAY);
+}
+
+/**
+ * @brief Gets a distinct, long delay for timeout i, so none expires during the run.
+ */
+static TickType_t benchmarkDelay(int i) {
+    return pdMS_TO_TICKS(60000) + (TickType_t)(((uint32_t)i * 7919U) % 100000U);
+}
+
+/**
+ * @brief Schedules and cancels a number of timeouts with both timer services.
+ *
+ * @param count Number of concurrent timeouts.
+ */
+static void runTimerBenchmark(int count) {
+    uint32_t start = profilerNow();
+    for (int i = 0; i < count; i++) {
+        xTimerChangePeriod(benchmarkTimers[i], benchmarkDelay(i), portMAX_DELAY);
+    }
+    waitTimerQueueDrained();
+    uint64_t rtosInsertNs = profilerToNs(profilerNow() - start);
+
+    start = profilerNow();
+    for (int i = 0; i < count; i++) {
+        xTimerStop(benchmarkTimers[i], portMAX_DELAY);
+    }
+    waitTimerQueueDrained();
+    uint64_t rtosCancelNs = profilerToNs(profilerNow() - start);
+
+    start = profilerNow();
+    for (int i = 0; i < count; i++) {
+        timerWheelSchedule(&benchmarkWheelEntries[i], benchmarkDelay(i));
+    }
+    uint64_t wheelInsertNs = profilerToNs(profilerNow() - start);
+
+    start = profilerNow();
+    for (int i = 0; i < count; i++) {
+        timerWheelCancel(&benchmarkWheelEntries[i]);
+    }
+    uint64_t wheelCancelNs = profilerToNs(profilerNow() - start);
+
+    logMessage("  %5d timeouts: xTimer insert %lu cancel %lu ns/op | wheel insert %lu cancel %lu ns/op\r\n", count,
+               (unsigned long)(rtosInsertNs / (uint64_t)count), (unsigned long)(rtosCancelNs / (uint64_t)count),
+               (unsigned long)(wheelInsertNs / (uint64_t)count), (unsigned long)(wheelCancelNs / (uint64_t)count));
+}
+
+/**
+ * @brief Sweeps the timer benchmark over growing numbers of timeouts.
+ */
+static void runTimerBenchmarks(void) {
+    timerQueueDrained = xSemaphoreCreateBinary();
+    for (int i = 0; i < BENCHMARK_TIMER_COUNT; i++) {
+        benchmarkTimers[i] = xTimerCreateStatic("Bench", 1, pdFALSE, NULL, benchmarkTimerCallback,
+                                                &benchmarkTimerBuffers[i]);
+        timerWheelEntryInit(&benchmarkWheelEntries[i], benchmarkWheelCallback, NULL);
+    }
+    if (timerQueueDrained == NULL) {
+        logMessage("Failed to create timer benchmark semaphore\r\n");
+        return;
+    }
+
+    logMessage("Timer benchmark: schedule then cancel N timeouts\r\n");
+    for (int count = 100; count <= BENCHMARK_TIMER_COUNT; count *= 2) {
+        runTimerBenchmark(count);
+    }
+}
+#endif
+
+#if BENCHMARK_ENABLED
+static int scaleIdle[NUM_DEPARTMENTS];           /**< Idle vehicles per department in the scaling run */
+static int scaleTake[NUM_DEPARTMENTS];           /**< Plan of the last donor selection */
+static ReallocationHistory scaleHistory;         /**< Lending history for the policies */
+
+/**
+ * @brief Largest-idle donor selection by a linear scan per donor.
+ *
+ * The reference the heap in the largest-idle policy is measured against.
+ *
+ * @param department The department that needs vehicles.
+ * @param needed Vehicles it needs.
+ * @param idle Vehicles each department can lend.
+ * @param take Receives the vehicles to take from each department.
+ */
+static void linearLargestIdle(uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                              int take[NUM_DEPARTMENTS]) {
+    memset(take, 0, NUM_DEPARTMENTS * sizeof(take[0]));
+    while (needed > 0) {
+        int donor = -1;
+        for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+            if (d != department && take[d] == 0 && idle[d] > 0 && (donor < 0 || idle[d] > idle[donor])) {
+                donor = d;
+            }
+        }
+        if (donor < 0) {
+            return;
+        }
+        take[donor] = (idle[donor] < needed) ? idle[donor] : needed;
+        needed -= take[donor];
+    }
+}
+
+/**
+ * @brief Times one policy on a request of a given size.
+ *
+ * @param id The policy; REALLOCATION_POLICY_COUNT times the linear scan instead.
+ * @param needed Vehicles requested.
+ * @return Nanoseconds per plan.
+ */
+static uint32_t timeDonorSelection(ReallocationPolicyId id, int needed) {
+    uint32_t start = profilerNow();
+    for (uint32_t i = 0; i < BENCHMARK_SCALE_ITERATIONS; i++) {
+        uint8_t department = (uint8_t)(i % NUM_DEPARTMENTS);
+        if (id == REALLOCATION_POLICY_COUNT) {
+            linearLargestIdle(department, needed, scaleIdle, scaleTake);
+        } else {
+            (void)planReallocation(id, department, needed, scaleIdle, &scaleHistory, scaleTake);
+        }
+    }
+    return (uint32_t)(profilerToNs(profilerNow() - start) / BENCHMARK_SCALE_ITERATIONS);
+}
+
+/**
+ * @brief Times donor selection and allocation with NUM_DEPARTMENTS departments.
+ */
+static void runScalingBenchmark(void) {
+    static int saved[NUM_DEPARTMENTS];
+    static int fleet[NUM_DEPARTMENTS];
+    int needed = 0;
+
+    logMessage("Scaling benchmark: %d departments, %d vehicles\r\n", NUM_DEPARTMENTS,
+               NUM_DEPARTMENTS * BENCHMARK_SCALE_FLEET);
+    for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+        // Between half and all of the department's fleet idle, in no particular order
+        scaleIdle[d] = BENCHMARK_SCALE_FLEET / 2 + (int)(((uint32_t)d * 7919U) % (BENCHMARK_SCALE_FLEET / 2 + 1));
+    }
+
+    for (int donors = 1; donors < NUM_DEPARTMENTS; donors *= 2) {
+        needed = donors * BENCHMARK_SCALE_FLEET / 2;
+        uint32_t heapNs = timeDonorSelection(REALLOCATION_LARGEST_IDLE, needed);
+        uint32_t linearNs = timeDonorSelection(REALLOCATION_POLICY_COUNT, needed);
+        int used = 0;
+        for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+            used += (scaleTake[d] > 0) ? 1 : 0;
+        }
+        logMessage("  %5d vehicles from %3d donors: heap %lu ns/op, linear scan %lu ns/op\r\n", needed, used,
+                   (unsigned long)heapNs, (unsigned long)linearNs);
+    }
+    for (int id = 0; id < REALLOCATION_POLICY_COUNT; id++) {
+        logMessage("  %-24s %5d vehicles: %lu ns/op\r\n", getReallocationPolicy((ReallocationPolicyId)id)->name,
+                   needed, (unsigned long)timeDonorSelection((ReallocationPolicyId)id, needed));
+    }
+
+    getVehicleCounts(saved);
+    for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+        fleet[d] = BENCHMARK_SCALE_FLEET;
+    }
+    setVehicleCounts(fleet);
+    uint32_t granted = 0;
+    uint32_t start = profilerNow();
+    for (uint32_t i = 0; i < BENCHMARK_SCALE_ITERATIONS; i++) {
+        granted += checkAndAllocateVehicles((uint8_t)(i % NUM_DEPARTMENTS), 1 + (int)(i % 4), SEVERITY_LOW) ? 1 : 0;
+    }
+    uint64_t elapsedNs = profilerToNs(profilerNow() - start);
+    setVehicleCounts(saved);
+    logMessage("  %-24s %lu ns/op, %lu of %lu granted\r\n", "checkAndAllocateVehicles",
+               (unsigned long)(elapsedNs / BENCHMARK_SCALE_ITERATIONS), (unsigned long)granted,
+               (unsigned long)BENCHMARK_SCALE_ITERATIONS);
+}
+#endif
+
+#if BENCHMARK_ENABLED && INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+/**
+ * @brief Stand-in for a department task: waits for its incident to end, then exits.
+ *
+ * @param params Unused task parameters.
+ */
+static void capacityHandlerTask(void *params) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+static void capacityIncidentDone(const DispatchRequest *request) {
+    xTaskNotifyGive(capacityTask);
+}
+
+/**
+ * @brief Logs how many incidents fit in the heap and what each one costs.
+ */
+static void reportCapacity(const char *name, int count, size_t freeBefore) {
+    size_t perIncident = (count > 0) ? (freeBefore - xPortGetFreeHeapSize()) / (size_t)count : 0;
+    logMessage("  %-12s %4d concurrent incidents, %4u bytes each, %4u in 15 KB\r\n", name, count,
+               (unsigned)perIncident, (unsigned)((perIncident > 0) ? 15360U / perIncident : 0));
+}
+
+/**
+ * @brief Fills the free heap with concurrent incidents, as tasks and as protothreads.
+ */
+static void runCapacityBenchmark(void) {
+    int count = 0;
+    size_t freeBefore = xPortGetFreeHeapSize();
+
+    logMessage("Capacity benchmark: concurrent incidents until %u bytes of heap are left\r\n",
+               (unsigned)BENCHMARK_HEAP_RESERVE);
+    while (count < BENCHMARK_CAPACITY_MAX && xPortGetFreeHeapSize() > BENCHMARK_HEAP_RESERVE &&
+           xTaskCreate(capacityHandlerTask, "BenchHandler", BENCHMARK_STACK_SIZE, NULL, BENCHMARK_WORKER_PRIORITY,
+                       (TaskHandle_t *)&capacityItems[count]) == pdPASS) {
+        count++;
+    }
+    reportCapacity("tasks", count, freeBefore);
+    vTaskDelay(1); // Let the handlers block before they are released
+    for (int i = 0; i < count; i++) {
+        xTaskNotifyGive((TaskHandle_t)capacityItems[i]);
+    }
+    vTaskDelay(pdMS_TO_TICKS(10)); // Let the idle task free the deleted handlers
+
+    count = 0;
+    freeBefore = xPortGetFreeHeapSize();
+    capacityTask = xTaskGetCurrentTaskHandle();
+    while (count < BENCHMARK_CAPACITY_MAX && xPortGetFreeHeapSize() > BENCHMARK_HEAP_RESERVE &&
+           (capacityItems[count] = pvPortMalloc(incidentRecordSize())) != NULL) {
+        count++;
+    }
+    reportCapacity("protothreads", count, freeBefore);
+    for (int i = 0; i < count; i++) {
+        DispatchRequest request = {.department = (uint8_t)(i % NUM_DEPARTMENTS), .requiredVehicles = 1, .id = (uint16_t)i,
+                                   .arrivalTime = xTaskGetTickCount()};
+        incidentSubmit(capacityItems[i], &request, pdMS_TO_TICKS(1000), capacityIncidentDone);
+    }
+    for (int i = 0; i < count; i++) {
+        ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+    }
+    for (int i = 0; i < count; i++) {
+        vPortFree(capacityItems[i]);
+    }
+}
+#endif
+
+/**
+ * @brief Initializes the subsystems under test and the benchmark task.
+ */
+void initBenchmark(void) {
+    initVehicleManagement();
+    initDispatcherResources();
+    workerDone = xSemaphoreCreateCounting(BENCHMARK_MAX_CONTENDERS, 0);
+
+    if (workerDone == NULL || xTaskCreate(benchmarkTask, "Benchmark", BENCHMARK_STACK_SIZE, NULL,
+                                          BENCHMARK_WORKER_PRIORITY + 1, NULL) != pdPASS) {
+        logMessage("Failed to create benchmark task\r\n");
+    }
+}
+
+/**
+ * @brief Benchmark task: sweeps every benchmark over 1..N contending tasks.
+ *
+ * @param params Unused task parameters.
+ */
+void benchmarkTask(void *params) {
+    uint8_t dispatcherLevel = logGetLevel(LOG_MODULE_DISPATCHER);
+    uint8_t vehicleLevel = logGetLevel(LOG_MODULE_VEHICLE);
+
+    logMessage("Benchmark: %d iterations per task, up to %d contending tasks\r\n",
+               BENCHMARK_ITERATIONS, BENCHMARK_MAX_CONTENDERS);
+    for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+        if (benchmarks[b].quiet) {
+            logSetLevel(LOG_MODULE_DISPATCHER, LOG_LEVEL_NONE);
+            logSetLevel(LOG_MODULE_VEHICLE, LOG_LEVEL_NONE);
+        }
+        for (int contenders = 1; contenders <= BENCHMARK_MAX_CONTENDERS; contenders++) {
+            runBenchmark(&benchmarks[b], contenders);
+        }
+        logSetLevel(LOG_MODULE_DISPATCHER, dispatcherLevel);
+        logSetLevel(LOG_MODULE_VEHICLE, vehicleLevel);
+    }
+#if BENCHMARK_ENABLED
+    runTimerBenchmarks();
+    logSetLevel(LOG_MODULE_DISPATCHER, LOG_LEVEL_NONE);
+    logSetLevel(LOG_MODULE_VEHICLE, LOG_LEVEL_NONE);
+    runScalingBenchmark();
+    logSetLevel(LOG_MODULE_DISPATCHER, dispatcherLevel);
+    logSetLevel(LOG_MODULE_VEHICLE, vehicleLevel);
+#endif
+#if BENCHMARK_ENABLED && INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+    runCapacityBenchmark();
+#endif
+    logMessage("Benchmark complete\r\n");
+
+    vTaskDelete(NULL);
+}
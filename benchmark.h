@@ -0,0 +1,17 @@
+/*
+ * benchmark.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file benchmark.h
+/// @brief Allocation and logging microbenchmark interface.
+
+#ifndef INC_BENCHMARK_H_
+#define INC_BENCHMARK_H_
+
+void initBenchmark(void);
+void benchmarkTask(void *params);
+
+#endif /* INC_BENCHMARK_H_ */
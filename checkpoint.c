@@ -0,0 +1,588 @@
+/**
+ * @file checkpoint.c
+ * @brief Simulation state checkpoint, write-ahead journal and restore.
+ *
+ * A snapshot holds the complete simulation state: vehicle counts, cumulative
+ * statistics, the event generator state, the simulated clock and the incidents
+ * accepted by the dispatcher shards but not yet completed, preempted ones with
+ * the handling time they have left. Next to it the store keeps the detailed
+ * statistics (quantile sketches, deadline counters and the history ring),
+ * written in place with their own CRC so they need no second copy. Between
+ * snapshots every incident is appended to a journal when it arrives, when it
+ * is preempted and when it completes, so a restore replays the journal on top
+ * of the last snapshot and resumes exactly where the run stopped. Only the
+ * borrow sizes recorded since the last snapshot are not journaled.
+ *
+ * The store lives in the `.noinit` RAM section, so it survives a reset, but not
+ * a power cycle. With CHECKPOINT_RESTORE_AT_STARTUP the next boot warm-starts
+ * from it. `checkpointExport`/`checkpointImport` copy the store as one binary
+ * blob so a warmed-up state can be saved and forked: `checkpoint export` on
+ * the console writes the blob to a file on the host (as hex lines on the
+ * board), and a host run started with CITYSIM_CHECKPOINT set to that file
+ * resumes from it.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "checkpoint.h"
+#include "dispatcher.h"
+#include "vehicle_management.h"
+#include "logger.h"
+#include "history.h"
+#include "profiler.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CHECKPOINT_MAGIC 0x43534B50UL /**< "CSKP" */
+#define CHECKPOINT_VERSION 7
+
+#define JOURNAL_ARRIVAL 1    /**< Incident generated, now in progress */
+#define JOURNAL_COMPLETION 2 /**< Incident finished */
+#define JOURNAL_PREEMPTION 3 /**< Incident lost its vehicles and is pending again */
+
+/**
+ * @brief An incident accepted but not yet completed.
+ */
+typedef struct {
+    uint32_t arrivalTime;         /**< Simulated time the incident was generated */
+    uint32_t remainingTime;       /**< Handling time left after a preemption, 0 = not started yet */
+    uint8_t department;           /**< Incident department */
+    uint8_t requiredVehicles;     /**< Vehicles required by the incident */
+    uint16_t id;                  /**< Incident identifier */
+    uint8_t severity;             /**< IncidentSeverity, the deadline follows from it */
+    uint8_t preemptions;          /**< Times the incident was preempted */
+} CheckpointIncident;
+
+/**
+ * @brief Full simulation state at one point in time.
+ */
+typedef struct {
+    uint32_t magic;               /**< CHECKPOINT_MAGIC */
+    uint16_t version;             /**< CHECKPOINT_VERSION */
+    uint16_t sequence;            /**< Incremented on every save */
+    uint32_t simulationTime;      /**< Simulated clock in ticks */
+    uint32_t randomState;         /**< Event generator state */
+    uint16_t departmentCount;     /**< NUM_DEPARTMENTS of the build that saved it */
+    uint16_t outstandingCount;    /**< Number of valid entries in outstanding */
+    int16_t vehicleCounts[NUM_DEPARTMENTS];  /**< Vehicles per department */
+    int32_t taskExecutions[NUM_DEPARTMENTS]; /**< Cumulative incidents handled per department */
+    int32_t vehiclesUsed[NUM_DEPARTMENTS];   /**< Cumulative vehicles used per department */
+    CheckpointIncident outstanding[DISPATCH_MAX_OUTSTANDING]; /**< Incidents not yet completed */
+    uint32_t crc;                 /**< CRC-32 of all preceding fields */
+} CheckpointSnapshot;
+
+/**
+ * @brief One journal record, written ahead of or after an incident.
+ */
+typedef struct {
+    uint32_t simulationTime;      /**< Simulated clock when the record was written */
+    uint32_t randomState;         /**< Event generator state after the record */
+    uint32_t detail;              /**< Completion: response time in ms; preemption: handling time left */
+    int32_t latenessMs;           /**< Completion: time past the deadline, negative if early */
+    uint16_t id;                  /**< Incident identifier */
+    uint8_t type;                 /**< JOURNAL_ARRIVAL, JOURNAL_COMPLETION or JOURNAL_PREEMPTION */
+    uint8_t department;           /**< Incident department */
+    uint8_t requiredVehicles;     /**< Vehicles required by the incident */
+    uint8_t severity;             /**< IncidentSeverity of the incident */
+    uint8_t allocated;            /**< Completion: the incident got its vehicles */
+    uint8_t preemptions;          /**< Preemption: times the incident was preempted */
+    int16_t vehicleCounts[NUM_DEPARTMENTS]; /**< Vehicles per department after the record */
+    uint32_t crc;                 /**< CRC-32 of all preceding fields */
+} JournalRecord;
+
+/**
+ * @brief Detailed statistics at the time of a snapshot.
+ */
+typedef struct {
+    uint16_t sequence;            /**< Sequence number of the snapshot they belong to */
+    DetailedStatistics statistics; /**< Quantile sketches and deadline counters */
+    HistoryBucket history[NUM_DEPARTMENTS][HISTORY_BUCKETS]; /**< Windowed history per department */
+    uint32_t crc;                 /**< CRC-32 of all preceding fields */
+} CheckpointStatistics;
+
+/**
+ * @brief Persistent store: last snapshot and its statistics, followed by its journal.
+ */
+typedef struct {
+    CheckpointSnapshot snapshot;
+    CheckpointStatistics statistics;
+    uint32_t journalLength;
+    JournalRecord journal[CHECKPOINT_JOURNAL_LENGTH];
+} CheckpointStore;
+
+static CheckpointStore checkpointStore __attribute__((section(".noinit"))); /**< Survives resets */
+static SemaphoreHandle_t checkpointMutex = NULL; /**< Keeps state changes and their records together */
+#if PROFILER_ENABLED
+static uint32_t lockTakenAt;                     /**< Profiler clock when the holder took the store */
+#endif
+
+/**
+ * @brief Computes the CRC-32 (IEEE 802.3) of a buffer.
+ *
+ * @param data The data.
+ * @param length Number of bytes.
+ * @return The CRC value.
+ */
+static uint32_t crc32(const void *data, size_t length) {
+    const uint8_t *bytes = data;
+    uint32_t crc = 0xFFFFFFFFUL;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+static bool snapshotValid(const CheckpointSnapshot *snapshot) {
+    // A build with another number of departments has another layout
+    return snapshot->magic == CHECKPOINT_MAGIC && snapshot->version == CHECKPOINT_VERSION &&
+           snapshot->departmentCount == NUM_DEPARTMENTS &&
+           snapshot->crc == crc32(snapshot, offsetof(CheckpointSnapshot, crc));
+}
+
+static bool statisticsValid(const CheckpointStatistics *statistics, const CheckpointSnapshot *snapshot) {
+    return statistics->sequence == snapshot->sequence &&
+           statistics->crc == crc32(statistics, offsetof(CheckpointStatistics, crc));
+}
+
+static bool recordValid(const JournalRecord *record) {
+    return record->crc == crc32(record, offsetof(JournalRecord, crc));
+}
+
+static void saveSnapshot(void);
+
+/**
+ * @brief Appends a record to the journal, taking a snapshot first if it is full.
+ *
+ * @param type JOURNAL_ARRIVAL, JOURNAL_COMPLETION or JOURNAL_PREEMPTION.
+ * @param request The incident.
+ * @param allocated Completion: the incident got its vehicles.
+ * @param detail Completion: response time in ms; preemption: handling time left.
+ * @param latenessMs Completion: time past the deadline.
+ */
+static void journalAppend(uint8_t type, const DispatchRequest *request, bool allocated, uint32_t detail,
+                          int32_t latenessMs) {
+    if (!snapshotValid(&checkpointStore.snapshot) ||
+        checkpointStore.journalLength >= CHECKPOINT_JOURNAL_LENGTH) {
+        saveSnapshot();
+    }
+
+    int counts[NUM_DEPARTMENTS];
+    getVehicleCounts(counts);
+
+    JournalRecord record;
+    memset(&record, 0, sizeof(record)); // The CRC covers the padding too
+    record.simulationTime = getSimulationTime();
+    record.randomState = getRandomState();
+    record.id = request->id;
+    record.type = type;
+    record.department = request->department;
+    record.requiredVehicles = request->requiredVehicles;
+    record.severity = request->severity;
+    record.allocated = allocated ? 1 : 0;
+    record.preemptions = request->preemptions;
+    record.detail = detail;
+    record.latenessMs = latenessMs;
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        record.vehicleCounts[i] = (int16_t)counts[i];
+    }
+    record.crc = crc32(&record, offsetof(JournalRecord, crc));
+
+    // The record is complete before the length makes it visible
+    checkpointStore.journal[checkpointStore.journalLength] = record;
+    checkpointStore.journalLength++;
+}
+
+/**
+ * @brief Takes a snapshot of the full simulation state and clears the journal.
+ */
+static void saveSnapshot(void) {
+    // Off the stack: they grow with the departments, and only the holder of the store lock runs this
+    static CheckpointSnapshot snapshot;
+    static int counts[NUM_DEPARTMENTS];
+    static int executions[NUM_DEPARTMENTS];
+    static int vehiclesUsed[NUM_DEPARTMENTS];
+    static DispatchRequest outstanding[DISPATCH_MAX_OUTSTANDING];
+
+    memset(&snapshot, 0, sizeof(snapshot)); // The CRC covers the padding too
+    snapshot.magic = CHECKPOINT_MAGIC;
+    snapshot.version = CHECKPOINT_VERSION;
+    snapshot.departmentCount = NUM_DEPARTMENTS;
+    snapshot.simulationTime = getSimulationTime();
+    snapshot.randomState = getRandomState();
+    getVehicleCounts(counts);
+    getStatistics(executions, vehiclesUsed);
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        snapshot.vehicleCounts[i] = (int16_t)counts[i];
+        snapshot.taskExecutions[i] = executions[i];
+        snapshot.vehiclesUsed[i] = vehiclesUsed[i];
+    }
+    snapshot.outstandingCount = (uint16_t)getOutstandingIncidents(outstanding, DISPATCH_MAX_OUTSTANDING);
+    for (int i = 0; i < snapshot.outstandingCount; i++) {
+        snapshot.outstanding[i].arrivalTime = outstanding[i].arrivalTime;
+        snapshot.outstanding[i].remainingTime = outstanding[i].remainingTime;
+        snapshot.outstanding[i].preemptions = outstanding[i].preemptions;
+        snapshot.outstanding[i].department = outstanding[i].department;
+        snapshot.outstanding[i].requiredVehicles = outstanding[i].requiredVehicles;
+        snapshot.outstanding[i].id = outstanding[i].id;
+        snapshot.outstanding[i].severity = outstanding[i].severity;
+    }
+    if (snapshotValid(&checkpointStore.snapshot)) {
+        snapshot.sequence = checkpointStore.snapshot.sequence + 1;
+    }
+    snapshot.crc = crc32(&snapshot, offsetof(CheckpointSnapshot, crc));
+
+    // Invalidate the journal first: it belongs to the previous snapshot
+    checkpointStore.journalLength = 0;
+    checkpointStore.snapshot = snapshot;
+
+    // Written in place, they are large; a reset half-way only loses them, not the snapshot
+    CheckpointStatistics *statistics = &checkpointStore.statistics;
+    memset(statistics, 0, sizeof(*statistics));
+    statistics->sequence = snapshot.sequence;
+    getDetailedStatistics(&statistics->statistics);
+    historyGetBuckets(statistics->history);
+    statistics->crc = crc32(statistics, offsetof(CheckpointStatistics, crc));
+}
+
+/**
+ * @brief Creates the lock that keeps the store consistent between tasks.
+ *
+ * Must be called before the other checkpoint functions.
+ */
+void initCheckpoint(void) {
+    checkpointMutex = xSemaphoreCreateMutex();
+    if (checkpointMutex == NULL) {
+        logMessage("Failed to create checkpoint mutex\r\n");
+    }
+}
+
+/**
+ * @brief Locks the store.
+ *
+ * Held by the dispatcher around a state change and its journal record, so a
+ * snapshot never falls between the two.
+ */
+void checkpointLock(void) {
+    if (checkpointMutex != NULL) {
+        xSemaphoreTake(checkpointMutex, portMAX_DELAY);
+#if PROFILER_ENABLED
+        lockTakenAt = profilerNow();
+#endif
+    }
+}
+
+/**
+ * @brief Unlocks the store.
+ */
+void checkpointUnlock(void) {
+    if (checkpointMutex != NULL) {
+#if PROFILER_ENABLED
+        // Hold times bound how long a higher-priority task can be blocked on the store
+        profilerRecord(PROF_CHECKPOINT_HOLD, profilerNow() - lockTakenAt);
+#endif
+        xSemaphoreGive(checkpointMutex);
+    }
+}
+
+/**
+ * @brief Takes a snapshot of the full simulation state and clears the journal.
+ */
+void checkpointSave(void) {
+    checkpointLock();
+    saveSnapshot();
+    checkpointUnlock();
+}
+
+/**
+ * @brief Restores the simulation state from the store.
+ *
+ * Applies the last snapshot and replays its journal up to the first damaged
+ * record. Must be called after the subsystems are initialized and before the
+ * scheduler starts.
+ *
+ * @return True if a valid checkpoint was found and restored.
+ */
+bool checkpointRestore(void) {
+    const CheckpointSnapshot *snapshot = &checkpointStore.snapshot;
+    if (!snapshotValid(snapshot)) {
+        checkpointDiscard();
+        logMessage("No valid checkpoint, starting from initial state\r\n");
+        return false;
+    }
+
+    // Off the stack like in saveSnapshot; runs once, before the scheduler starts
+    static int counts[NUM_DEPARTMENTS];
+    static int executions[NUM_DEPARTMENTS];
+    static int vehiclesUsed[NUM_DEPARTMENTS];
+    static DispatchRequest outstanding[DISPATCH_MAX_OUTSTANDING];
+    uint32_t simulationTime = snapshot->simulationTime;
+    uint32_t randomState = snapshot->randomState;
+    int outstandingCount = 0;
+
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        counts[i] = snapshot->vehicleCounts[i];
+        executions[i] = snapshot->taskExecutions[i];
+        vehiclesUsed[i] = snapshot->vehiclesUsed[i];
+    }
+    for (int i = 0; i < snapshot->outstandingCount && i < DISPATCH_MAX_OUTSTANDING; i++) {
+        outstanding[outstandingCount++] = (DispatchRequest){
+            .department = snapshot->outstanding[i].department,
+            .requiredVehicles = snapshot->outstanding[i].requiredVehicles,
+            .id = snapshot->outstanding[i].id,
+            .arrivalTime = snapshot->outstanding[i].arrivalTime,
+            .remainingTime = snapshot->outstanding[i].remainingTime,
+            .preemptions = snapshot->outstanding[i].preemptions,
+            .severity = snapshot->outstanding[i].severity,
+            .deadline = getIncidentDeadline(snapshot->outstanding[i].department, snapshot->outstanding[i].severity,
+                                            snapshot->outstanding[i].arrivalTime)
+        };
+    }
+
+    // The replayed completions are recorded on top of the saved statistics
+    bool statisticsRestored = statisticsValid(&checkpointStore.statistics, snapshot);
+    if (statisticsRestored) {
+        setDetailedStatistics(&checkpointStore.statistics.statistics);
+        historySetBuckets(checkpointStore.statistics.history);
+    }
+
+    uint32_t replayed = 0;
+    uint32_t journalLength = checkpointStore.journalLength;
+    if (journalLength > CHECKPOINT_JOURNAL_LENGTH) {
+        journalLength = 0;
+    }
+    for (; replayed < journalLength; replayed++) {
+        const JournalRecord *record = &checkpointStore.journal[replayed];
+        if (!recordValid(record) || record->department >= NUM_DEPARTMENTS) {
+            break;
+        }
+
+        simulationTime = record->simulationTime;
+        randomState = record->randomState;
+        for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+            counts[i] = record->vehicleCounts[i];
+        }
+        if (record->type == JOURNAL_ARRIVAL) {
+            if (outstandingCount < DISPATCH_MAX_OUTSTANDING) {
+                outstanding[outstandingCount++] = (DispatchRequest){
+                    .department = record->department,
+                    .requiredVehicles = record->requiredVehicles,
+                    .id = record->id,
+                    .arrivalTime = record->simulationTime,
+                    .severity = record->severity,
+                    .deadline = getIncidentDeadline(record->department, record->severity, record->simulationTime)
+                };
+            }
+        } else if (record->type == JOURNAL_PREEMPTION) {
+            for (int i = 0; i < outstandingCount; i++) {
+                if (outstanding[i].department == record->department && outstanding[i].id == record->id) {
+                    outstanding[i].remainingTime = record->detail;
+                    outstanding[i].preemptions = record->preemptions;
+                    break;
+                }
+            }
+        } else {
+            // Recorded as completeIncident does; the counters are set from executions and vehiclesUsed below
+            bool missed = !record->allocated || record->latenessMs > 0;
+            recordDeadlineResult(record->department, record->severity, missed, record->latenessMs);
+            if (record->allocated) {
+                executions[record->department]++;
+                vehiclesUsed[record->department] += record->requiredVehicles;
+                recordVehicleUsage(record->department, record->requiredVehicles);
+                recordResponseTime(record->department, record->detail);
+                recordSeverityResponseTime(record->severity, record->detail);
+                // The history buckets follow the simulated clock
+                setSimulationTime(record->simulationTime);
+                historyRecordIncident(record->department, record->requiredVehicles, missed);
+            }
+            // Incidents may complete out of order, so match the identifier
+            for (int i = 0; i < outstandingCount; i++) {
+                if (outstanding[i].department == record->department &&
+                    outstanding[i].id == record->id) {
+                    memmove(&outstanding[i], &outstanding[i + 1],
+                            (size_t)(outstandingCount - i - 1) * sizeof(DispatchRequest));
+                    outstandingCount--;
+                    break;
+                }
+            }
+        }
+    }
+
+    setVehicleCounts(counts);
+    setStatistics(executions, vehiclesUsed);
+    setRandomState(randomState);
+    setSimulationTime(simulationTime);
+    restoreOutstandingIncidents(outstanding, outstandingCount);
+
+    logMessage("*** Resuming from checkpoint %u, not a cold start: tick %lu, %lu journal records replayed, "
+               "%d incidents resumed ***\r\n", snapshot->sequence, (unsigned long)simulationTime, (unsigned long)replayed, outstandingCount);
+    if (!statisticsRestored) {
+        logMessage("Checkpoint statistics damaged, response times and history start empty\r\n");
+    }
+
+    // Fold the replayed journal into a fresh snapshot
+    checkpointSave();
+    return true;
+}
+
+/**
+ * @brief Invalidates the stored checkpoint so the next boot starts cold.
+ */
+void checkpointDiscard(void) {
+    memset(&checkpointStore, 0, sizeof(checkpointStore));
+}
+
+/**
+ * @brief Journals an incident before it is handled.
+ *
+ * Call with the store locked (`checkpointLock`).
+ *
+ * @param request The incident that has just been generated.
+ */
+void checkpointJournalArrival(const DispatchRequest *request) {
+    journalAppend(JOURNAL_ARRIVAL, request, false, 0, 0);
+}
+
+/**
+ * @brief Journals the completion of an incident.
+ *
+ * Call with the store locked (`checkpointLock`).
+ *
+ * @param request The incident that has just been handled.
+ * @param allocated True if the incident got its vehicles and was handled.
+ * @param responseMs Time from generation to completion, used if allocated.
+ * @param latenessMs Completion time minus deadline, negative if early.
+ */
+void checkpointJournalCompletion(const DispatchRequest *request, bool allocated, uint32_t responseMs,
+                                 int32_t latenessMs) {
+    journalAppend(JOURNAL_COMPLETION, request, allocated, responseMs, latenessMs);
+}
+
+/**
+ * @brief Journals the preemption of an incident.
+ *
+ * Call with the store locked (`checkpointLock`).
+ *
+ * @param request The incident as requeued, with its handling time left and preemption count.
+ */
+void checkpointJournalPreemption(const DispatchRequest *request) {
+    journalAppend(JOURNAL_PREEMPTION, request, false, request->remainingTime, 0);
+}
+
+/**
+ * @brief Copies the snapshot and its journal into a binary blob.
+ *
+ * @param buffer Destination buffer.
+ * @param size Size of the destination buffer.
+ * @return Number of bytes written, 0 if the buffer is too small or there is
+ *         no valid checkpoint.
+ */
+size_t checkpointExport(uint8_t *buffer, size_t size) {
+    uint32_t journalLength = checkpointStore.journalLength;
+    size_t length = offsetof(CheckpointStore, journal) + journalLength * sizeof(JournalRecord);
+
+    if (!snapshotValid(&checkpointStore.snapshot) || journalLength > CHECKPOINT_JOURNAL_LENGTH ||
+        size < length) {
+        return 0;
+    }
+    memcpy(buffer, &checkpointStore, length);
+    return length;
+}
+
+/**
+ * @brief Loads a blob produced by `checkpointExport` into the store.
+ *
+ * The state is applied by the next `checkpointRestore`, normally at startup.
+ *
+ * @param buffer The blob.
+ * @param size Size of the blob.
+ * @return True if the blob holds a valid snapshot and was loaded.
+ */
+bool checkpointImport(const uint8_t *buffer, size_t size) {
+    // Off the stack: it holds the statistics and the whole journal
+    static CheckpointStore imported;
+
+    memset(&imported, 0, sizeof(imported));
+
+    if (size < offsetof(CheckpointStore, journal) || size > sizeof(CheckpointStore)) {
+        return false;
+    }
+    memcpy(&imported, buffer, size);
+    if (!snapshotValid(&imported.snapshot) ||
+        imported.journalLength != (size - offsetof(CheckpointStore, journal)) / sizeof(JournalRecord)) {
+        return false;
+    }
+
+    checkpointStore = imported;
+    return true;
+}
+
+/**
+ * @brief Exports the store to a file on the host, or as hex lines to the log on the board.
+ *
+ * @param path File to write; ignored on the board.
+ * @return Number of bytes exported, 0 if there is no valid checkpoint or the file cannot be written.
+ */
+size_t checkpointExportFile(const char *path) {
+    static uint8_t blob[sizeof(CheckpointStore)]; // Off the console's stack
+    checkpointLock();
+    size_t length = checkpointExport(blob, sizeof(blob));
+    checkpointUnlock();
+    if (length == 0) {
+        return 0;
+    }
+
+#if defined(STM32F746xx)
+    (void)path;
+    char line[2 * 32 + 1];
+    for (size_t offset = 0; offset < length; offset += 32) {
+        size_t count = (length - offset < 32) ? length - offset : 32;
+        for (size_t i = 0; i < count; i++) {
+            snprintf(&line[2 * i], 3, "%02x", blob[offset + i]);
+        }
+        logMessage("ckpt %04x %s\r\n", (unsigned)offset, line);
+    }
+#else
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return 0;
+    }
+    bool written = fwrite(blob, 1, length, file) == length;
+    if (fclose(file) != 0 || !written) {
+        return 0;
+    }
+#endif
+    return length;
+}
+
+/**
+ * @brief Loads a file written by `checkpointExportFile` into the store (host only).
+ *
+ * The state is applied by the next `checkpointRestore`.
+ *
+ * @param path The file.
+ * @return True if the file holds a valid checkpoint and was loaded.
+ */
+bool checkpointImportFile(const char *path) {
+#if defined(STM32F746xx)
+    (void)path;
+    return false;
+#else
+    static uint8_t blob[sizeof(CheckpointStore)];
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    size_t length = fread(blob, 1, sizeof(blob), file);
+    fclose(file);
+    return checkpointImport(blob, length);
+#endif
+}
@@ -0,0 +1,34 @@
+/*
+ * checkpoint.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file checkpoint.h
+/// @brief Simulation checkpoint and journal interface.
+
+#ifndef INC_CHECKPOINT_H_
+#define INC_CHECKPOINT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dispatcher.h"
+
+void initCheckpoint(void);
+void checkpointLock(void);
+void checkpointUnlock(void);
+void checkpointSave(void);
+bool checkpointRestore(void);
+void checkpointDiscard(void);
+void checkpointJournalArrival(const DispatchRequest *request);
+void checkpointJournalCompletion(const DispatchRequest *request, bool allocated, uint32_t responseMs,
+                                 int32_t latenessMs);
+void checkpointJournalPreemption(const DispatchRequest *request);
+size_t checkpointExport(uint8_t *buffer, size_t size);
+bool checkpointImport(const uint8_t *buffer, size_t size);
+size_t checkpointExportFile(const char *path);
+bool checkpointImportFile(const char *path);
+
+#endif /* INC_CHECKPOINT_H_ */
@@ -0,0 +1,307 @@
+/**
+ * @file console.c
+ * @brief Non-blocking UART command console for live queries.
+ *
+ * On the board, USART3 receives one byte per interrupt into a ring buffer and
+ * wakes the console task, so no task ever waits inside HAL_UART_Receive. The
+ * console task runs at low priority, assembles lines and answers queries
+ * without pausing the dispatcher. On the host, the same task reads stdin.
+ *
+ * Commands:
+ *   help              list commands
+ *   vehicles          vehicle snapshot per department
+ *   queue             dispatch queue depth and incident in progress
+ *   stats             full statistics report
+ *   rate <ms>         change the time between incidents
+ *   history [min]     per-department totals over the last minutes
+ *   policy [name]     show or change the reallocation policy
+ *   policy compare [a] [b]  run two policies on the same simulated incidents
+ *   reserve [on|off]  show or switch the reserve floors
+ *   reserve compare   simulate the active policy without and with the floors
+ *   preempt [on|off]  show or switch preemption of low-severity incidents
+ *   preempt compare   simulate the active policy without and with preemption
+ *   checkpoint save   take a snapshot now
+ *   checkpoint export [file]  write the checkpoint to a file (hex lines on the board)
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "console.h"
+#include "dispatcher.h"
+#include "vehicle_management.h"
+#include "scenario.h"
+#include "logger.h"
+#include "history.h"
+#include "rta.h"
+#include "reallocation_compare.h"
+#include "preemption.h"
+#include "checkpoint.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(STM32F746xx)
+#include "stm32f7xx_hal.h"
+
+extern UART_HandleTypeDef huart3;
+#endif
+
+static uint8_t rxBuffer[CONSOLE_RX_BUFFER_SIZE];  /**< Ring buffer filled by the UART interrupt */
+static volatile uint16_t rxHead = 0;              /**< Next write position (interrupt side) */
+static volatile uint16_t rxTail = 0;              /**< Next read position (task side) */
+static volatile uint32_t rxOverruns = 0;          /**< Bytes dropped because the ring was full */
+static TaskHandle_t consoleTaskHandle = NULL;     /**< Task woken by the interrupt */
+
+#if defined(STM32F746xx)
+static uint8_t rxByte; /**< Target of the current single-byte interrupt reception */
+
+/**
+ * @brief USART3 interrupt handler.
+ *
+ * USART3 has no interrupt enabled in the CubeMX configuration, so the handler
+ * is provided here.
+ */
+void USART3_IRQHandler(void) {
+    HAL_UART_IRQHandler(&huart3);
+}
+
+/**
+ * @brief HAL reception-complete callback: stores the byte and re-arms reception.
+ *
+ * @param huart The UART that received a byte.
+ */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    if (huart != &huart3) {
+        return;
+    }
+
+    uint16_t next = (rxHead + 1U) % CONSOLE_RX_BUFFER_SIZE;
+    if (next != rxTail) {
+        rxBuffer[rxHead] = rxByte;
+        rxHead = next;
+    } else {
+        rxOverruns++;
+    }
+    HAL_UART_Receive_IT(&huart3, &rxByte, 1);
+
+    if (consoleTaskHandle != NULL) {
+        vTaskNotifyGiveFromISR(consoleTaskHandle, &higherPriorityTaskWoken);
+    }
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+#endif
+
+/**
+ * @brief Takes one received byte out of the ring buffer.
+ *
+ * @param byte Output byte.
+ * @return True if a byte was available.
+ */
+bool consoleReadByte(uint8_t *byte) {
+#if defined(STM32F746xx)
+    if (rxTail == rxHead) {
+        return false;
+    }
+    *byte = rxBuffer[rxTail];
+    rxTail = (rxTail + 1U) % CONSOLE_RX_BUFFER_SIZE;
+    return true;
+#else
+    // Host stand-in: stdin plays the role of the UART
+    int ch = getchar();
+    if (ch == EOF) {
+        return false;
+    }
+    *byte = (uint8_t)ch;
+    return true;
+#endif
+}
+
+/**
+ * @brief Initializes the console task and starts interrupt-driven reception.
+ */
+void initConsole(void) {
+    if (xTaskCreate(consoleTask, "Console", CONSOLE_STACK_SIZE, NULL, CONSOLE_PRIORITY,
+                    &consoleTaskHandle) != pdPASS) {
+        logMessage("Failed to create console task\r\n");
+        return;
+    }
+
+#if defined(STM32F746xx)
+    // Must not be above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY: the callback uses FromISR APIs
+    HAL_NVIC_SetPriority(USART3_IRQn, CONSOLE_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(USART3_IRQn);
+    HAL_UART_Receive_IT(&huart3, &rxByte, 1);
+#endif
+    logMessage("Console task created successfully\r\n");
+}
+
+/**
+ * @brief Executes one console command line.
+ *
+ * @param line The command line, modified in place by tokenizing.
+ */
+void consoleExecute(char *line) {
+    char *command = strtok(line, " \t");
+    char *argument = strtok(NULL, " \t");
+
+    if (command == NULL) {
+        return;
+    }
+
+    if (strcmp(command, "vehicles") == 0) {
+        int counts[NUM_DEPARTMENTS];
+        getVehicleCounts(counts);
+        for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+            logMessage("%s:%d ", departmentName((uint8_t)i), counts[i]);
+        }
+        logMessage("\r\n");
+    } else if (strcmp(command, "queue") == 0) {
+        DispatchRequest inProgress;
+        logMessage("Queued incidents: %u\r\n", (unsigned)getDispatchQueueDepth());
+        for (uint8_t i = 0; i < NUM_DEPARTMENTS; i++) {
+            logMessage("%s: %u queued, %lu dropped", departmentName(i), (unsigned)getShardQueueDepth(i),
+                       (unsigned long)getDroppedIncidents(i));
+            if (getIncidentInProgress(i, &inProgress)) {
+                logMessage(", in progress %d vehicles", inProgress.requiredVehicles);
+            }
+            logMessage("\r\n");
+        }
+    } else if (strcmp(command, "stats") == 0) {
+        generateStatisticsReport();
+    } else if (strcmp(command, "rate") == 0) {
+        if (argument == NULL || atoi(argument) <= 0) {
+            logMessage("Arrival interval: %lu ms\r\n", (unsigned long)scenarioGet()->arrivalMs);
+        } else {
+            scenarioSetArrivalMs((uint32_t)atoi(argument));
+            logMessage("Arrival interval set to %lu ms\r\n", (unsigned long)scenarioGet()->arrivalMs);
+        }
+    } else if (strcmp(command, "history") == 0) {
+        uint32_t minutes = (argument != NULL && atoi(argument) > 0) ? (uint32_t)atoi(argument) : 5;
+        historyReport(minutes * 60000UL);
+    } else if (strcmp(command, "order") == 0) {
+        if (argument != NULL && strcmp(argument, "edf") == 0) {
+            setDispatchOrder(DISPATCH_ORDER_EDF);
+        } else if (argument != NULL && strcmp(argument, "fifo") == 0) {
+            setDispatchOrder(DISPATCH_ORDER_FIFO);
+        }
+        logMessage("Dispatch order: %s\r\n", (getDispatchOrder() == DISPATCH_ORDER_EDF) ? "edf" : "fifo");
+    } else if (strcmp(command, "policy") == 0) {
+        ReallocationPolicyId policy;
+        if (argument != NULL && strcmp(argument, "compare") == 0) {
+            ReallocationPolicyId first = REALLOCATION_FIXED_ORDER;
+            ReallocationPolicyId second = REALLOCATION_LARGEST_IDLE;
+            char *name = strtok(NULL, " \t");
+            if (name != NULL && !findReallocationPolicy(name, &first)) {
+                logMessage("Unknown policy '%s'\r\n", name);
+                return;
+            }
+            name = strtok(NULL, " \t");
+            if (name != NULL && !findReallocationPolicy(name, &second)) {
+                logMessage("Unknown policy '%s'\r\n", name);
+                return;
+            }
+            reallocationCompare(first, second);
+            return;
+        }
+        if (argument != NULL) {
+            if (findReallocationPolicy(argument, &policy)) {
+                setActiveReallocationPolicy(policy);
+            } else {
+                logMessage("Unknown policy '%s'\r\n", argument);
+            }
+        }
+        logMessage("Reallocation policy: %s\r\n", getReallocationPolicy(getActiveReallocationPolicy())->name);
+    } else if (strcmp(command, "reserve") == 0) {
+        if (argument != NULL && strcmp(argument, "compare") == 0) {
+            reallocationCompareReserves(getActiveReallocationPolicy());
+            return;
+        }
+        if (argument != NULL && strcmp(argument, "on") == 0) {
+            setReserveFloorsEnabled(true);
+        } else if (argument != NULL && strcmp(argument, "off") == 0) {
+            setReserveFloorsEnabled(false);
+        }
+        reserveReport();
+    } else if (strcmp(command, "preempt") == 0) {
+        if (argument != NULL && strcmp(argument, "compare") == 0) {
+            reallocationComparePreemption(getActiveReallocationPolicy());
+            return;
+        }
+#if PREEMPTION_SUPPORTED
+        if (argument != NULL && strcmp(argument, "on") == 0) {
+            setPreemptionEnabled(true);
+        } else if (argument != NULL && strcmp(argument, "off") == 0) {
+            setPreemptionEnabled(false);
+        }
+        preemptionReport();
+#else
+        logMessage("Preemption needs batched allocation and timed incidents\r\n");
+#endif
+#if CHECKPOINT_ENABLED
+    } else if (strcmp(command, "checkpoint") == 0) {
+        if (argument != NULL && strcmp(argument, "save") == 0) {
+            checkpointSave();
+            logMessage("Checkpoint saved\r\n");
+        } else if (argument != NULL && strcmp(argument, "export") == 0) {
+            char *path = strtok(NULL, " \t");
+            size_t length = checkpointExportFile((path != NULL) ? path : CHECKPOINT_FILE);
+            if (length > 0) {
+                logMessage("Checkpoint exported, %u bytes\r\n", (unsigned)length);
+            } else {
+                logMessage("No checkpoint to export\r\n");
+            }
+        } else {
+            logMessage("Usage: checkpoint save | checkpoint export [file]\r\n");
+        }
+#endif
+    } else if (strcmp(command, "rta") == 0) {
+        rtaReport();
+    } else if (strcmp(command, "help") == 0) {
+        logMessage("Commands: vehicles | queue | stats | rate [ms] | history [min] | order [fifo|edf] | rta\r\n");
+        logMessage("          policy [fixed|largest|proportional|recent] | policy compare [a] [b]\r\n");
+        logMessage("          reserve [on|off|compare] | preempt [on|off|compare] | checkpoint save|export [file]\r\n");
+        logMessage("          help\r\n");
+    } else {
+        logMessage("Unknown command '%s', type help\r\n", command);
+    }
+}
+
+/**
+ * @brief Console task.
+ *
+ * Sleeps until the UART interrupt signals new bytes, then assembles them into
+ * lines and executes each complete line.
+ *
+ * @param params Unused task parameters.
+ */
+void consoleTask(void *params) {
+    static char line[CONSOLE_LINE_SIZE];
+    size_t length = 0;
+    uint8_t byte;
+
+    while (1) {
+#if defined(STM32F746xx)
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#endif
+        while (consoleReadByte(&byte)) {
+            if (byte == '\r' || byte == '\n') {
+                line[length] = '\0';
+                consoleExecute(line);
+                length = 0;
+            } else if (byte == '\b' || byte == 0x7F) {
+                length = (length > 0) ? length - 1 : 0;
+            } else if (length < CONSOLE_LINE_SIZE - 1) {
+                line[length++] = (char)byte;
+            }
+        }
+#if !defined(STM32F746xx)
+        vTaskDelay(pdMS_TO_TICKS(100)); // stdin closed, nothing more to read
+#endif
+    }
+}
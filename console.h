@@ -0,0 +1,22 @@
+/*
+ * console.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file console.h
+/// @brief UART command console interface.
+
+#ifndef INC_CONSOLE_H_
+#define INC_CONSOLE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void initConsole(void);
+bool consoleReadByte(uint8_t *byte);
+void consoleExecute(char *line);
+void consoleTask(void *params);
+
+#endif /* INC_CONSOLE_H_ */
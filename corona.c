@@ -13,6 +13,8 @@
 #include "dispatcher.h"
 #include "logger.h"
 #include "project_defines.h"
+#include "scenario.h"
+#include "vehicle_management.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
@@ -34,7 +36,8 @@ void initCorona(void) {
         return;
     }
 
-    if (xTaskCreate(coronaTask, "CoronaTask", CORONA_STACK_SIZE, NULL, CORONA_TASK_PRIORITY, NULL) == pdPASS) {
+    if (xTaskCreate(coronaTask, "CoronaTask", scenarioDepartment(CORONA)->stackWords, NULL,
+                    scenarioDepartment(CORONA)->priority, NULL) == pdPASS) {
         logMessage("Corona task created successfully\r\n");
     } else {
         logMessage("Failed to create Corona task\r\n");
@@ -53,7 +56,7 @@ void coronaTask(void *params) {
     while (1) {
         if (xSemaphoreTake(coronaSemaphore, portMAX_DELAY) == pdTRUE) {
             // Simulate event handling
-            vTaskDelay(Short_DELAY);
+            vTaskDelay(getIncidentHandlingTime(CORONA));
 
             // Signal completion
             xSemaphoreGive(coronaCompletionSemaphore);
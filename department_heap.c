@@ -0,0 +1,154 @@
+/**
+ * @file department_heap.c
+ * @brief Indexed binary max-heap of departments.
+ *
+ * Donor selection picks the department with the most of something (idle
+ * vehicles, surplus, time since it last lent) again and again. Scanning every
+ * department for each pick is O(D); the heap is built once in O(D) and then
+ * gives the next department, or takes a changed key, in O(log D). Each
+ * department's position is kept, so its key can change while it is in the
+ * heap.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "department_heap.h"
+
+/**
+ * @brief Checks whether one department goes above another.
+ *
+ * @param heap The heap.
+ * @param a The first department.
+ * @param b The second department.
+ * @return True if a has the larger key, or the same key and the lower index.
+ */
+static bool above(const DepartmentHeap *heap, uint8_t a, uint8_t b) {
+    if (heap->keys[a] != heap->keys[b]) {
+        return heap->keys[a] > heap->keys[b];
+    }
+    return a < b;
+}
+
+/**
+ * @brief Places a department at a heap index.
+ */
+static void place(DepartmentHeap *heap, int index, uint8_t department) {
+    heap->order[index] = department;
+    heap->position[department] = (uint8_t)index;
+}
+
+/**
+ * @brief Moves the department at an index up to its place.
+ */
+static void siftUp(DepartmentHeap *heap, int index) {
+    uint8_t department = heap->order[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!above(heap, department, heap->order[parent])) {
+            break;
+        }
+        place(heap, index, heap->order[parent]);
+        index = parent;
+    }
+    place(heap, index, department);
+}
+
+/**
+ * @brief Moves the department at an index down to its place.
+ */
+static void siftDown(DepartmentHeap *heap, int index) {
+    uint8_t department = heap->order[index];
+    while (true) {
+        int child = 2 * index + 1;
+        if (child >= heap->count) {
+            break;
+        }
+        if (child + 1 < heap->count && above(heap, heap->order[child + 1], heap->order[child])) {
+            child++;
+        }
+        if (!above(heap, heap->order[child], department)) {
+            break;
+        }
+        place(heap, index, heap->order[child]);
+        index = child;
+    }
+    place(heap, index, department);
+}
+
+/**
+ * @brief Builds a heap of every department but one.
+ *
+ * @param heap The heap.
+ * @param keys Key of each department.
+ * @param exclude Department left out of the heap, or -1 to keep them all.
+ */
+void departmentHeapBuild(DepartmentHeap *heap, const int32_t keys[NUM_DEPARTMENTS], int exclude) {
+    heap->count = 0;
+    for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+        heap->keys[d] = keys[d];
+        if (d == exclude) {
+            heap->position[d] = DEPARTMENT_HEAP_ABSENT;
+        } else {
+            place(heap, heap->count++, (uint8_t)d);
+        }
+    }
+    for (int i = heap->count / 2 - 1; i >= 0; i--) {
+        siftDown(heap, i);
+    }
+}
+
+/**
+ * @brief Changes a department's key.
+ *
+ * A department that is no longer in the heap only has its key recorded.
+ *
+ * @param heap The heap.
+ * @param department The department.
+ * @param key Its new key.
+ */
+void departmentHeapUpdate(DepartmentHeap *heap, uint8_t department, int32_t key) {
+    if (department >= NUM_DEPARTMENTS) {
+        return;
+    }
+    int32_t old = heap->keys[department];
+    heap->keys[department] = key;
+    int index = heap->position[department];
+    if (index == DEPARTMENT_HEAP_ABSENT) {
+        return;
+    }
+    if (key > old) {
+        siftUp(heap, index);
+    } else {
+        siftDown(heap, index);
+    }
+}
+
+/**
+ * @brief Gets the department with the largest key.
+ *
+ * @param heap The heap.
+ * @return The department, or -1 if the heap is empty.
+ */
+int departmentHeapTop(const DepartmentHeap *heap) {
+    return (heap->count > 0) ? heap->order[0] : -1;
+}
+
+/**
+ * @brief Removes the department with the largest key.
+ *
+ * @param heap The heap.
+ * @return The department, or -1 if the heap is empty.
+ */
+int departmentHeapPop(DepartmentHeap *heap) {
+    if (heap->count == 0) {
+        return -1;
+    }
+    uint8_t top = heap->order[0];
+    heap->position[top] = DEPARTMENT_HEAP_ABSENT;
+    if (--heap->count > 0) {
+        place(heap, 0, heap->order[heap->count]);
+        siftDown(heap, 0);
+    }
+    return top;
+}
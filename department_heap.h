@@ -0,0 +1,42 @@
+/*
+ * department_heap.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file department_heap.h
+/// @brief Indexed max-heap of departments.
+
+#ifndef INC_DEPARTMENT_HEAP_H_
+#define INC_DEPARTMENT_HEAP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "project_defines.h"
+
+#if NUM_DEPARTMENTS > 255
+#error "Department indices are uint8_t"
+#endif
+
+#define DEPARTMENT_HEAP_ABSENT 0xFF /**< Position of a department that is not in the heap */
+
+/**
+ * @brief Departments ordered by a key, largest first.
+ *
+ * Equal keys come out lowest department first, so a heap gives the same order
+ * as a stable sort of the departments.
+ */
+typedef struct {
+    int32_t keys[NUM_DEPARTMENTS];      /**< Key of each department */
+    uint8_t order[NUM_DEPARTMENTS];     /**< Departments in heap order, top first */
+    uint8_t position[NUM_DEPARTMENTS];  /**< Index of each department in order, or DEPARTMENT_HEAP_ABSENT */
+    uint8_t count;                      /**< Departments in the heap */
+} DepartmentHeap;
+
+void departmentHeapBuild(DepartmentHeap *heap, const int32_t keys[NUM_DEPARTMENTS], int exclude);
+void departmentHeapUpdate(DepartmentHeap *heap, uint8_t department, int32_t key);
+int departmentHeapTop(const DepartmentHeap *heap);
+int departmentHeapPop(DepartmentHeap *heap);
+
+#endif /* INC_DEPARTMENT_HEAP_H_ */
@@ -23,163 +23,1072 @@
 #include "fire.h"
 #include "ambulance.h"
 #include "corona.h"
+#include "profiler.h"
+#include "checkpoint.h"
+#include "scenario.h"
+#include "rebalancer.h"
+#include "history.h"
+#include "incident.h"
+#include "rta.h"
+#include "preemption.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
 // Global variables for dispatcher
-QueueHandle_t dispatchQueue;                     /**< Queue for dispatch requests */
-SemaphoreHandle_t dispatchSemaphore;            /**< Semaphore for dispatcher resource access */
+SemaphoreHandle_t reallocationSemaphore;        /**< Serializes cross-department reallocation */
+#if !VEHICLE_ALLOCATION_BATCHED
+static LockStats reallocationLockStats;         /**< Acquisitions and hold times of reallocationSemaphore */
+#endif
 SemaphoreHandle_t policeCompletionSemaphore;    /**< Semaphore for Police task completion */
 SemaphoreHandle_t fireCompletionSemaphore;      /**< Semaphore for Fire task completion */
 SemaphoreHandle_t ambulanceCompletionSemaphore; /**< Semaphore for Ambulance task completion */
 SemaphoreHandle_t coronaCompletionSemaphore;    /**< Semaphore for Corona task completion */
 
 /**
- * @brief Initializes dispatcher resources, including semaphores and tasks.
+ * @brief Incidents a shard has accepted and not yet completed, oldest first.
  *
- * This function creates the necessary semaphores and initializes the task for handling
- * random events. It also initializes a queue for dispatch requests.
+ * Mirrors the incidents in the shard's intake queue plus the ones it is
+ * handling, so the checkpoint can save them; the queue itself cannot be
+ * inspected. It is also where a shard picks its next incident from, in
+ * arrival or deadline order, and in timer mode incidents may complete out of
+ * order.
  */
-void initDispatcher(void) {
-    srand(time(NULL)); // Seed the random number generator
+typedef struct {
+    DispatchRequest requests[DISPATCH_SHARD_QUEUE_LENGTH];
+    bool inProgress[DISPATCH_SHARD_QUEUE_LENGTH]; /**< The incident is being handled */
+    uint8_t count;                                /**< Number of outstanding incidents */
+} ShardBacklog;
+
+/**
+ * @brief Event in a shard's intake queue.
+ */
+typedef struct {
+    uint8_t type;                /**< SHARD_EVENT_NEW, SHARD_EVENT_COMPLETED or SHARD_EVENT_PREEMPTED */
+    DispatchRequest request;     /**< The incident */
+} ShardEvent;
+
+#define SHARD_EVENT_NEW 1        /**< Incident accepted and added to the backlog */
+#define SHARD_EVENT_COMPLETED 2  /**< Incident lifecycle finished (timer mode) */
+#define SHARD_EVENT_PREEMPTED 3  /**< Incident lost its vehicles and is pending again */
+
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_TASKS && NUM_DEPARTMENTS != 4
+#error "Department tasks exist for Police, Fire, Ambulance and Corona only; use timer or protothread incidents"
+#endif
+
+static QueueHandle_t shardQueues[NUM_DEPARTMENTS];    /**< Intake queue of each department's shard */
+static TaskHandle_t shardTasks[NUM_DEPARTMENTS];      /**< Task of each department's shard */
+static SemaphoreHandle_t shardSlots[NUM_DEPARTMENTS]; /**< Free backlog slots of each shard */
+static ShardBacklog shardBacklogs[NUM_DEPARTMENTS];   /**< Outstanding incidents of each shard */
+static uint32_t droppedIncidents[NUM_DEPARTMENTS];    /**< Incidents that found their shard's backlog full */
+static uint16_t nextIncidentId = 0;          /**< Identifier of the next generated incident */
+static uint32_t randomState = 1;             /**< xorshift32 state of the event generator */
+static TickType_t simulationTimeBase = 0;    /**< Simulated time at scheduler tick 0 */
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_TASKS
+static TickType_t handlingTimes[NUM_DEPARTMENTS] = {0}; /**< Handling time of each department's current incident */
+#endif
+static volatile DispatchOrder dispatchOrder = DISPATCH_ORDER_DEFAULT; /**< Order of pending incidents */
+static const uint16_t deadlinesMs[4][SEVERITY_COUNT] = INCIDENT_DEADLINE_MS;
+static const uint16_t extraDeadlinesMs[SEVERITY_COUNT] = EXTRA_DEPARTMENT_DEADLINE_MS; /**< Departments past the first four */
+
+/**
+ * @brief Returns the next value of the event generator.
+ *
+ * A xorshift32 generator is used instead of `rand()` so that its whole state
+ * fits in one word and can be saved in a checkpoint. The event generator and
+ * the shards (handling times) both draw from it, so the update is a critical
+ * section; otherwise a preempted draw would repeat or lose a value.
+ *
+ * @return A pseudo-random 32-bit value.
+ */
+uint32_t dispatcherRandom(void) {
+    taskENTER_CRITICAL();
+    uint32_t x = randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    randomState = x;
+    taskEXIT_CRITICAL();
+    return x;
+}
+
+/**
+ * @brief Gets the state of the event generator.
+ *
+ * @return The generator state.
+ */
+uint32_t getRandomState(void) {
+    return randomState;
+}
+
+/**
+ * @brief Sets the state of the event generator.
+ *
+ * @param state The generator state; zero is replaced by one, since xorshift
+ *              would be stuck at zero.
+ */
+void setRandomState(uint32_t state) {
+    randomState = (state != 0) ? state : 1;
+}
+
+/**
+ * @brief Gets the simulated clock.
+ *
+ * The simulated clock continues from the restored checkpoint time rather than
+ * from zero at every boot.
+ *
+ * @return The simulated time in ticks.
+ */
+TickType_t getSimulationTime(void) {
+    return simulationTimeBase + xTaskGetTickCount();
+}
+
+/**
+ * @brief Sets the simulated clock.
+ *
+ * @param now The simulated time in ticks.
+ */
+void setSimulationTime(TickType_t now) {
+    simulationTimeBase = now - xTaskGetTickCount();
+}
+
+/**
+ * @brief Picks the department of a new incident using the scenario weights.
+ *
+ * @return The department index (POLICE, FIRE, etc.).
+ */
+static uint8_t randomDepartment(void) {
+    const Scenario *config = scenarioGet();
+    uint32_t totalWeight = 0;
+
+    for (int i = 0; i < config->departmentCount; i++) {
+        totalWeight += config->departments[i].arrivalWeight;
+    }
+    if (totalWeight == 0) {
+        return dispatcherRandom() % config->departmentCount;
+    }
+
+    uint32_t pick = dispatcherRandom() % totalWeight;
+    for (int i = 0; i < config->departmentCount; i++) {
+        if (pick < config->departments[i].arrivalWeight) {
+            return (uint8_t)i;
+        }
+        pick -= config->departments[i].arrivalWeight;
+    }
+    return 0;
+}
+
+/**
+ * @brief Draws the handling time of an incident from the department's range.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return The handling time in ticks.
+ */
+static TickType_t randomHandlingTime(uint8_t department) {
+    const DepartmentConfig *config = scenarioDepartment(department);
+    uint32_t span = config->handleMaxMs - config->handleMinMs;
+    uint32_t ms = config->handleMinMs + ((span > 0) ? dispatcherRandom() % (span + 1) : 0);
+    return pdMS_TO_TICKS(ms);
+}
+
+/**
+ * @brief Gets the handling time of the incident dispatched to a department.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return The handling time in ticks.
+ */
+TickType_t getIncidentHandlingTime(uint8_t department) {
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_TASKS
+    return (department < NUM_DEPARTMENTS) ? handlingTimes[department] : 0;
+#else
+    (void)department;
+    return 0; // Incidents carry their own handling time
+#endif
+}
+
+/**
+ * @brief Picks the severity of a new incident using SEVERITY_WEIGHTS.
+ *
+ * @return The IncidentSeverity.
+ */
+static uint8_t randomSeverity(void) {
+    static const uint8_t weights[SEVERITY_COUNT] = SEVERITY_WEIGHTS;
+    uint32_t totalWeight = 0;
+
+    for (int i = 0; i < SEVERITY_COUNT; i++) {
+        totalWeight += weights[i];
+    }
+    uint32_t pick = (totalWeight > 0) ? dispatcherRandom() % totalWeight : 0;
+    for (uint8_t i = 0; i < SEVERITY_COUNT; i++) {
+        if (pick < weights[i]) {
+            return i;
+        }
+        pick -= weights[i];
+    }
+    return SEVERITY_LOW;
+}
+
+/**
+ * @brief Gets the response-time target of an incident class.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param severity The IncidentSeverity.
+ * @return The target in milliseconds from arrival to completion.
+ */
+uint32_t getDeadlineMs(uint8_t department, uint8_t severity) {
+    if (department >= NUM_DEPARTMENTS || severity >= SEVERITY_COUNT) {
+        return 0;
+    }
+    return (department < 4) ? deadlinesMs[department][severity] : extraDeadlinesMs[severity];
+}
+
+/**
+ * @brief Gets the absolute deadline of an incident.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param severity The IncidentSeverity.
+ * @param arrivalTime Simulated time the incident was generated.
+ * @return The simulated time by which the incident must be completed.
+ */
+TickType_t getIncidentDeadline(uint8_t department, uint8_t severity, TickType_t arrivalTime) {
+    return arrivalTime + pdMS_TO_TICKS(getDeadlineMs(department, severity));
+}
+
+/**
+ * @brief Gets the order in which shards serve their pending incidents.
+ *
+ * @return The dispatch order.
+ */
+DispatchOrder getDispatchOrder(void) {
+    return dispatchOrder;
+}
+
+/**
+ * @brief Sets the order in which shards serve their pending incidents.
+ *
+ * Takes effect with the next incident each shard picks.
+ *
+ * @param order The dispatch order.
+ */
+void setDispatchOrder(DispatchOrder order) {
+    dispatchOrder = order;
+}
+
+/**
+ * @brief Gets the number of incidents a department is currently handling.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return The number of incidents in progress.
+ */
+int getInFlightCount(uint8_t department) {
+    int inFlight = 0;
+
+    if (department >= NUM_DEPARTMENTS) {
+        return 0;
+    }
+    taskENTER_CRITICAL();
+    for (int i = 0; i < shardBacklogs[department].count; i++) {
+        inFlight += shardBacklogs[department].inProgress[i] ? 1 : 0;
+    }
+    taskEXIT_CRITICAL();
+    return inFlight;
+}
+
+/**
+ * @brief Gets the number of vehicles committed to a department's incidents in progress.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return The number of committed vehicles.
+ */
+int getCommittedVehicles(uint8_t department) {
+    int committed = 0;
+
+    if (department >= NUM_DEPARTMENTS) {
+        return 0;
+    }
+    taskENTER_CRITICAL();
+    const ShardBacklog *backlog = &shardBacklogs[department];
+    for (int i = 0; i < backlog->count; i++) {
+        if (backlog->inProgress[i]) {
+            committed += backlog->requests[i].requiredVehicles;
+        }
+    }
+    taskEXIT_CRITICAL();
+    return committed;
+}
+
+/**
+ * @brief Gets the vehicles a department's other incidents in progress hold.
+ *
+ * A shard marks its incident in progress before allocating vehicles for it, so
+ * the vehicles being allocated are part of the committed ones and are left out.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param allocating Vehicles of the department's incidents being allocated.
+ * @return The busy vehicles, 0 for callers without an incident in progress (e.g. the benchmark).
+ */
+int getBusyVehicles(uint8_t department, int allocating) {
+    int busy = getCommittedVehicles(department) - allocating;
+    return (busy > 0) ? busy : 0;
+}
+
+/**
+ * @brief Gets the number of incidents waiting for a department's shard.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return The number of queued requests.
+ */
+UBaseType_t getShardQueueDepth(uint8_t department) {
+    if (department >= NUM_DEPARTMENTS) {
+        return 0;
+    }
+    return (UBaseType_t)(shardBacklogs[department].count - getInFlightCount(department));
+}
+
+/**
+ * @brief Gets how long a department's oldest pending incident has been waiting.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return The waiting time in ticks, 0 if no incident is pending.
+ */
+TickType_t getOldestPendingAge(uint8_t department) {
+    TickType_t oldest = 0;
+    bool found = false;
+
+    if (department >= NUM_DEPARTMENTS) {
+        return 0;
+    }
+    taskENTER_CRITICAL();
+    const ShardBacklog *backlog = &shardBacklogs[department];
+    for (int i = 0; i < backlog->count && !found; i++) {
+        if (!backlog->inProgress[i]) {
+            oldest = backlog->requests[i].arrivalTime; // The backlog is in arrival order
+            found = true;
+        }
+    }
+    taskEXIT_CRITICAL();
+    return found ? getSimulationTime() - oldest : 0;
+}
+
+/**
+ * @brief Gets the number of incidents dropped because a department's backlog was full.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return The number of dropped incidents.
+ */
+uint32_t getDroppedIncidents(uint8_t department) {
+    return (department < NUM_DEPARTMENTS) ? droppedIncidents[department] : 0;
+}
+
+/**
+ * @brief Gets the task of a department's dispatcher shard.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return The task handle, NULL before `initDispatcher`.
+ */
+TaskHandle_t getShardTask(uint8_t department) {
+    return (department < NUM_DEPARTMENTS) ? shardTasks[department] : NULL;
+}
+
+/**
+ * @brief Gets the number of dispatch requests waiting in all intake queues.
+ *
+ * @return The number of queued requests.
+ */
+UBaseType_t getDispatchQueueDepth(void) {
+    UBaseType_t depth = 0;
+    for (uint8_t i = 0; i < NUM_DEPARTMENTS; i++) {
+        depth += getShardQueueDepth(i);
+    }
+    return depth;
+}
+
+/**
+ * @brief Gets the oldest incident a department is currently handling.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param request Output request, valid only if true is returned.
+ * @return True if the department has an incident in progress.
+ */
+bool getIncidentInProgress(uint8_t department, DispatchRequest *request) {
+    bool valid = false;
+
+    if (department >= NUM_DEPARTMENTS) {
+        return false;
+    }
+    taskENTER_CRITICAL();
+    const ShardBacklog *backlog = &shardBacklogs[department];
+    for (int i = 0; i < backlog->count && !valid; i++) {
+        if (backlog->inProgress[i]) {
+            *request = backlog->requests[i];
+            valid = true;
+        }
+    }
+    taskEXIT_CRITICAL();
+    return valid;
+}
+
+/**
+ * @brief Copies the incidents a department is currently handling.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param requests Output array.
+ * @param maxRequests Capacity of the output array.
+ * @return Number of incidents copied, oldest first.
+ */
+int getIncidentsInProgress(uint8_t department, DispatchRequest *requests, int maxRequests) {
+    int count = 0;
+
+    if (department >= NUM_DEPARTMENTS) {
+        return 0;
+    }
+    taskENTER_CRITICAL();
+    const ShardBacklog *backlog = &shardBacklogs[department];
+    for (int i = 0; i < backlog->count && count < maxRequests; i++) {
+        if (backlog->inProgress[i]) {
+            requests[count++] = backlog->requests[i];
+        }
+    }
+    taskEXIT_CRITICAL();
+    return count;
+}
+
+/**
+ * @brief Copies every accepted but not yet completed incident.
+ *
+ * Incidents are grouped by department, oldest first within a department.
+ *
+ * @param requests Output array.
+ * @param maxRequests Capacity of the output array.
+ * @return Number of incidents copied.
+ */
+int getOutstandingIncidents(DispatchRequest *requests, int maxRequests) {
+    int count = 0;
+
+    taskENTER_CRITICAL();
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        const ShardBacklog *backlog = &shardBacklogs[i];
+        for (int j = 0; j < backlog->count && count < maxRequests; j++) {
+            requests[count++] = backlog->requests[j];
+        }
+    }
+    taskEXIT_CRITICAL();
+    return count;
+}
+
+/**
+ * @brief Appends an incident to its shard's backlog and intake queue.
+ *
+ * The caller must own a free slot of the shard, so neither can be full.
+ *
+ * @param request The incident.
+ */
+static void shardAccept(const DispatchRequest *request) {
+    ShardBacklog *backlog = &shardBacklogs[request->department];
+    ShardEvent event = {.type = SHARD_EVENT_NEW, .request = *request};
+
+    taskENTER_CRITICAL();
+    backlog->requests[backlog->count] = *request;
+    backlog->inProgress[backlog->count] = false;
+    backlog->count++;
+    taskEXIT_CRITICAL();
+    xQueueSend(shardQueues[request->department], &event, 0);
+}
 
-    dispatchQueue = xQueueCreate(10, sizeof(DispatchRequest));
-    dispatchSemaphore = xSemaphoreCreateBinary();
+/**
+ * @brief Picks a shard's next pending incident and marks it as being handled.
+ *
+ * With DISPATCH_ORDER_EDF the incident with the earliest deadline is picked,
+ * the oldest one among equal deadlines; otherwise the oldest one.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param request Output request, valid only if true is returned.
+ * @return True if the shard had a pending incident.
+ */
+static bool shardNextPending(uint8_t department, DispatchRequest *request) {
+    ShardBacklog *backlog = &shardBacklogs[department];
+    bool edf = dispatchOrder == DISPATCH_ORDER_EDF;
+    int next = -1;
+
+    taskENTER_CRITICAL();
+    for (int i = 0; i < backlog->count; i++) {
+        if (backlog->inProgress[i]) {
+            continue;
+        }
+        if (next < 0) {
+            next = i;
+            if (!edf) {
+                break;
+            }
+        } else if ((int32_t)(backlog->requests[i].deadline - backlog->requests[next].deadline) < 0) {
+            next = i;
+        }
+    }
+    if (next >= 0) {
+        backlog->inProgress[next] = true;
+        *request = backlog->requests[next];
+    }
+    taskEXIT_CRITICAL();
+    return next >= 0;
+}
+
+/**
+ * @brief Removes a completed incident from its shard's backlog.
+ *
+ * @param request The incident.
+ */
+static void shardComplete(const DispatchRequest *request) {
+    ShardBacklog *backlog = &shardBacklogs[request->department];
+
+    taskENTER_CRITICAL();
+    for (int i = 0; i < backlog->count; i++) {
+        if (backlog->requests[i].id == request->id) {
+            for (int j = i + 1; j < backlog->count; j++) {
+                backlog->requests[j - 1] = backlog->requests[j];
+                backlog->inProgress[j - 1] = backlog->inProgress[j];
+            }
+            backlog->count--;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+    xSemaphoreGive(shardSlots[request->department]);
+}
+
+/**
+ * @brief Hands restored incidents back to their shards.
+ *
+ * Used to resume the incidents that were outstanding when a checkpoint was
+ * taken; they are handled again from the start, or with the time they had
+ * left if they were preempted. Must be called after
+ * `initDispatcherResources` and before the scheduler starts; incidents beyond
+ * a shard's capacity are dropped.
+ *
+ * @param requests The incidents, oldest first within a department.
+ * @param count Number of incidents.
+ */
+void restoreOutstandingIncidents(const DispatchRequest *requests, int count) {
+    for (int i = 0; i < count; i++) {
+        if (requests[i].department >= NUM_DEPARTMENTS || xSemaphoreTake(shardSlots[requests[i].department], 0) != pdTRUE) {
+            LOG_WARN(LOG_MODULE_DISPATCHER, "Restored incident %d dropped\r\n", i);
+            continue;
+        }
+        // Keep new identifiers clear of the restored ones
+        if ((int16_t)(requests[i].id - nextIncidentId) >= 0) {
+            nextIncidentId = requests[i].id + 1;
+        }
+        shardAccept(&requests[i]);
+    }
+}
+
+#if INCIDENT_HANDLER_MODE != INCIDENT_HANDLER_TASKS
+/**
+ * @brief Takes the vehicles of an incident in progress and requeues it.
+ *
+ * The incident goes back to its shard's pending incidents with the handling
+ * time it had left plus PREEMPTION_RESTART_MS, and its vehicles no longer
+ * count as committed, so they can be lent at once.
+ *
+ * @param request The incident.
+ * @return True if it was preempted, false if it is no longer in progress.
+ */
+bool preemptIncident(const DispatchRequest *request) {
+    ShardBacklog *backlog = &shardBacklogs[request->department];
+    ShardEvent event = {.type = SHARD_EVENT_PREEMPTED, .request = *request};
+    TickType_t remaining;
+#if CHECKPOINT_ENABLED
+    DispatchRequest requeued;
+    bool requeuedFound = false;
+#endif
+
+    if (request->department >= NUM_DEPARTMENTS || !incidentPreempt(request->id, &remaining)) {
+        return false;
+    }
+#if CHECKPOINT_ENABLED
+    // The progress and its journal record must not be split by a snapshot
+    checkpointLock();
+#endif
+    taskENTER_CRITICAL();
+    for (int i = 0; i < backlog->count; i++) {
+        if (backlog->requests[i].id == request->id) {
+            backlog->inProgress[i] = false;
+            backlog->requests[i].remainingTime = remaining + pdMS_TO_TICKS(PREEMPTION_RESTART_MS);
+            backlog->requests[i].preemptions++;
+#if CHECKPOINT_ENABLED
+            requeued = backlog->requests[i];
+            requeuedFound = true;
+#endif
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+#if CHECKPOINT_ENABLED
+    if (requeuedFound) {
+        checkpointJournalPreemption(&requeued);
+    }
+    checkpointUnlock();
+#endif
+    // Takes the queue room of the completion that will not come
+    xQueueSend(shardQueues[request->department], &event, 0);
+    return true;
+}
+
+/**
+ * @brief Incident lifecycle callback: passes a completed incident back to its shard.
+ *
+ * Runs in the timer (or incident worker) task, so the shard does the bookkeeping.
+ *
+ * @param request The completed incident.
+ */
+static void incidentDone(const DispatchRequest *request) {
+    ShardEvent event = {.type = SHARD_EVENT_COMPLETED, .request = *request};
+
+    // The queue has room for a completion of every outstanding incident
+    xQueueSend(shardQueues[request->department], &event, 0);
+}
+#endif
+
+/**
+ * @brief Initializes dispatcher resources without starting the dispatcher tasks.
+ *
+ * This function creates the intake queue of every shard and the necessary semaphores.
+ * Used on its own by the benchmark, which drives the allocation functions directly.
+ */
+void initDispatcherResources(void) {
+    bool created = true;
+
+    setRandomState((uint32_t)time(NULL)); // Seed the random number generator
+
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        // Room for every outstanding incident plus its completion event
+        shardQueues[i] = xQueueCreate(2 * DISPATCH_SHARD_QUEUE_LENGTH, sizeof(ShardEvent));
+        shardSlots[i] = xSemaphoreCreateCounting(DISPATCH_SHARD_QUEUE_LENGTH, DISPATCH_SHARD_QUEUE_LENGTH);
+        created = created && shardQueues[i] != NULL && shardSlots[i] != NULL;
+    }
+    reallocationSemaphore = xSemaphoreCreateBinary();
 
     policeCompletionSemaphore = xSemaphoreCreateBinary();
     fireCompletionSemaphore = xSemaphoreCreateBinary();
     ambulanceCompletionSemaphore = xSemaphoreCreateBinary();
     coronaCompletionSemaphore = xSemaphoreCreateBinary();
 
-    if (dispatchQueue != NULL && dispatchSemaphore != NULL &&
+    if (created && reallocationSemaphore != NULL &&
         policeCompletionSemaphore != NULL && fireCompletionSemaphore != NULL &&
         ambulanceCompletionSemaphore != NULL && coronaCompletionSemaphore != NULL) {
-        logMessage("Dispatcher resources initialized successfully\r\n");
+        LOG_INFO(LOG_MODULE_DISPATCHER, "Dispatcher resources initialized successfully\r\n");
     } else {
-        logMessage("Dispatcher resource initialization failed\r\n");
+        LOG_ERROR(LOG_MODULE_DISPATCHER, "Dispatcher resource initialization failed\r\n");
+    }
+    xSemaphoreGive(reallocationSemaphore);
+#if !VEHICLE_ALLOCATION_BATCHED
+    profilerRegisterLock("reallocation", &reallocationLockStats);
+#endif
+#if INCIDENT_HANDLER_MODE != INCIDENT_HANDLER_TASKS
+    initIncidents(incidentDone);
+#endif
+}
+
+/**
+ * @brief Initializes dispatcher resources, including semaphores and tasks.
+ *
+ * This function creates the necessary semaphores and queues, the task that
+ * generates random events and one dispatcher shard task per department.
+ */
+void initDispatcher(void) {
+    initDispatcherResources();
+    xTaskCreate(randomEventTask, "RandomEvent", scenarioGet()->dispatcherStackWords, NULL_PARAM,
+                scenarioGet()->dispatcherPriority, NULL_PARAM);
+    for (uintptr_t i = 0; i < NUM_DEPARTMENTS; i++) {
+        char taskName[configMAX_TASK_NAME_LEN];
+        snprintf(taskName, sizeof(taskName), "%sShard", departmentName((uint8_t)i)); // PoliceShard, Dept4Shard...
+        if (xTaskCreate(dispatchShardTask, taskName, DISPATCH_SHARD_STACK_SIZE, (void *)i,
+                        DISPATCH_SHARD_PRIORITY, &shardTasks[i]) != pdPASS) {
+            LOG_ERROR(LOG_MODULE_DISPATCHER, "Failed to create %s task\r\n", taskName);
+        }
     }
+}
 
-    xTaskCreate(randomEventAndDispatchTask, "RandomEvent", RANDOM_EVENT_STACK_SIZE, NULL_PARAM, RANDOM_EVENT_PRIORITY, NULL_PARAM);
-    xSemaphoreGive(dispatchSemaphore);
+/**
+ * @brief Gets the severity an allocation counts as for the reserve floors.
+ *
+ * A request that has waited RESERVE_OVERRIDE_AFTER_MS for vehicles counts as
+ * severe enough to borrow reserve vehicles, so large routine incidents cannot
+ * starve behind the floors.
+ *
+ * @param severity The incident's IncidentSeverity.
+ * @param waitingSince When the allocation started.
+ * @return The severity to allocate with.
+ */
+static uint8_t reserveSeverity(uint8_t severity, TickType_t waitingSince) {
+    if ((xTaskGetTickCount() - waitingSince) >= pdMS_TO_TICKS(RESERVE_OVERRIDE_AFTER_MS) &&
+        severity < RESERVE_OVERRIDE_SEVERITY) {
+        return RESERVE_OVERRIDE_SEVERITY;
+    }
+    return severity;
+}
+
+static void completeIncident(const DispatchRequest *request, bool allocated);
+
+/**
+ * @brief Waits a tick for vehicles to be freed, recording the shard's own completions meanwhile.
+ *
+ * Completions reach a shard only through its intake queue. If a shard waiting
+ * for vehicles did not read it, its finished incidents would keep their
+ * vehicles committed and their backlog slots, and two shards waiting for each
+ * other's vehicles would never make progress. The other events need nothing
+ * here: the backlog already holds the incidents they announce, and the shard
+ * looks for pending ones after this allocation.
+ *
+ * @param department The department index (POLICE, FIRE, etc.) allocating.
+ */
+static void waitForVehicles(uint8_t department) {
+    ShardEvent event;
+
+    if (department >= NUM_DEPARTMENTS || xTaskGetCurrentTaskHandle() != shardTasks[department]) {
+        vTaskDelay(1); // Not called by the shard, e.g. by the benchmark
+        return;
+    }
+    if (xQueueReceive(shardQueues[department], &event, 1) != pdTRUE) {
+        return;
+    }
+    do {
+        if (event.type == SHARD_EVENT_COMPLETED) {
+            completeIncident(&event.request, true);
+        }
+    } while (xQueueReceive(shardQueues[department], &event, 0) == pdTRUE);
 }
 
 /**
  * @brief Checks if a department has enough vehicles. If not, triggers allocation/reallocation.
  *
  * This function determines if a department has sufficient vehicles to handle a request.
- * If not, it reallocates resources from other departments as needed.
+ * If not, it reallocates resources from other departments as needed. Only the
+ * reallocation is serialized between shards; a department with enough vehicles
+ * never waits for another one.
  *
  * @param department The department index (POLICE, FIRE, etc.).
  * @param requiredVehicles The number of vehicles required by the department.
+ * @param severity The IncidentSeverity, which decides whether lenders' reserve floors may be used.
  * @return True if the department has enough vehicles after allocation, False otherwise.
  */
-bool checkAndAllocateVehicles(uint8_t department, int requiredVehicles) {
-    const char *departmentNames[] = DEPARTMENT_NAMES;
+bool checkAndAllocateVehicles(uint8_t department, int requiredVehicles, uint8_t severity) {
+    TickType_t waitingSince = xTaskGetTickCount();
+#if VEHICLE_ALLOCATION_BATCHED
+    int availableVehicles = 0;
+    int borrowedVehicles = 0;
+
+    // Decided together with whatever the other shards are allocating right now
+    while (!allocateVehicles(department, requiredVehicles, reserveSeverity(severity, waitingSince),
+                             &availableVehicles, &borrowedVehicles)) {
+#if PREEMPTION_SUPPORTED
+        if (preemptForIncident(department, requiredVehicles, severity)) {
+            continue; // The preempted incidents' vehicles are idle now
+        }
+#endif
+        waitForVehicles(department); // Not enough idle vehicles anywhere; wait for a completion
+    }
+    if (borrowedVehicles > 0) {
+        recordBorrowSize(department, borrowedVehicles);
+        historyRecordBorrow(department, borrowedVehicles);
+    }
+    reserveRecordAllocation(department, requiredVehicles, availableVehicles, borrowedVehicles > 0);
+#if REBALANCER_ENABLED
+    rebalancerRecordAllocation(department, requiredVehicles, availableVehicles, borrowedVehicles > 0);
+#endif
+    return true;
+#else
+    // Vehicles of the department's other incidents in progress are not available
+    int availableVehicles = getVehicleCount(department) - getBusyVehicles(department, requiredVehicles);
+    bool borrowed = false;
 
     while (1) {
-        xSemaphoreTake(dispatchSemaphore, portMAX_DELAY); // Protect vehicle checks and allocation
-        int currentVehicles = getVehicleCount(department);
+        int currentVehicles = getVehicleCount(department) - getBusyVehicles(department, requiredVehicles);
 
         if (currentVehicles >= requiredVehicles) {
-            logMessage("%s department has enough vehicles to process the task\r\n",
-                       departmentNames[department]);
-            xSemaphoreGive(dispatchSemaphore);
+            LOG_DEBUG(LOG_MODULE_DISPATCHER, "%s department has enough vehicles to process the task\r\n",
+                      departmentName(department));
+            reserveRecordAllocation(department, requiredVehicles, availableVehicles, borrowed);
+#if REBALANCER_ENABLED
+            rebalancerRecordAllocation(department, requiredVehicles, availableVehicles, borrowed);
+#endif
             return true; // Enough vehicles available, task can proceed
-        } else {
-            int neededToBorrow = requiredVehicles - currentVehicles;
+        }
+
+        xSemaphoreTake(reallocationSemaphore, portMAX_DELAY); // Protect cross-department borrowing
+        lockStatsAcquired(&reallocationLockStats);
+        // Another shard may have moved vehicles while this one waited
+        int countBefore = getVehicleCount(department);
+        int neededToBorrow = requiredVehicles - (countBefore - getBusyVehicles(department, requiredVehicles));
 
-            logMessage("%s department needs %d more vehicles to fulfill the request\r\n",
-                       departmentNames[department], neededToBorrow);
+        if (neededToBorrow > 0) {
+            LOG_INFO_AGG(LOG_MODULE_DISPATCHER, department, "Short of vehicles", neededToBorrow,
+                         "%s department needs %d more vehicles to fulfill the request\r\n",
+                         departmentName(department), neededToBorrow);
 
-            DispatchRequest adjustedRequest = {.department = department, .requiredVehicles = neededToBorrow};
+            DispatchRequest adjustedRequest = {.department = department, .requiredVehicles = neededToBorrow,
+                                               .severity = reserveSeverity(severity, waitingSince)};
 
-            if (neededToBorrow > 0) {
-                logMessage("Insufficient vehicles for %s, reallocating\r\n",
-                           departmentNames[department]);
-                reallocateVehicles(adjustedRequest);
+            LOG_INFO_AGG(LOG_MODULE_DISPATCHER, department, "Reallocation triggered", 1,
+                         "Insufficient vehicles for %s, reallocating\r\n",
+                         departmentName(department));
+            reallocateVehicles(adjustedRequest);
+            borrowed = true;
+            // Still under reallocationSemaphore, so no other shard has borrowed meanwhile
+            int borrowedVehicles = getVehicleCount(department) - countBefore;
+            if (borrowedVehicles > 0) {
+                recordBorrowSize(department, borrowedVehicles);
+                historyRecordBorrow(department, borrowedVehicles);
             }
         }
-        xSemaphoreGive(dispatchSemaphore);
+        lockStatsReleased(&reallocationLockStats);
+        xSemaphoreGive(reallocationSemaphore);
 
         // Recheck the count after allocation/reallocation
-        currentVehicles = getVehicleCount(department);
+        currentVehicles = getVehicleCount(department) - getBusyVehicles(department, requiredVehicles);
         if (currentVehicles >= requiredVehicles) {
-            logMessage("%s department now has enough vehicles to process the task\r\n",
-                       departmentNames[department]);
+            LOG_DEBUG(LOG_MODULE_DISPATCHER, "%s department now has enough vehicles to process the task\r\n",
+                      departmentName(department));
+            reserveRecordAllocation(department, requiredVehicles, availableVehicles, borrowed);
+#if REBALANCER_ENABLED
+            rebalancerRecordAllocation(department, requiredVehicles, availableVehicles, borrowed);
+#endif
             return true;
         }
+        waitForVehicles(department); // The lenders are at their floors or busy; wait for a completion
     }
+#endif
 }
 
 /**
- * @brief Handles random events and dispatches tasks to appropriate departments.
+ * @brief Generates random events and hands each one to its department's shard.
  *
- * This task generates random events for departments, checks resource availability,
- * and signals the corresponding department task to handle the event.
+ * The generator never waits for a shard: an incident whose department's
+ * backlog is full (the shard is waiting for vehicles, say) is dropped and
+ * counted, so the other departments keep getting theirs.
  *
  * @param params Task parameters (unused).
  */
-void randomEventAndDispatchTask(void *params) {
-    const char *departmentNames[] = DEPARTMENT_NAMES;
-
+void randomEventTask(void *params) {
     while (1) {
         DispatchRequest request;
-        request.department = rand() % 4;  // Random department
-        request.requiredVehicles = (rand() % MAX_CARS) + 1;  // Random vehicles (1-7)
-
-        logMessage("Random event for department %s requesting %d vehicles\r\n",
-                   departmentNames[request.department], request.requiredVehicles);
-
-        logMessage("Current vehicle counts - Police:%d | Fire:%d | Ambulance:%d | Corona:%d\r\n",
-                   getVehicleCount(POLICE), getVehicleCount(FIRE),
-                   getVehicleCount(AMBULANCE), getVehicleCount(CORONA));
-
-        if (checkAndAllocateVehicles(request.department, request.requiredVehicles)) {
-            // Signal the corresponding department
-            switch (request.department) {
-                case POLICE:
-                    if (policeSemaphore != NULL) {
-                        xSemaphoreGive(policeSemaphore);
-                        logMessage("Police notification given\r\n");
-                        xSemaphoreTake(policeCompletionSemaphore, portMAX_DELAY);
-                        logMessage("\n*******************Police task completed*******************\r\n");
-                    }
-                    break;
-
-                case FIRE:
-                    if (fireSemaphore != NULL) {
-                        xSemaphoreGive(fireSemaphore);
-                        logMessage("Fire notification given\r\n");
-                        xSemaphoreTake(fireCompletionSemaphore, portMAX_DELAY);
-                        logMessage("\n*******************Fire task completed*******************\r\n");
-                    }
-                    break;
-
-                case AMBULANCE:
-                    if (ambulanceSemaphore != NULL) {
-                        xSemaphoreGive(ambulanceSemaphore);
-                        logMessage("Ambulance notification given\r\n");
-                        xSemaphoreTake(ambulanceCompletionSemaphore, portMAX_DELAY);
-                        logMessage("\n*******************Ambulance task completed*******************\r\n");
-                    }
-                    break;
-
-                case CORONA:
-                    if (coronaSemaphore != NULL) {
-                        xSemaphoreGive(coronaSemaphore);
-                        logMessage("Corona notification given\r\n");
-                        xSemaphoreTake(coronaCompletionSemaphore, portMAX_DELAY);
-                        logMessage("\n*******************Corona task completed*******************\r\n");
-                    }
-                    break;
-
-                default:
-                    logMessage("Invalid department generated\r\n");
-                    break;
-            }
+        PROFILE_BEGIN(PROF_GENERATE_INCIDENT);
+        request.department = randomDepartment();
+        request.requiredVehicles = (dispatcherRandom() % scenarioGet()->maxCars) + 1;  // Random vehicles (1-max_cars)
+        request.severity = randomSeverity();
+        request.arrivalTime = getSimulationTime();
+        request.deadline = getIncidentDeadline(request.department, request.severity, request.arrivalTime);
+        request.id = nextIncidentId++;
+        request.preemptions = 0;
+        request.remainingTime = 0;
+#if REBALANCER_ENABLED
+        rebalancerRecordDemand(request.department, request.requiredVehicles);
+#endif
+
+        LOG_INFO_AGG(LOG_MODULE_DISPATCHER, request.department, "Random event", request.requiredVehicles,
+                     "Random event for department %s requesting %d vehicles\r\n",
+                     departmentName(request.department), request.requiredVehicles);
+        PROFILE_END(PROF_GENERATE_INCIDENT);
+
+        if (xSemaphoreTake(shardSlots[request.department], 0) != pdTRUE) {
+            droppedIncidents[request.department]++;
+            LOG_INFO_AGG(LOG_MODULE_DISPATCHER, request.department, "Incident dropped", 1,
+                         "%s backlog full, incident %u dropped\r\n", departmentName(request.department),
+                         (unsigned)request.id);
+        } else {
+#if CHECKPOINT_ENABLED
+            // The incident and its journal record must not be split by a snapshot
+            checkpointLock();
+            shardAccept(&request);
+            checkpointJournalArrival(&request);
+            checkpointUnlock();
+#else
+            shardAccept(&request);
+#endif
         }
 
         // Delay before generating the next random event
-        vTaskDelay(Short_DELAY);
+#if STACK_MONITOR_STRESS
+        vTaskDelay(STRESS_EVENT_DELAY);
+#else
+        vTaskDelay(pdMS_TO_TICKS(scenarioGet()->arrivalMs));
+#endif
+    }
+}
+
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_TASKS
+/**
+ * @brief Signals a department task and waits until it has handled the incident.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ */
+static void handOffToDepartment(uint8_t department) {
+    switch (department) {
+        case POLICE:
+            if (policeSemaphore != NULL) {
+                xSemaphoreGive(policeSemaphore);
+                LOG_DEBUG(LOG_MODULE_DISPATCHER, "Police notification given\r\n");
+                xSemaphoreTake(policeCompletionSemaphore, portMAX_DELAY);
+                LOG_INFO_AGG(LOG_MODULE_DISPATCHER, POLICE, "Task completed", 1,
+                             "\n*******************Police task completed*******************\r\n");
+            }
+            break;
+
+        case FIRE:
+            if (fireSemaphore != NULL) {
+                xSemaphoreGive(fireSemaphore);
+                LOG_DEBUG(LOG_MODULE_DISPATCHER, "Fire notification given\r\n");
+                xSemaphoreTake(fireCompletionSemaphore, portMAX_DELAY);
+                LOG_INFO_AGG(LOG_MODULE_DISPATCHER, FIRE, "Task completed", 1,
+                             "\n*******************Fire task completed*******************\r\n");
+            }
+            break;
+
+        case AMBULANCE:
+            if (ambulanceSemaphore != NULL) {
+                xSemaphoreGive(ambulanceSemaphore);
+                LOG_DEBUG(LOG_MODULE_DISPATCHER, "Ambulance notification given\r\n");
+                xSemaphoreTake(ambulanceCompletionSemaphore, portMAX_DELAY);
+                LOG_INFO_AGG(LOG_MODULE_DISPATCHER, AMBULANCE, "Task completed", 1,
+                             "\n*******************Ambulance task completed*******************\r\n");
+            }
+            break;
+
+        case CORONA:
+            if (coronaSemaphore != NULL) {
+                xSemaphoreGive(coronaSemaphore);
+                LOG_DEBUG(LOG_MODULE_DISPATCHER, "Corona notification given\r\n");
+                xSemaphoreTake(coronaCompletionSemaphore, portMAX_DELAY);
+                LOG_INFO_AGG(LOG_MODULE_DISPATCHER, CORONA, "Task completed", 1,
+                             "\n*******************Corona task completed*******************\r\n");
+            }
+            break;
+
+        default:
+            LOG_ERROR(LOG_MODULE_DISPATCHER, "Invalid department generated\r\n");
+            break;
+    }
+}
+
+#endif
+
+/**
+ * @brief Records a completed incident and frees its backlog slot.
+ *
+ * @param request The incident.
+ * @param allocated True if the incident got its vehicles and was handled.
+ */
+static void completeIncident(const DispatchRequest *request, bool allocated) {
+    const char *severityNames[] = SEVERITY_NAMES;
+    uint8_t department = request->department;
+    TickType_t now = getSimulationTime();
+    int32_t latenessMs = (int32_t)(now - request->deadline) * (int32_t)portTICK_PERIOD_MS;
+    // An incident that was never served has missed its deadline as well
+    bool missed = !allocated || latenessMs > 0;
+    uint32_t responseMs = (now - request->arrivalTime) * portTICK_PERIOD_MS;
+
+    PROFILE_BEGIN(PROF_COMPLETE_INCIDENT);
+#if CHECKPOINT_ENABLED
+    checkpointLock();
+#endif
+    recordDeadlineResult(department, request->severity, missed, latenessMs);
+    if (allocated) {
+        recordTaskExecution(department);
+        recordVehicleUsage(department, request->requiredVehicles);
+        recordResponseTime(department, responseMs);
+        recordSeverityResponseTime(request->severity, responseMs);
+        historyRecordIncident(department, request->requiredVehicles, missed);
+        rtaRecordResponse(department, responseMs);
+    }
+#if CHECKPOINT_ENABLED
+    checkpointJournalCompletion(request, allocated, responseMs, latenessMs);
+#endif
+    shardComplete(request);
+#if CHECKPOINT_ENABLED
+    checkpointUnlock();
+#endif
+    PROFILE_END(PROF_COMPLETE_INCIDENT);
+
+    if (!allocated) {
+        LOG_WARN(LOG_MODULE_DISPATCHER, "%s incident %u (%s) not served\r\n", departmentName(department),
+                 (unsigned)request->id, severityNames[request->severity % SEVERITY_COUNT]);
+    } else if (missed) {
+        LOG_WARN(LOG_MODULE_DISPATCHER, "%s incident %u (%s) missed its deadline by %ld ms\r\n",
+                 departmentName(department), (unsigned)request->id,
+                 severityNames[request->severity % SEVERITY_COUNT], (long)latenessMs);
+    }
+}
+
+/**
+ * @brief Allocates vehicles for an incident and starts handling it.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param request The incident, already marked as being handled.
+ */
+static void dispatchIncident(uint8_t department, const DispatchRequest *request) {
+    LOG_DEBUG(LOG_MODULE_DISPATCHER, "Current vehicle count - %s:%d\r\n", departmentName(department),
+              getVehicleCount(department));
+
+    PROFILE_BEGIN(PROF_CHECK_AND_ALLOCATE);
+    bool allocated = checkAndAllocateVehicles(department, request->requiredVehicles, request->severity);
+    PROFILE_END(PROF_CHECK_AND_ALLOCATE);
+    if (allocated) {
+        rtaRecordDispatch(department, (getSimulationTime() - request->arrivalTime) * portTICK_PERIOD_MS);
+    }
+
+#if INCIDENT_HANDLER_MODE != INCIDENT_HANDLER_TASKS
+    // A preempted incident only has its remaining work left
+    if (allocated && incidentStart(request, (request->remainingTime > 0) ? request->remainingTime
+                                                                         : randomHandlingTime(department))) {
+        return; // Completed later through SHARD_EVENT_COMPLETED
+    }
+    if (allocated) {
+        LOG_ERROR(LOG_MODULE_DISPATCHER, "Incident pool exhausted, incident %u dropped\r\n",
+                  (unsigned)request->id);
+        allocated = false;
+    }
+#else
+    if (allocated) {
+        handlingTimes[department] = randomHandlingTime(department);
+        handOffToDepartment(department);
+    }
+#endif
+    completeIncident(request, allocated);
+}
+
+/**
+ * @brief Dispatcher shard: allocates vehicles for and dispatches one department's incidents.
+ *
+ * The shard first drains its intake queue, so that completions are recorded
+ * and every newly accepted incident is in the backlog, and only then picks the
+ * next pending incident (in arrival or deadline order, see `setDispatchOrder`).
+ * With INCIDENT_HANDLER_TASKS the shard waits for the department task to
+ * handle each one; otherwise it starts the incident's timed lifecycle and
+ * moves on, and the completion comes back through the queue; it is recorded
+ * even while the shard waits for vehicles (see `waitForVehicles`). An incident
+ * preempted by another shard comes back through the queue as well, as pending.
+ *
+ * @param params The department index (POLICE, FIRE, etc.).
+ */
+void dispatchShardTask(void *params) {
+    uint8_t department = (uint8_t)(uintptr_t)params;
+    bool pending = false;
+
+    while (1) {
+        ShardEvent event;
+        // Block only when no accepted incident is waiting
+        if (xQueueReceive(shardQueues[department], &event, pending ? 0 : portMAX_DELAY) == pdTRUE) {
+            if (event.type == SHARD_EVENT_COMPLETED) {
+                completeIncident(&event.request, true);
+            } else {
+                pending = true;
+            }
+            continue;
+        }
+
+        DispatchRequest request;
+        pending = shardNextPending(department, &request);
+        if (pending) {
+            dispatchIncident(department, &request);
+        }
     }
 }
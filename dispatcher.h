@@ -25,13 +25,62 @@ extern SemaphoreHandle_t fireCompletionSemaphore;
 extern SemaphoreHandle_t ambulanceCompletionSemaphore;
 extern SemaphoreHandle_t coronaCompletionSemaphore;
 
+/**
+ * @brief Severity of an incident; sets its deadline.
+ */
+typedef enum {
+    SEVERITY_LOW = 0,
+    SEVERITY_MEDIUM,
+    SEVERITY_HIGH,
+    SEVERITY_COUNT
+} IncidentSeverity;
+
+/**
+ * @brief Order in which a shard serves its pending incidents.
+ */
+typedef enum {
+    DISPATCH_ORDER_FIFO = 0,    /**< Arrival order */
+    DISPATCH_ORDER_EDF          /**< Earliest deadline first */
+} DispatchOrder;
+
 typedef struct {
     uint8_t department;
     uint8_t requiredVehicles;
+    uint16_t id;                /**< Incident identifier, wraps */
+    TickType_t arrivalTime;     /**< Simulated time the incident was generated */
+    TickType_t deadline;        /**< Simulated time by which the incident must be completed */
+    uint8_t severity;           /**< IncidentSeverity */
+    uint8_t preemptions;        /**< Times the incident lost its vehicles to a more severe one */
+    TickType_t remainingTime;   /**< Handling time left after a preemption, 0 = not started yet */
 } DispatchRequest;
 
+void initDispatcherResources(void);
 void initDispatcher(void);
-bool checkAndAllocateVehicles(uint8_t department, int requiredVehicles);
-void randomEventAndDispatchTask(void *params);
+bool checkAndAllocateVehicles(uint8_t department, int requiredVehicles, uint8_t severity);
+void randomEventTask(void *params);
+void dispatchShardTask(void *params);
+uint32_t dispatcherRandom(void);
+uint32_t getRandomState(void);
+void setRandomState(uint32_t state);
+TickType_t getSimulationTime(void);
+void setSimulationTime(TickType_t now);
+TickType_t getIncidentHandlingTime(uint8_t department);
+TickType_t getIncidentDeadline(uint8_t department, uint8_t severity, TickType_t arrivalTime);
+uint32_t getDeadlineMs(uint8_t department, uint8_t severity);
+DispatchOrder getDispatchOrder(void);
+void setDispatchOrder(DispatchOrder order);
+int getInFlightCount(uint8_t department);
+int getCommittedVehicles(uint8_t department);
+int getBusyVehicles(uint8_t department, int allocating);
+UBaseType_t getShardQueueDepth(uint8_t department);
+UBaseType_t getDispatchQueueDepth(void);
+TickType_t getOldestPendingAge(uint8_t department);
+uint32_t getDroppedIncidents(uint8_t department);
+TaskHandle_t getShardTask(uint8_t department);
+bool getIncidentInProgress(uint8_t department, DispatchRequest *request);
+int getIncidentsInProgress(uint8_t department, DispatchRequest *requests, int maxRequests);
+bool preemptIncident(const DispatchRequest *request);
+int getOutstandingIncidents(DispatchRequest *requests, int maxRequests);
+void restoreOutstandingIncidents(const DispatchRequest *requests, int count);
 
 #endif /* INC_DISPATCHER_H_ */
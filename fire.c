@@ -13,6 +13,8 @@
 #include "dispatcher.h"
 #include "logger.h"
 #include "project_defines.h"
+#include "scenario.h"
+#include "vehicle_management.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
@@ -34,7 +36,8 @@ void initFire(void) {
         return;
     }
 
-    if (xTaskCreate(fireTask, "FireTask", FIRE_STACK_SIZE, NULL, FIRE_TASK_PRIORITY, NULL) == pdPASS) {
+    if (xTaskCreate(fireTask, "FireTask", scenarioDepartment(FIRE)->stackWords, NULL,
+                    scenarioDepartment(FIRE)->priority, NULL) == pdPASS) {
         logMessage("Fire task created successfully\r\n");
     } else {
         logMessage("Failed to create Fire task\r\n");
@@ -53,7 +56,7 @@ void fireTask(void *params) {
     while (1) {
         if (xSemaphoreTake(fireSemaphore, portMAX_DELAY) == pdTRUE) {
             // Simulate event handling
-            vTaskDelay(Short_DELAY);
+            vTaskDelay(getIncidentHandlingTime(FIRE));
 
             // Signal completion
             xSemaphoreGive(fireCompletionSemaphore);
@@ -0,0 +1,165 @@
+/**
+ * @file heap_tracker.c
+ * @brief Per-subsystem heap usage and fragmentation accounting.
+ *
+ * Every block handed out by `pvPortMalloc` is attributed to the subsystem tag
+ * that is current at allocation time. The accounting is fed by the kernel's
+ * `traceMALLOC`/`traceFREE` hooks (see FreeRTOSConfig.h), so allocations made
+ * internally by xTaskCreate, xQueueCreate and the semaphore constructors are
+ * covered without wrapping those calls. Sizes include the heap_4 block header.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "heap_tracker.h"
+#include "logger.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/**
+ * @brief Live allocation and the tag it is charged to.
+ */
+typedef struct {
+    void *address; /**< Address returned by pvPortMalloc, NULL if the slot is free */
+    uint8_t tag;   /**< Subsystem the block is charged to */
+} HeapBlock;
+
+static const char *heapTagNames[HEAP_TAG_COUNT] = {
+    "System", "Dispatcher", "Vehicles", "Logger",
+    "Police", "Fire", "Ambulance", "Corona", "Diagnostics"
+};
+
+static volatile HeapTag currentTag = HEAP_TAG_SYSTEM;     /**< Tag charged for new allocations */
+static size_t currentBytes[HEAP_TAG_COUNT] = {0};          /**< Bytes currently allocated per tag */
+static size_t peakBytes[HEAP_TAG_COUNT] = {0};             /**< Highest currentBytes seen per tag */
+static uint32_t allocationCount[HEAP_TAG_COUNT] = {0};     /**< Live blocks per tag */
+static uint32_t failedAllocations = 0;                     /**< pvPortMalloc calls that returned NULL */
+static uint32_t untrackedFrees = 0;                        /**< Frees of blocks missing from the table */
+static HeapBlock heapBlocks[HEAP_TRACKER_MAX_BLOCKS];      /**< Live allocations */
+
+/**
+ * @brief Sets the tag charged for subsequent allocations.
+ *
+ * @param tag The subsystem that owns the following allocations.
+ * @return The previously active tag, so callers can restore it.
+ */
+HeapTag heapTrackerSetTag(HeapTag tag) {
+    HeapTag previous = currentTag;
+    currentTag = (tag < HEAP_TAG_COUNT) ? tag : HEAP_TAG_SYSTEM;
+    return previous;
+}
+
+/**
+ * @brief Allocation hook, called by heap_4 with the scheduler suspended.
+ *
+ * @param address The returned block, or NULL if the allocation failed.
+ * @param size The block size including the allocator header.
+ */
+void heapTrackerOnMalloc(void *address, size_t size) {
+    if (address == NULL) {
+        failedAllocations++;
+        return;
+    }
+
+    HeapTag tag = currentTag;
+    currentBytes[tag] += size;
+    allocationCount[tag]++;
+    if (currentBytes[tag] > peakBytes[tag]) {
+        peakBytes[tag] = currentBytes[tag];
+    }
+
+    for (int i = 0; i < HEAP_TRACKER_MAX_BLOCKS; i++) {
+        if (heapBlocks[i].address == NULL) {
+            heapBlocks[i].address = address;
+            heapBlocks[i].tag = (uint8_t)tag;
+            return;
+        }
+    }
+    // Table full: the block stays charged to its tag and is freed as untracked
+}
+
+/**
+ * @brief Free hook, called by heap_4 with the scheduler suspended.
+ *
+ * @param address The block being freed.
+ * @param size The block size including the allocator header.
+ */
+void heapTrackerOnFree(void *address, size_t size) {
+    for (int i = 0; i < HEAP_TRACKER_MAX_BLOCKS; i++) {
+        if (heapBlocks[i].address == address) {
+            HeapTag tag = (HeapTag)heapBlocks[i].tag;
+            currentBytes[tag] -= (currentBytes[tag] >= size) ? size : currentBytes[tag];
+            allocationCount[tag]--;
+            heapBlocks[i].address = NULL;
+            return;
+        }
+    }
+    untrackedFrees++;
+}
+
+/**
+ * @brief Gets the number of bytes currently charged to a tag.
+ *
+ * @param tag The subsystem tag.
+ * @return Bytes currently allocated.
+ */
+size_t heapTrackerCurrentBytes(HeapTag tag) {
+    return (tag < HEAP_TAG_COUNT) ? currentBytes[tag] : 0;
+}
+
+/**
+ * @brief Gets the highest number of bytes ever charged to a tag.
+ *
+ * @param tag The subsystem tag.
+ * @return Peak bytes allocated.
+ */
+size_t heapTrackerPeakBytes(HeapTag tag) {
+    return (tag < HEAP_TAG_COUNT) ? peakBytes[tag] : 0;
+}
+
+/**
+ * @brief Logs per-subsystem usage and the fragmentation of the free space.
+ *
+ * Fragmentation is reported as the share of free bytes that is not part of
+ * the largest free block, i.e. the part that a single big allocation such as
+ * a larger queue could not use.
+ */
+void heapTrackerReport(void) {
+    size_t current[HEAP_TAG_COUNT];
+    size_t peak[HEAP_TAG_COUNT];
+    uint32_t blocks[HEAP_TAG_COUNT];
+    HeapStats_t stats;
+
+    vTaskSuspendAll();
+    for (int i = 0; i < HEAP_TAG_COUNT; i++) {
+        current[i] = currentBytes[i];
+        peak[i] = peakBytes[i];
+        blocks[i] = allocationCount[i];
+    }
+    (void)xTaskResumeAll();
+    vPortGetHeapStats(&stats);
+
+    logMessage("Heap usage (total %u bytes):\r\n", (unsigned)configTOTAL_HEAP_SIZE);
+    for (int i = 0; i < HEAP_TAG_COUNT; i++) {
+        if (peak[i] > 0) {
+            logMessage("  %-12s current:%u peak:%u blocks:%lu\r\n", heapTagNames[i],
+                       (unsigned)current[i], (unsigned)peak[i], (unsigned long)blocks[i]);
+        }
+    }
+
+    unsigned fragmentation = 0;
+    if (stats.xAvailableHeapSpaceInBytes > 0) {
+        fragmentation = (unsigned)(100U - (stats.xSizeOfLargestFreeBlockInBytes * 100U) /
+                                              stats.xAvailableHeapSpaceInBytes);
+    }
+    logMessage("  Free:%u min-ever:%u largest:%u free-blocks:%u fragmentation:%u%%\r\n",
+               (unsigned)stats.xAvailableHeapSpaceInBytes, (unsigned)stats.xMinimumEverFreeBytesRemaining,
+               (unsigned)stats.xSizeOfLargestFreeBlockInBytes, (unsigned)stats.xNumberOfFreeBlocks,
+               fragmentation);
+    if (failedAllocations > 0 || untrackedFrees > 0) {
+        logMessage("  Failed allocations:%lu untracked frees:%lu\r\n",
+                   (unsigned long)failedAllocations, (unsigned long)untrackedFrees);
+    }
+}
@@ -0,0 +1,37 @@
+/*
+ * heap_tracker.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file heap_tracker.h
+/// @brief Per-subsystem heap accounting interface.
+
+#ifndef INC_HEAP_TRACKER_H_
+#define INC_HEAP_TRACKER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    HEAP_TAG_SYSTEM = 0,
+    HEAP_TAG_DISPATCHER,
+    HEAP_TAG_VEHICLE,
+    HEAP_TAG_LOGGER,
+    HEAP_TAG_POLICE,
+    HEAP_TAG_FIRE,
+    HEAP_TAG_AMBULANCE,
+    HEAP_TAG_CORONA,
+    HEAP_TAG_DIAGNOSTICS,
+    HEAP_TAG_COUNT
+} HeapTag;
+
+HeapTag heapTrackerSetTag(HeapTag tag);
+void heapTrackerOnMalloc(void *address, size_t size);
+void heapTrackerOnFree(void *address, size_t size);
+size_t heapTrackerCurrentBytes(HeapTag tag);
+size_t heapTrackerPeakBytes(HeapTag tag);
+void heapTrackerReport(void);
+
+#endif /* INC_HEAP_TRACKER_H_ */
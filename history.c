@@ -0,0 +1,176 @@
+/**
+ * @file history.c
+ * @brief Windowed per-department incident history.
+ *
+ * Every department has a ring of HISTORY_BUCKETS time buckets of
+ * HISTORY_BUCKET_MS simulated time each. A bucket remembers which interval it
+ * holds, so a bucket left over from an earlier lap of the ring is cleared on
+ * its first update and ignored by queries. Updates are O(1); a query for the
+ * last N minutes sums the buckets inside the window in O(HISTORY_BUCKETS).
+ *
+ * Each department's ring is written only by its dispatcher shard, so no lock
+ * is needed; a concurrent query may miss the incident being recorded.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "history.h"
+#include "dispatcher.h"
+#include "logger.h"
+#include "scenario.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+static HistoryBucket history[NUM_DEPARTMENTS][HISTORY_BUCKETS]; /**< Time buckets per department */
+
+/**
+ * @brief Gets the interval number of the current simulated time.
+ *
+ * Numbered from one, so a zeroed bucket never matches.
+ */
+static uint32_t currentInterval(void) {
+    return (uint32_t)(getSimulationTime() / pdMS_TO_TICKS(HISTORY_BUCKET_MS)) + 1;
+}
+
+/**
+ * @brief Returns the department's bucket for the current interval, clearing a stale one.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return The bucket.
+ */
+static HistoryBucket *currentBucket(uint8_t department) {
+    uint32_t interval = currentInterval();
+    HistoryBucket *bucket = &history[department][interval % HISTORY_BUCKETS];
+
+    if (bucket->interval != interval) {
+        bucket->interval = 0; // Invisible to queries while it is cleared
+        bucket->incidents = 0;
+        bucket->vehicles = 0;
+        bucket->misses = 0;
+        bucket->borrowed = 0;
+        bucket->interval = interval;
+    }
+    return bucket;
+}
+
+/**
+ * @brief Records a completed incident.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param vehicles Vehicles used by the incident.
+ * @param missed The incident missed its deadline.
+ */
+void historyRecordIncident(uint8_t department, int vehicles, bool missed) {
+    if (department >= NUM_DEPARTMENTS) {
+        return;
+    }
+    HistoryBucket *bucket = currentBucket(department);
+    bucket->incidents++;
+    bucket->vehicles += (uint16_t)vehicles;
+    if (missed) {
+        bucket->misses++;
+    }
+}
+
+/**
+ * @brief Records vehicles borrowed on demand.
+ *
+ * @param department The department index (POLICE, FIRE, etc.) that borrowed.
+ * @param vehicles The number of vehicles borrowed.
+ */
+void historyRecordBorrow(uint8_t department, int vehicles) {
+    if (department >= NUM_DEPARTMENTS) {
+        return;
+    }
+    currentBucket(department)->borrowed += (uint16_t)vehicles;
+}
+
+/**
+ * @brief Sums a department's history over the most recent time window.
+ *
+ * The window is rounded up to whole buckets and includes the current one.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param windowMs Length of the window in ms, at most HISTORY_BUCKETS * HISTORY_BUCKET_MS.
+ * @param summary Output totals.
+ */
+void historyQuery(uint8_t department, uint32_t windowMs, HistorySummary *summary) {
+    uint32_t now = currentInterval();
+    uint32_t buckets = (windowMs + HISTORY_BUCKET_MS - 1) / HISTORY_BUCKET_MS;
+
+    *summary = (HistorySummary){0};
+    if (department >= NUM_DEPARTMENTS) {
+        return;
+    }
+    if (buckets == 0) {
+        buckets = 1;
+    } else if (buckets > HISTORY_BUCKETS) {
+        buckets = HISTORY_BUCKETS;
+    }
+
+    for (int i = 0; i < HISTORY_BUCKETS; i++) {
+        const HistoryBucket *bucket = &history[department][i];
+        uint32_t interval = bucket->interval;
+        if (interval == 0 || interval > now || now - interval >= buckets) {
+            continue;
+        }
+        summary->incidents += bucket->incidents;
+        summary->vehicles += bucket->vehicles;
+        summary->misses += bucket->misses;
+        summary->borrowed += bucket->borrowed;
+    }
+}
+
+/**
+ * @brief Logs every department's history over the most recent time window.
+ *
+ * @param windowMs Length of the window in ms.
+ */
+void historyReport(uint32_t windowMs) {
+
+    if (windowMs > (uint32_t)HISTORY_BUCKETS * HISTORY_BUCKET_MS) {
+        windowMs = (uint32_t)HISTORY_BUCKETS * HISTORY_BUCKET_MS;
+    }
+    logMessage("Last %lu s:\r\n", (unsigned long)(windowMs / 1000));
+    for (uint8_t i = 0; i < NUM_DEPARTMENTS; i++) {
+        HistorySummary summary;
+        historyQuery(i, windowMs, &summary);
+        uint32_t averageTenths = (summary.incidents > 0) ? (summary.vehicles * 10) / summary.incidents : 0;
+        logMessage("  %-10s incidents:%lu avg vehicles:%lu.%lu misses:%lu borrowed:%lu\r\n", departmentName(i),
+                   (unsigned long)summary.incidents, (unsigned long)(averageTenths / 10),
+                   (unsigned long)(averageTenths % 10), (unsigned long)summary.misses,
+                   (unsigned long)summary.borrowed);
+    }
+}
+
+/**
+ * @brief Copies every department's ring of time buckets.
+ *
+ * Used to save a checkpoint; a bucket being updated meanwhile may be copied half-way.
+ *
+ * @param buckets Receives the buckets, indexed by department.
+ */
+void historyGetBuckets(HistoryBucket buckets[NUM_DEPARTMENTS][HISTORY_BUCKETS]) {
+    for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+        for (int i = 0; i < HISTORY_BUCKETS; i++) {
+            buckets[d][i] = history[d][i];
+        }
+    }
+}
+
+/**
+ * @brief Overwrites every department's ring of time buckets.
+ *
+ * Used to restore a checkpoint before the simulation starts.
+ *
+ * @param buckets The buckets, indexed by department.
+ */
+void historySetBuckets(const HistoryBucket buckets[NUM_DEPARTMENTS][HISTORY_BUCKETS]) {
+    for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+        for (int i = 0; i < HISTORY_BUCKETS; i++) {
+            history[d][i] = buckets[d][i];
+        }
+    }
+}
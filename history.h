@@ -0,0 +1,46 @@
+/*
+ * history.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file history.h
+/// @brief Windowed per-department incident history interface.
+
+#ifndef INC_HISTORY_H_
+#define INC_HISTORY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "project_defines.h"
+
+/**
+ * @brief Aggregates of one department over one time bucket.
+ */
+typedef struct {
+    volatile uint32_t interval;   /**< Simulated time / HISTORY_BUCKET_MS, plus one; 0 if never used */
+    volatile uint16_t incidents;
+    volatile uint16_t vehicles;
+    volatile uint16_t misses;
+    volatile uint16_t borrowed;
+} HistoryBucket;
+
+/**
+ * @brief Totals of one department over a time window.
+ */
+typedef struct {
+    uint32_t incidents;   /**< Incidents completed */
+    uint32_t vehicles;    /**< Vehicles used by those incidents */
+    uint32_t misses;      /**< Incidents that missed their deadline */
+    uint32_t borrowed;    /**< Vehicles borrowed on demand */
+} HistorySummary;
+
+void historyRecordIncident(uint8_t department, int vehicles, bool missed);
+void historyRecordBorrow(uint8_t department, int vehicles);
+void historyQuery(uint8_t department, uint32_t windowMs, HistorySummary *summary);
+void historyReport(uint32_t windowMs);
+void historyGetBuckets(HistoryBucket buckets[NUM_DEPARTMENTS][HISTORY_BUCKETS]);
+void historySetBuckets(const HistoryBucket buckets[NUM_DEPARTMENTS][HISTORY_BUCKETS]);
+
+#endif /* INC_HISTORY_H_ */
@@ -0,0 +1,444 @@
+/**
+ * @file incident.c
+ * @brief Incidents as timer-driven phase sequences instead of blocking tasks.
+ *
+ * An incident goes through dispatch, travel, on-scene and return phases.
+ * Each pool record owns a timer whose callback advances the record to the next
+ * phase and re-arms the timer for that phase's share of the handling time
+ * (INCIDENT_PHASE_SHARES). After the return phase the record is freed and the
+ * done callback reports completion.
+ *
+ * With TIMER_WHEEL_ENABLED the timer is an entry of the timing wheel (O(1)
+ * re-arm); otherwise it is a statically allocated FreeRTOS software timer.
+ *
+ * With INCIDENT_HANDLER_PROTOTHREADS no timers are used: every record is a
+ * stackless protothread (pt.h) and a single worker task runs all of them,
+ * sleeping until the earliest phase end. A record then holds only the
+ * protothread's resume point, a list link and the phase deadline, and records
+ * can also be supplied by the caller (`incidentSubmit`).
+ *
+ * A pool incident can be preempted (`incidentPreempt`): it stops counting as
+ * in progress at once, and its record is freed silently at the end of the
+ * current phase (or the worker's next pass), so the caller can requeue it
+ * with the work it had left.
+ *
+ * A concurrent incident therefore costs one pool record (a few dozen bytes)
+ * instead of a department task with its own stack, and no heap is used after
+ * `initIncidents`.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "incident.h"
+#include "logger.h"
+#include "profiler.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "timer_wheel.h"
+#include "pt.h"
+
+/**
+ * @brief One incident in progress.
+ */
+typedef struct Incident {
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+    Protothread thread;          /**< Resume point of the incident's handler */
+    struct Incident *next;       /**< Next record in the worker's pending or running list */
+    TickType_t phaseEnd;         /**< Tick at which the current phase ends */
+    IncidentDoneCallback done;   /**< Reports the completion of this record */
+#elif TIMER_WHEEL_ENABLED
+    TimerWheelEntry timer;       /**< Phase timer, its context points back to this record */
+#else
+    StaticTimer_t timerBuffer;   /**< Storage of the phase timer */
+    TimerHandle_t timer;         /**< Phase timer, its ID points back to this record */
+#endif
+    DispatchRequest request;     /**< The incident */
+    TickType_t handlingTime;     /**< Total duration of all phases */
+    TickType_t finishAt;         /**< Tick at which the last phase ends */
+    uint8_t phase;               /**< Current IncidentPhase */
+    bool inUse;                  /**< Record holds an incident in progress */
+    bool preempted;              /**< Vehicles taken away; finish without reporting completion */
+} Incident;
+
+static const uint8_t phaseShares[INCIDENT_PHASE_COUNT] = INCIDENT_PHASE_SHARES;
+static const char *const phaseNames[INCIDENT_PHASE_COUNT] = {"dispatch", "travel", "on scene", "return"};
+
+static Incident incidentPool[INCIDENT_POOL_SIZE]; /**< Records of incidents in progress */
+static IncidentDoneCallback doneCallback = NULL;  /**< Reports completed incidents */
+
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+static TaskHandle_t workerHandle = NULL; /**< Runs the handlers of all incidents */
+static Incident *pendingIncidents = NULL; /**< Submitted records not yet picked up by the worker */
+#endif
+
+/**
+ * @brief Gets the duration of one phase of an incident.
+ *
+ * @param incident The incident.
+ * @param phase The phase.
+ * @return The duration in ticks, at least one.
+ */
+static TickType_t phaseDuration(const Incident *incident, uint8_t phase) {
+    TickType_t duration = (TickType_t)(((uint64_t)incident->handlingTime * phaseShares[phase]) / 100U);
+    return (duration > 0) ? duration : 1;
+}
+
+/**
+ * @brief Frees an incident's record and reports its completion, unless it was preempted.
+ *
+ * @param incident The incident.
+ */
+static void finishIncident(Incident *incident) {
+    DispatchRequest request = incident->request;
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+    IncidentDoneCallback done = incident->done;
+#else
+    IncidentDoneCallback done = doneCallback;
+#endif
+
+    // The record may be reused as soon as it is marked free
+    taskENTER_CRITICAL();
+    bool report = !incident->preempted;
+    incident->preempted = false;
+    incident->inUse = false;
+    taskEXIT_CRITICAL();
+    if (report && done != NULL) {
+        done(&request);
+    }
+}
+
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+/**
+ * @brief Handler of one incident: waits out each phase in turn.
+ *
+ * @param incident The incident.
+ * @return PT_ENDED after the return phase, PT_WAITING before.
+ */
+static int incidentThread(Incident *incident) {
+    PT_BEGIN(&incident->thread);
+    for (incident->phase = INCIDENT_PHASE_DISPATCH; incident->phase < INCIDENT_PHASE_COUNT; incident->phase++) {
+        LOG_DEBUG(LOG_MODULE_DEPARTMENT, "Incident %u entering %s phase\r\n",
+                  (unsigned)incident->request.id, phaseNames[incident->phase]);
+        // Deadlines follow on from each other, so a late wake-up does not stretch the incident
+        incident->phaseEnd += phaseDuration(incident, incident->phase);
+        PT_WAIT_UNTIL(&incident->thread, (int32_t)(xTaskGetTickCount() - incident->phaseEnd) >= 0);
+    }
+    PT_END(&incident->thread);
+}
+
+/**
+ * @brief Incident worker: runs the handlers of all incidents in progress.
+ *
+ * Picks up newly submitted records, runs every handler once and then sleeps
+ * until the earliest phase end or the next submission.
+ *
+ * @param params Unused.
+ */
+static void incidentWorkerTask(void *params) {
+    Incident *running = NULL;
+
+    (void)params;
+    while (1) {
+        taskENTER_CRITICAL();
+        Incident *submitted = pendingIncidents;
+        pendingIncidents = NULL;
+        taskEXIT_CRITICAL();
+        while (submitted != NULL) {
+            Incident *incident = submitted;
+            submitted = incident->next;
+            incident->next = running;
+            running = incident;
+        }
+
+        PROFILE_BEGIN(PROF_INCIDENT_PHASE); // One pass over all incidents
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = portMAX_DELAY;
+        Incident **link = &running;
+        while (*link != NULL) {
+            Incident *incident = *link;
+            if (incident->preempted || incidentThread(incident) == PT_ENDED) {
+                *link = incident->next;
+                finishIncident(incident);
+                continue;
+            }
+            int32_t remaining = (int32_t)(incident->phaseEnd - now);
+            if (remaining <= 0) {
+                wait = 0;
+            } else if ((TickType_t)remaining < wait) {
+                wait = (TickType_t)remaining;
+            }
+            link = &incident->next;
+        }
+        PROFILE_END(PROF_INCIDENT_PHASE);
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+/**
+ * @brief Gets the size of an incident record, for callers that supply their own.
+ *
+ * @return The size in bytes.
+ */
+size_t incidentRecordSize(void) {
+    return sizeof(Incident);
+}
+
+/**
+ * @brief Starts the lifecycle of an incident in a caller-supplied record.
+ *
+ * The record must stay valid until `done` has been called for it.
+ *
+ * @param record At least `incidentRecordSize()` bytes, suitably aligned.
+ * @param request The incident.
+ * @param handlingTime Total duration of all phases.
+ * @param done Called from the worker task when the incident has finished.
+ */
+void incidentSubmit(void *record, const DispatchRequest *request, TickType_t handlingTime,
+                    IncidentDoneCallback done) {
+    Incident *incident = record;
+
+    incident->request = *request;
+    incident->handlingTime = handlingTime;
+    incident->phaseEnd = xTaskGetTickCount();
+    incident->finishAt = incident->phaseEnd + handlingTime;
+    incident->done = done;
+    incident->preempted = false;
+    incident->inUse = true;
+    PT_INIT(&incident->thread);
+
+    taskENTER_CRITICAL();
+    incident->next = pendingIncidents;
+    pendingIncidents = incident;
+    taskEXIT_CRITICAL();
+    xTaskNotifyGive(workerHandle);
+}
+
+#else
+/**
+ * @brief Arms an incident's timer for the duration of its current phase.
+ *
+ * @param incident The incident.
+ * @param wait Ticks to wait for room in the FreeRTOS timer command queue.
+ * @return True if the timer was armed.
+ */
+static bool armPhaseTimer(Incident *incident, TickType_t wait) {
+    TickType_t duration = phaseDuration(incident, incident->phase);
+
+    LOG_DEBUG(LOG_MODULE_DEPARTMENT, "Incident %u entering %s phase\r\n",
+              (unsigned)incident->request.id, phaseNames[incident->phase]);
+#if TIMER_WHEEL_ENABLED
+    (void)wait;
+    timerWheelSchedule(&incident->timer, duration);
+    return true;
+#else
+    return xTimerChangePeriod(incident->timer, duration, wait) == pdPASS;
+#endif
+}
+
+/**
+ * @brief Moves an incident to its next phase when the current one has elapsed.
+ *
+ * Runs in the timer task (or the timer wheel task), so it must not block.
+ *
+ * @param incident The incident.
+ */
+static void advancePhase(Incident *incident) {
+    incident->phase++;
+    if (incident->phase >= INCIDENT_PHASE_COUNT || incident->preempted) {
+        finishIncident(incident);
+        return;
+    }
+
+    if (!armPhaseTimer(incident, 0)) {
+        LOG_ERROR(LOG_MODULE_DEPARTMENT, "Timer queue full, incident %u finished early\r\n",
+                  (unsigned)incident->request.id);
+        finishIncident(incident);
+    }
+}
+
+#if TIMER_WHEEL_ENABLED
+static void phaseTimerCallback(TimerWheelEntry *entry) {
+    PROFILE_BEGIN(PROF_INCIDENT_PHASE);
+    advancePhase(entry->context);
+    PROFILE_END(PROF_INCIDENT_PHASE);
+}
+#else
+static void phaseTimerCallback(TimerHandle_t timer) {
+    PROFILE_BEGIN(PROF_INCIDENT_PHASE);
+    advancePhase(pvTimerGetTimerID(timer));
+    PROFILE_END(PROF_INCIDENT_PHASE);
+}
+#endif
+
+#endif
+
+/**
+ * @brief Creates the phase timers of the incident pool, or the incident worker task.
+ *
+ * @param done Called from the timer (or worker) task for every completed incident.
+ */
+void initIncidents(IncidentDoneCallback done) {
+    int created = 0;
+
+    doneCallback = done;
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+    if (xTaskCreate(incidentWorkerTask, "IncidentWorker", INCIDENT_WORKER_STACK_SIZE, NULL,
+                    INCIDENT_WORKER_PRIORITY, &workerHandle) == pdPASS) {
+        created = INCIDENT_POOL_SIZE;
+    }
+#else
+    for (int i = 0; i < INCIDENT_POOL_SIZE; i++) {
+#if TIMER_WHEEL_ENABLED
+        timerWheelEntryInit(&incidentPool[i].timer, phaseTimerCallback, &incidentPool[i]);
+        created++;
+#else
+        incidentPool[i].timer = xTimerCreateStatic("Incident", 1, pdFALSE, &incidentPool[i], phaseTimerCallback,
+                                                   &incidentPool[i].timerBuffer);
+        if (incidentPool[i].timer != NULL) {
+            created++;
+        }
+#endif
+    }
+#endif
+    if (created == INCIDENT_POOL_SIZE) {
+        logMessage("Incident pool initialized (%d records of %u bytes)\r\n", INCIDENT_POOL_SIZE,
+                   (unsigned)sizeof(Incident));
+    } else {
+        logMessage("Failed to create incident handlers\r\n");
+    }
+}
+
+/**
+ * @brief Starts the lifecycle of an incident.
+ *
+ * @param request The incident.
+ * @param handlingTime Total duration of all phases.
+ * @return True if the incident was started, false if the pool is exhausted.
+ */
+bool incidentStart(const DispatchRequest *request, TickType_t handlingTime) {
+    Incident *incident = NULL;
+
+    taskENTER_CRITICAL();
+    for (int i = 0; i < INCIDENT_POOL_SIZE; i++) {
+        if (!incidentPool[i].inUse) {
+            incident = &incidentPool[i];
+            incident->inUse = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+    if (incident == NULL) {
+        return false;
+    }
+
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+    incidentSubmit(incident, request, handlingTime, doneCallback);
+    return true;
+#else
+    incident->request = *request;
+    incident->handlingTime = handlingTime;
+    incident->finishAt = xTaskGetTickCount() + handlingTime;
+    incident->phase = INCIDENT_PHASE_DISPATCH;
+    incident->preempted = false;
+    if (!armPhaseTimer(incident, portMAX_DELAY)) {
+        taskENTER_CRITICAL();
+        incident->inUse = false;
+        taskEXIT_CRITICAL();
+        return false;
+    }
+    return true;
+#endif
+}
+
+/**
+ * @brief Gets the number of incidents in progress.
+ *
+ * @return The number of used pool records (caller-supplied records are not counted).
+ */
+int incidentActiveCount(void) {
+    int active = 0;
+    for (int i = 0; i < INCIDENT_POOL_SIZE; i++) {
+        if (incidentPool[i].inUse) {
+            active++;
+        }
+    }
+    return active;
+}
+
+/**
+ * @brief Finds the pool record of an incident in progress that was not preempted.
+ *
+ * Call inside a critical section.
+ *
+ * @param id The incident identifier.
+ * @return The record, or NULL if the incident is not in progress.
+ */
+static Incident *findIncident(uint16_t id) {
+    for (int i = 0; i < INCIDENT_POOL_SIZE; i++) {
+        if (incidentPool[i].inUse && !incidentPool[i].preempted && incidentPool[i].request.id == id) {
+            return &incidentPool[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Gets how long an incident in progress still needs.
+ *
+ * @param id The incident identifier.
+ * @param remaining Receives the ticks until its last phase ends, at least one.
+ * @return True if the incident is in progress in a pool record.
+ */
+bool incidentRemainingTime(uint16_t id, TickType_t *remaining) {
+    TickType_t now = xTaskGetTickCount();
+    int32_t left = 0;
+
+    taskENTER_CRITICAL();
+    Incident *incident = findIncident(id);
+    if (incident != NULL) {
+        left = (int32_t)(incident->finishAt - now);
+    }
+    taskEXIT_CRITICAL();
+    if (incident == NULL) {
+        return false;
+    }
+    *remaining = (left > 0) ? (TickType_t)left : 1;
+    return true;
+}
+
+/**
+ * @brief Stops an incident in progress so its vehicles can be used elsewhere.
+ *
+ * The done callback is not called for a preempted incident; the caller owns
+ * it again and may start it anew with the returned remaining time. Its record
+ * stays in use until the current phase ends.
+ *
+ * @param id The incident identifier.
+ * @param remaining Receives the ticks the incident still needed, at least one.
+ * @return True if the incident was preempted, false if it is not in progress
+ *         (for example because it has just finished).
+ */
+bool incidentPreempt(uint16_t id, TickType_t *remaining) {
+    TickType_t now = xTaskGetTickCount();
+    int32_t left = 0;
+
+    // Either this or finishIncident wins; a finished incident is reported normally
+    taskENTER_CRITICAL();
+    Incident *incident = findIncident(id);
+    if (incident != NULL) {
+        incident->preempted = true;
+        left = (int32_t)(incident->finishAt - now);
+    }
+    taskEXIT_CRITICAL();
+    if (incident == NULL) {
+        return false;
+    }
+    *remaining = (left > 0) ? (TickType_t)left : 1;
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+    xTaskNotifyGive(workerHandle); // Free the record on the worker's next pass
+#endif
+    return true;
+}
@@ -0,0 +1,47 @@
+/*
+ * incident.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file incident.h
+/// @brief Timer-driven (or protothread-driven) incident lifecycle interface.
+
+#ifndef INC_INCIDENT_H_
+#define INC_INCIDENT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "FreeRTOS.h"
+#include "dispatcher.h"
+#include "project_defines.h"
+
+/**
+ * @brief Phases of an incident, in order.
+ */
+typedef enum {
+    INCIDENT_PHASE_DISPATCH = 0,
+    INCIDENT_PHASE_TRAVEL,
+    INCIDENT_PHASE_ON_SCENE,
+    INCIDENT_PHASE_RETURN,
+    INCIDENT_PHASE_COUNT
+} IncidentPhase;
+
+/**
+ * @brief Called from the timer, timer wheel or incident worker task when an incident has finished its last phase.
+ */
+typedef void (*IncidentDoneCallback)(const DispatchRequest *request);
+
+void initIncidents(IncidentDoneCallback done);
+bool incidentStart(const DispatchRequest *request, TickType_t handlingTime);
+int incidentActiveCount(void);
+bool incidentRemainingTime(uint16_t id, TickType_t *remaining);
+bool incidentPreempt(uint16_t id, TickType_t *remaining);
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+size_t incidentRecordSize(void);
+void incidentSubmit(void *record, const DispatchRequest *request, TickType_t handlingTime,
+                    IncidentDoneCallback done);
+#endif
+
+#endif /* INC_INCIDENT_H_ */
@@ -11,16 +11,90 @@
  */
 
 #include "logger.h"
+#include "heap_tracker.h"
+#include "profiler.h"
+#include "rebalancer.h"
+#include "priority_controller.h"
+#include "quantile_sketch.h"
+#include "history.h"
+#include "preemption.h"
+#include "dispatcher.h"
+#include "vehicle_management.h"
+#include "scenario.h"
 #include "project_defines.h"
 #include "FreeRTOS.h"
 #include "queue.h"
+#include "task.h"
+#include "timers.h"
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
 
 // Static variables for performance tracking
-static int taskExecutionCounts[4] = {0}; /**< Count of task executions for departments */
-static int totalVehiclesUsed[4] = {0};   /**< Total vehicles dispatched for departments */
+static int taskExecutionCounts[NUM_DEPARTMENTS] = {0}; /**< Count of task executions for departments */
+static int totalVehiclesUsed[NUM_DEPARTMENTS] = {0};   /**< Total vehicles dispatched for departments */
+static QuantileSketch responseTimeSketches[NUM_DEPARTMENTS];  /**< Response times in ms per department */
+static QuantileSketch severityResponseSketches[SEVERITY_COUNT]; /**< Response times in ms per severity */
+static QuantileSketch vehiclesSketches[NUM_DEPARTMENTS];      /**< Vehicles per incident per department */
+static QuantileSketch borrowSizeSketches[NUM_DEPARTMENTS];    /**< Vehicles borrowed per reallocation per department */
+static uint32_t deadlineIncidents[NUM_DEPARTMENTS][SEVERITY_COUNT]; /**< Finished incidents per department and severity */
+static uint32_t deadlineMisses[NUM_DEPARTMENTS][SEVERITY_COUNT];    /**< Late or unserved incidents per department and severity */
+static int32_t worstLatenessMs[NUM_DEPARTMENTS];                    /**< Latest completion past its deadline per department */
+
+/**
+ * @brief Counter of one aggregated event.
+ */
+typedef struct {
+    const char *label;  /**< Event label, NULL if the slot is free */
+    uint8_t department; /**< Department index or LOG_NO_DEPARTMENT */
+    uint32_t count;     /**< Occurrences since the last flush */
+    int32_t total;      /**< Sum of the event values since the last flush */
+} LogAggregate;
+
+static LogAggregate aggregates[LOG_AGGREGATION_SLOTS];     /**< Counters filled by logAggregate */
+static LogAggregate flushBuffer[LOG_AGGREGATION_SLOTS];    /**< Snapshot printed by the flush */
+static uint32_t droppedAggregates = 0;                     /**< Events that found no free slot */
+
+volatile bool logAggregationEnabled = LOG_AGGREGATION_ENABLED; /**< Aggregation mode switch */
+
+/** Runtime log level per module, read by the LOG_* macros before formatting; set by initLogger */
+volatile uint8_t logModuleLevels[LOG_MODULE_COUNT];
+
+/**
+ * @brief Low-priority task that flushes the aggregated counters once per interval.
+ *
+ * The flush writes up to LOG_AGGREGATION_SLOTS lines to the UART, so it runs
+ * here rather than in the timer daemon, where it would hold up every software
+ * timer, incident phases included.
+ *
+ * @param params Unused task parameters.
+ */
+static void logFlushTask(void *params) {
+    TickType_t lastWake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&lastWake, LOG_AGGREGATION_INTERVAL);
+        logAggregationFlush();
+    }
+}
+
+/**
+ * @brief Initializes the logger.
+ *
+ * Sets every module to `LOG_DEFAULT_LEVEL` and creates the task that flushes
+ * aggregated events once per `LOG_AGGREGATION_INTERVAL`. Must be called before
+ * the LOG_* macros are used.
+ */
+void initLogger(void) {
+    for (int module = 0; module < LOG_MODULE_COUNT; module++) {
+        logModuleLevels[module] = LOG_DEFAULT_LEVEL;
+    }
+    if (xTaskCreate(logFlushTask, "LogFlush", LOGGER_STACK_SIZE, NULL, LOGGER_PRIORITY, NULL) == pdPASS) {
+        logMessage("Logger initialized successfully\r\n");
+    } else {
+        logMessage("Failed to create log flush task\r\n");
+    }
+}
 
 /**
  * @brief Logs a formatted message.
@@ -32,6 +106,7 @@ static int totalVehiclesUsed[4] = {0};   /**< Total vehicles dispatched for depa
  * @param ... The arguments corresponding to the format specifiers.
  */
 void logMessage(const char *format, ...) {
+    PROFILE_BEGIN(PROF_LOG_MESSAGE);
     char message[LOGGER_MESSAGE_SIZE];
     va_list args;
     va_start(args, format);
@@ -39,6 +114,110 @@ void logMessage(const char *format, ...) {
     va_end(args);
 
     printf("%s", message);
+    PROFILE_END(PROF_LOG_MESSAGE);
+}
+
+/**
+ * @brief Counts one occurrence of an aggregated event.
+ *
+ * No formatting or output happens here; the event is only added to its
+ * (label, department) counter.
+ *
+ * @param label Static label identifying the event.
+ * @param department Department index or LOG_NO_DEPARTMENT.
+ * @param value Value added to the event total (e.g. vehicles involved).
+ */
+void logAggregate(const char *label, uint8_t department, int value) {
+    LogAggregate *freeSlot = NULL;
+
+    taskENTER_CRITICAL();
+    for (int i = 0; i < LOG_AGGREGATION_SLOTS; i++) {
+        if (aggregates[i].label != NULL && aggregates[i].department == department &&
+            (aggregates[i].label == label || strcmp(aggregates[i].label, label) == 0)) {
+            aggregates[i].count++;
+            aggregates[i].total += value;
+            taskEXIT_CRITICAL();
+            return;
+        }
+        if (aggregates[i].label == NULL && freeSlot == NULL) {
+            freeSlot = &aggregates[i];
+        }
+    }
+
+    if (freeSlot != NULL) {
+        freeSlot->label = label;
+        freeSlot->department = department;
+        freeSlot->count = 1;
+        freeSlot->total = value;
+    } else {
+        droppedAggregates++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Prints one summary line per aggregated event and resets the counters.
+ */
+void logAggregationFlush(void) {
+    uint32_t dropped;
+
+    taskENTER_CRITICAL();
+    memcpy(flushBuffer, aggregates, sizeof(aggregates));
+    memset(aggregates, 0, sizeof(aggregates));
+    dropped = droppedAggregates;
+    droppedAggregates = 0;
+    taskEXIT_CRITICAL();
+
+    for (int i = 0; i < LOG_AGGREGATION_SLOTS; i++) {
+        if (flushBuffer[i].label == NULL) {
+            continue;
+        }
+        const char *department = (flushBuffer[i].department < NUM_DEPARTMENTS) ?
+                                 departmentName(flushBuffer[i].department) : "-";
+        logMessage("[summary] %s (%s): %lu times, total %ld\r\n", flushBuffer[i].label, department,
+                   (unsigned long)flushBuffer[i].count, (long)flushBuffer[i].total);
+    }
+    if (dropped > 0) {
+        logMessage("[summary] %lu events not aggregated (no free slot)\r\n", (unsigned long)dropped);
+    }
+}
+
+/**
+ * @brief Switches aggregation mode on or off.
+ *
+ * Pending counters are flushed when the mode is switched off.
+ *
+ * @param enabled True to aggregate repetitive events, false to log each one.
+ */
+void logSetAggregation(bool enabled) {
+    logAggregationEnabled = enabled;
+    if (!enabled) {
+        logAggregationFlush();
+    }
+}
+
+/**
+ * @brief Sets the runtime log level of a module.
+ *
+ * Messages of the module below this level are dropped before any formatting.
+ *
+ * @param module The module to configure.
+ * @param level The lowest level that is still logged (LOG_LEVEL_*).
+ */
+void logSetLevel(LogModule module, uint8_t level) {
+    if (module < LOG_MODULE_COUNT) {
+        logModuleLevels[module] = (level > LOG_LEVEL_NONE) ? LOG_LEVEL_NONE : level;
+    }
+}
+
+/**
+ * @brief Gets the runtime log level of a module.
+ *
+ * @param module The module to query.
+ * @return The lowest level that is logged for the module.
+ */
+uint8_t logGetLevel(LogModule module) {
+    return (module < LOG_MODULE_COUNT) ? logModuleLevels[module] : LOG_LEVEL_NONE;
 }
 
 /**
@@ -51,7 +230,7 @@ void logMessage(const char *format, ...) {
  */
 void recordTaskExecution(int department) {
     taskExecutionCounts[department]++;
-    logMessage("Task executed for department %d. Total: %d\n", department, taskExecutionCounts[department]);
+    LOG_DEBUG(LOG_MODULE_SYSTEM, "Task executed for department %d. Total: %d\n", department, taskExecutionCounts[department]);
 }
 
 /**
@@ -65,19 +244,259 @@ void recordTaskExecution(int department) {
  */
 void recordVehicleUsage(int department, int count) {
     totalVehiclesUsed[department] += count;
-    logMessage("Vehicles used for department %d: %d. Total: %d\n", department, count, totalVehiclesUsed[department]);
+    sketchRecord(&vehiclesSketches[department], (uint32_t)count);
+    LOG_DEBUG(LOG_MODULE_SYSTEM, "Vehicles used for department %d: %d. Total: %d\n", department, count, totalVehiclesUsed[department]);
+}
+
+/**
+ * @brief Records the response time of a completed incident.
+ *
+ * The time from incident generation to completion is added to the department's
+ * quantile sketch. The sketch is updated with atomic increments, so it needs no
+ * lock whichever task completes the incident.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param milliseconds The response time.
+ */
+void recordResponseTime(int department, uint32_t milliseconds) {
+    sketchRecord(&responseTimeSketches[department], milliseconds);
+}
+
+/**
+ * @brief Records the response time of a completed incident by severity.
+ *
+ * Every shard records here; the sketch's atomic increments keep that lock-free.
+ *
+ * @param severity The incident's IncidentSeverity.
+ * @param milliseconds The response time.
+ */
+void recordSeverityResponseTime(uint8_t severity, uint32_t milliseconds) {
+    if (severity >= SEVERITY_COUNT) {
+        return;
+    }
+    sketchRecord(&severityResponseSketches[severity], milliseconds);
+}
+
+/**
+ * @brief Records the number of vehicles borrowed for one reallocation.
+ *
+ * @param department The department index (POLICE, FIRE, etc.) that borrowed.
+ * @param count The number of vehicles borrowed.
+ */
+void recordBorrowSize(int department, int count) {
+    sketchRecord(&borrowSizeSketches[department], (uint32_t)count);
+}
+
+/**
+ * @brief Records whether a finished incident met its deadline.
+ *
+ * Lock-free like the sketches, so the counters stay exact whichever task
+ * completes the incident.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param severity The incident's IncidentSeverity.
+ * @param missed The incident completed late or was not served.
+ * @param latenessMs Completion time minus deadline, negative if early.
+ */
+void recordDeadlineResult(int department, uint8_t severity, bool missed, int32_t latenessMs) {
+    if (department < 0 || department >= NUM_DEPARTMENTS || severity >= SEVERITY_COUNT) {
+        return;
+    }
+    __atomic_fetch_add(&deadlineIncidents[department][severity], 1U, __ATOMIC_RELAXED);
+    if (missed) {
+        __atomic_fetch_add(&deadlineMisses[department][severity], 1U, __ATOMIC_RELAXED);
+    }
+    int32_t worst = __atomic_load_n(&worstLatenessMs[department], __ATOMIC_RELAXED);
+    while (latenessMs > worst && !__atomic_compare_exchange_n(&worstLatenessMs[department], &worst, latenessMs, true,
+                                                              __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * @brief Logs deadline misses per department and severity.
+ */
+static void reportDeadlines(void) {
+    const char *severityNames[] = SEVERITY_NAMES;
+    uint32_t totalIncidents = 0;
+    uint32_t totalMisses = 0;
+
+    logMessage("Deadline misses (%s order):\n", (getDispatchOrder() == DISPATCH_ORDER_EDF) ? "EDF" : "FIFO");
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        uint32_t incidents = 0;
+        uint32_t misses = 0;
+
+        logMessage("  %-10s", departmentName((uint8_t)i));
+        for (int severity = SEVERITY_COUNT - 1; severity >= 0; severity--) {
+            logMessage(" %s:%lu/%lu", severityNames[severity], (unsigned long)deadlineMisses[i][severity],
+                       (unsigned long)deadlineIncidents[i][severity]);
+            incidents += deadlineIncidents[i][severity];
+            misses += deadlineMisses[i][severity];
+        }
+        logMessage(" | missed %lu.%lu%% worst lateness %ld ms\n",
+                   (unsigned long)((incidents > 0) ? misses * 100U / incidents : 0),
+                   (unsigned long)((incidents > 0) ? (misses * 1000U / incidents) % 10 : 0),
+                   (long)worstLatenessMs[i]);
+        totalIncidents += incidents;
+        totalMisses += misses;
+    }
+    logMessage("  Total: %lu of %lu incidents missed their deadline\n", (unsigned long)totalMisses,
+               (unsigned long)totalIncidents);
+}
+
+/**
+ * @brief Estimates a response time percentile over all departments.
+ *
+ * @param percentile The percentile, 1 to 100.
+ * @return The percentile in ms, or 0 if nothing was recorded yet.
+ */
+uint32_t getResponseTimePercentile(int percentile) {
+    return sketchQuantile(responseTimeSketches, NUM_DEPARTMENTS, percentile);
+}
+
+/**
+ * @brief Logs p50/p95/p99 of one statistic for every department.
+ *
+ * @param title Name of the statistic.
+ * @param sketches The department sketches.
+ */
+static void reportQuantiles(const char *title, const QuantileSketch sketches[NUM_DEPARTMENTS]) {
+    logMessage("%s (p50/p95/p99):\n", title);
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        logMessage("  %-10s n:%lu %lu/%lu/%lu\n", departmentName((uint8_t)i),
+                   (unsigned long)sketchTotal(&sketches[i], 1),
+                   (unsigned long)sketchQuantile(&sketches[i], 1, 50),
+                   (unsigned long)sketchQuantile(&sketches[i], 1, 95),
+                   (unsigned long)sketchQuantile(&sketches[i], 1, 99));
+    }
+}
+
+/**
+ * @brief Logs p50/p95/p99 of the response time for every severity, most severe first.
+ */
+static void reportSeverityQuantiles(void) {
+    const char *severityNames[] = SEVERITY_NAMES;
+
+    logMessage("Response time ms by severity (p50/p95/p99):\n");
+    for (int severity = SEVERITY_COUNT - 1; severity >= 0; severity--) {
+        const QuantileSketch *sketch = &severityResponseSketches[severity];
+        logMessage("  %-10s n:%lu %lu/%lu/%lu\n", severityNames[severity],
+                   (unsigned long)sketchTotal(sketch, 1),
+                   (unsigned long)sketchQuantile(sketch, 1, 50),
+                   (unsigned long)sketchQuantile(sketch, 1, 95),
+                   (unsigned long)sketchQuantile(sketch, 1, 99));
+    }
+}
+
+/**
+ * @brief Copies the cumulative statistics of all departments.
+ *
+ * @param executions Output array of task execution counts per department.
+ * @param vehiclesUsed Output array of total vehicles used per department.
+ */
+void getStatistics(int executions[NUM_DEPARTMENTS], int vehiclesUsed[NUM_DEPARTMENTS]) {
+    taskENTER_CRITICAL();
+    memcpy(executions, taskExecutionCounts, sizeof(taskExecutionCounts));
+    memcpy(vehiclesUsed, totalVehiclesUsed, sizeof(totalVehiclesUsed));
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Overwrites the cumulative statistics of all departments.
+ *
+ * Used to restore a checkpoint.
+ *
+ * @param executions Task execution counts per department.
+ * @param vehiclesUsed Total vehicles used per department.
+ */
+void setStatistics(const int executions[NUM_DEPARTMENTS], const int vehiclesUsed[NUM_DEPARTMENTS]) {
+    taskENTER_CRITICAL();
+    memcpy(taskExecutionCounts, executions, sizeof(taskExecutionCounts));
+    memcpy(totalVehiclesUsed, vehiclesUsed, sizeof(totalVehiclesUsed));
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Copies the quantile sketches and deadline counters.
+ *
+ * Used to save a checkpoint. The copy is not atomic: a sample recorded meanwhile
+ * may be missing from it, which is why the dispatcher records completions with
+ * the checkpoint store locked.
+ *
+ * @param statistics Receives the statistics.
+ */
+void getDetailedStatistics(DetailedStatistics *statistics) {
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        statistics->responseTime[i] = responseTimeSketches[i];
+        statistics->vehicles[i] = vehiclesSketches[i];
+        statistics->borrowSize[i] = borrowSizeSketches[i];
+        statistics->worstLatenessMs[i] = worstLatenessMs[i];
+        for (int severity = 0; severity < SEVERITY_COUNT; severity++) {
+            statistics->deadlineIncidents[i][severity] = deadlineIncidents[i][severity];
+            statistics->deadlineMisses[i][severity] = deadlineMisses[i][severity];
+        }
+    }
+    for (int severity = 0; severity < SEVERITY_COUNT; severity++) {
+        statistics->severityResponse[severity] = severityResponseSketches[severity];
+    }
+}
+
+/**
+ * @brief Overwrites the quantile sketches and deadline counters.
+ *
+ * Used to restore a checkpoint before the simulation starts.
+ *
+ * @param statistics The statistics.
+ */
+void setDetailedStatistics(const DetailedStatistics *statistics) {
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        responseTimeSketches[i] = statistics->responseTime[i];
+        vehiclesSketches[i] = statistics->vehicles[i];
+        borrowSizeSketches[i] = statistics->borrowSize[i];
+        worstLatenessMs[i] = statistics->worstLatenessMs[i];
+        for (int severity = 0; severity < SEVERITY_COUNT; severity++) {
+            deadlineIncidents[i][severity] = statistics->deadlineIncidents[i][severity];
+            deadlineMisses[i][severity] = statistics->deadlineMisses[i][severity];
+        }
+    }
+    for (int severity = 0; severity < SEVERITY_COUNT; severity++) {
+        severityResponseSketches[severity] = statistics->severityResponse[severity];
+    }
 }
 
 /**
  * @brief Generates a statistics report for all departments.
  *
- * This function logs the total task execution counts and vehicle usage for each department.
+ * This function logs the total task execution counts and vehicle usage for each department,
+ * followed by the heap usage per subsystem and the hot-path profile.
  * It provides an overview of the system's performance and resource utilization.
  */
 void generateStatisticsReport(void) {
     logMessage("Generating statistics report:\n");
-    for (int i = 0; i < 4; i++) {
-        logMessage("Department %d: Tasks executed: %d, Total vehicles used: %d\n",
-                   i, taskExecutionCounts[i], totalVehiclesUsed[i]);
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        logMessage("Department %d: Tasks executed: %d, Total vehicles used: %d, Dropped: %lu\n",
+                   i, taskExecutionCounts[i], totalVehiclesUsed[i], (unsigned long)getDroppedIncidents((uint8_t)i));
     }
+    reportDeadlines();
+    reportQuantiles("Response time ms", responseTimeSketches);
+    reportSeverityQuantiles();
+    reportQuantiles("Vehicles per incident", vehiclesSketches);
+    reportQuantiles("Borrow size", borrowSizeSketches);
+    reserveReport();
+#if VEHICLE_ALLOCATION_BATCHED
+    vehicleAllocationReport();
+#endif
+#if PREEMPTION_SUPPORTED
+    preemptionReport();
+#endif
+    historyReport(HISTORY_REPORT_WINDOW_MS);
+    heapTrackerReport();
+#if PROFILER_ENABLED
+    profilerReport();
+#endif
+#if REBALANCER_ENABLED
+    rebalancerReport();
+#endif
+#if PRIORITY_CONTROLLER_ENABLED
+    priorityControllerReport();
+#endif
 }
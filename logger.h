@@ -8,9 +8,132 @@
 #ifndef INC_LOGGER_H_
 #define INC_LOGGER_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+#include "project_defines.h"
+#include "quantile_sketch.h"
+#include "dispatcher.h"
+
+// Log severity levels (numeric so they can be compared by the preprocessor)
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+// Modules with their own runtime log level
+typedef enum {
+    LOG_MODULE_SYSTEM = 0,
+    LOG_MODULE_DISPATCHER,
+    LOG_MODULE_VEHICLE,
+    LOG_MODULE_DEPARTMENT,
+    LOG_MODULE_COUNT
+} LogModule;
+
+// Department value for aggregated events that are not tied to one department
+#define LOG_NO_DEPARTMENT 0xFF
+
+extern volatile uint8_t logModuleLevels[LOG_MODULE_COUNT];
+extern volatile bool logAggregationEnabled;
+
+/**
+ * @brief Logs a message if the module's runtime level lets it through.
+ *
+ * The check happens before the call, so filtered messages cost neither argument
+ * evaluation nor formatting.
+ */
+#define LOG_AT(module, level, ...) \
+    do { \
+        if ((level) >= logModuleLevels[(module)]) { \
+            logMessage(__VA_ARGS__); \
+        } \
+    } while (0)
+
+// Compiled-out call: still type-checked, but dead code whose arguments are never evaluated
+#define LOG_DISCARD(...) \
+    do { \
+        if (0) { \
+            logMessage(__VA_ARGS__); \
+        } \
+    } while (0)
+
+// Levels below LOG_COMPILE_LEVEL compile to nothing, including their arguments
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(module, ...) LOG_AT(module, LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(module, ...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(module, ...) LOG_AT(module, LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(module, ...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(module, ...) LOG_AT(module, LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(module, ...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(module, ...) LOG_AT(module, LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(module, ...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+/**
+ * @brief Logs a repetitive INFO event, or only counts it in aggregation mode.
+ *
+ * In aggregation mode the event is counted per (label, department) and `value`
+ * is summed; the counters are flushed as one summary line per interval.
+ */
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO_AGG(module, department, label, value, ...) \
+    do { \
+        if (LOG_LEVEL_INFO >= logModuleLevels[(module)]) { \
+            if (logAggregationEnabled) { \
+                logAggregate((label), (department), (value)); \
+            } else { \
+                logMessage(__VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+#else
+#define LOG_INFO_AGG(module, department, label, value, ...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+/**
+ * @brief Statistics beyond the counters of getStatistics, as saved in a checkpoint.
+ */
+typedef struct {
+    QuantileSketch responseTime[NUM_DEPARTMENTS];      /**< Response times in ms per department */
+    QuantileSketch severityResponse[SEVERITY_COUNT];   /**< Response times in ms per severity */
+    QuantileSketch vehicles[NUM_DEPARTMENTS];          /**< Vehicles per incident per department */
+    QuantileSketch borrowSize[NUM_DEPARTMENTS];        /**< Vehicles borrowed per reallocation per department */
+    uint32_t deadlineIncidents[NUM_DEPARTMENTS][SEVERITY_COUNT]; /**< Finished incidents */
+    uint32_t deadlineMisses[NUM_DEPARTMENTS][SEVERITY_COUNT];    /**< Late or unserved incidents */
+    int32_t worstLatenessMs[NUM_DEPARTMENTS];          /**< Latest completion past its deadline */
+} DetailedStatistics;
+
+void initLogger(void);
 void logMessage(const char *format, ...);
+void logAggregate(const char *label, uint8_t department, int value);
+void logAggregationFlush(void);
+void logSetAggregation(bool enabled);
+void logSetLevel(LogModule module, uint8_t level);
+uint8_t logGetLevel(LogModule module);
 void recordTaskExecution(int department);
 void recordVehicleUsage(int department, int count);
+void recordResponseTime(int department, uint32_t milliseconds);
+void recordSeverityResponseTime(uint8_t severity, uint32_t milliseconds);
+void recordBorrowSize(int department, int count);
+void recordDeadlineResult(int department, uint8_t severity, bool missed, int32_t latenessMs);
+uint32_t getResponseTimePercentile(int percentile);
+void getStatistics(int executions[NUM_DEPARTMENTS], int vehiclesUsed[NUM_DEPARTMENTS]);
+void setStatistics(const int executions[NUM_DEPARTMENTS], const int vehiclesUsed[NUM_DEPARTMENTS]);
+void getDetailedStatistics(DetailedStatistics *statistics);
+void setDetailedStatistics(const DetailedStatistics *statistics);
 void generateStatisticsReport(void);
 
 #endif /* INC_LOGGER_H_ */
@@ -13,6 +13,8 @@
 #include "dispatcher.h"
 #include "logger.h"
 #include "project_defines.h"
+#include "scenario.h"
+#include "vehicle_management.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
@@ -34,7 +36,8 @@ void initPolice(void) {
         return; // Exit if semaphore creation fails
     }
 
-    if (xTaskCreate(policeTask, "PoliceTask", POLICE_STACK_SIZE, NULL, POLICE_TASK_PRIORITY, NULL) == pdPASS) {
+    if (xTaskCreate(policeTask, "PoliceTask", scenarioDepartment(POLICE)->stackWords, NULL,
+                    scenarioDepartment(POLICE)->priority, NULL) == pdPASS) {
         logMessage("Police task created successfully\r\n");
     } else {
         logMessage("Failed to create Police task\r\n");
@@ -53,7 +56,7 @@ void policeTask(void *params) {
     while (1) {
         if (xSemaphoreTake(policeSemaphore, portMAX_DELAY) == pdTRUE) {
             // Simulate event handling
-            vTaskDelay(Short_DELAY);
+            vTaskDelay(getIncidentHandlingTime(POLICE));
 
             // Signal completion
             xSemaphoreGive(policeCompletionSemaphore);
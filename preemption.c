@@ -0,0 +1,241 @@
+/**
+ * @file preemption.c
+ * @brief Preemption of low-severity incidents for critical ones.
+ *
+ * When a critical incident (PREEMPTION_MIN_SEVERITY and above) cannot get its
+ * vehicles even by borrowing every idle one, the shard allocating it may take
+ * the vehicles of low-severity incidents other departments are handling
+ * (PREEMPTION_MAX_VICTIM_SEVERITY and below) instead of waiting for a
+ * completion. The preempted incidents go back to their shards as pending,
+ * with the work they had left plus PREEMPTION_RESTART_MS.
+ *
+ * A small cost model keeps the churn down:
+ * - nothing is preempted if the incidents in progress will free enough
+ *   vehicles within PREEMPTION_MIN_GAIN_MS anyway, and an incident that will
+ *   free its own vehicles that soon is not preempted either; waiting costs
+ *   less than restarting,
+ * - victims with the most vehicles are taken first, at most
+ *   PREEMPTION_MAX_VICTIMS per allocation, and none at all if they cannot
+ *   cover the shortfall together,
+ * - an incident is preempted at most PREEMPTION_MAX_PER_INCIDENT times, so
+ *   low-severity incidents are delayed but never starved,
+ * - preemptions are at least PREEMPTION_MIN_INTERVAL_MS apart.
+ *
+ * Preemption adds work (the restarts) and only moves waiting time from
+ * critical to low-severity incidents, so it starts off (PREEMPTION_ENABLED);
+ * `preempt compare` on the console shows the trade-off for the active
+ * scenario.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "preemption.h"
+
+#if PREEMPTION_SUPPORTED
+#include "dispatcher.h"
+#include "incident.h"
+#include "vehicle_management.h"
+#include "logger.h"
+#include "scenario.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/**
+ * @brief An incident in progress that could be preempted.
+ */
+typedef struct {
+    DispatchRequest request;     /**< The incident */
+    TickType_t remaining;        /**< Handling time it still needs */
+} Victim;
+
+static volatile bool preemptionEnabled = PREEMPTION_ENABLED != 0; /**< Critical incidents may preempt */
+static TickType_t lastPreemptionAt;            /**< When the last incident was preempted */
+static bool hasPreempted = false;              /**< An incident has been preempted */
+static uint32_t allocationsHelped = 0;         /**< Allocations that preempted incidents */
+static uint32_t victimsPreempted = 0;          /**< Incidents preempted */
+static uint32_t attemptsWithoutVictims = 0;    /**< Attempts that found no victims worth preempting */
+static uint32_t attemptsHeldBack = 0;          /**< Attempts within PREEMPTION_MIN_INTERVAL_MS of the last preemption */
+
+/**
+ * @brief Checks whether one victim frees more than another.
+ *
+ * @param a The first victim.
+ * @param b The second victim.
+ * @return True if a has more vehicles, or as many and more work left.
+ */
+static bool isBetterVictim(const Victim *a, const Victim *b) {
+    if (a->request.requiredVehicles != b->request.requiredVehicles) {
+        return a->request.requiredVehicles > b->request.requiredVehicles;
+    }
+    return a->remaining > b->remaining;
+}
+
+/**
+ * @brief Keeps the best PREEMPTION_MAX_VICTIMS victims, best first.
+ *
+ * @param victims The victims kept so far.
+ * @param count Number of victims kept.
+ * @param candidate The next candidate.
+ * @return Number of victims kept now.
+ */
+static int considerVictim(Victim victims[PREEMPTION_MAX_VICTIMS], int count, const Victim *candidate) {
+    if (count == PREEMPTION_MAX_VICTIMS && !isBetterVictim(candidate, &victims[count - 1])) {
+        return count;
+    }
+    int i = (count < PREEMPTION_MAX_VICTIMS) ? count++ : count - 1;
+    while (i > 0 && isBetterVictim(candidate, &victims[i - 1])) {
+        victims[i] = victims[i - 1];
+        i--;
+    }
+    victims[i] = *candidate;
+    return count;
+}
+
+/**
+ * @brief Estimates how long a shortfall lasts without preemption.
+ *
+ * @param remaining Handling time left of each incident in progress.
+ * @param vehicles Vehicles of each incident in progress.
+ * @param count Number of incidents in progress.
+ * @param shortfall Vehicles missing.
+ * @return Ticks until the incidents have freed that many vehicles, portMAX_DELAY if they never do.
+ */
+static TickType_t naturalWait(TickType_t remaining[], const uint8_t vehicles[], int count, int shortfall) {
+    TickType_t wait = 0;
+    int freed = 0;
+
+    // A few incidents cover the shortfall, so the earliest one is simply looked up each time
+    while (freed < shortfall) {
+        int next = -1;
+        for (int i = 0; i < count; i++) {
+            if (remaining[i] != portMAX_DELAY && (next < 0 || remaining[i] < remaining[next])) {
+                next = i;
+            }
+        }
+        if (next < 0) {
+            return portMAX_DELAY;
+        }
+        wait = remaining[next];
+        freed += vehicles[next];
+        remaining[next] = portMAX_DELAY;
+    }
+    return wait;
+}
+
+/**
+ * @brief Preempts low-severity incidents so a critical one can get its vehicles.
+ *
+ * Called by a shard whose allocation was denied.
+ *
+ * @param department The department index (POLICE, FIRE, etc.) allocating.
+ * @param requiredVehicles Vehicles its incident needs.
+ * @param severity Its IncidentSeverity.
+ * @return True if incidents were preempted and the allocation should be retried at once.
+ */
+bool preemptForIncident(uint8_t department, int requiredVehicles, uint8_t severity) {
+    Victim victims[PREEMPTION_MAX_VICTIMS];
+    TickType_t remaining[(NUM_DEPARTMENTS - 1) * DISPATCH_SHARD_QUEUE_LENGTH]; // Every incident in progress elsewhere
+    uint8_t vehicles[(NUM_DEPARTMENTS - 1) * DISPATCH_SHARD_QUEUE_LENGTH];
+    int inProgressCount = 0;
+    int victimCount = 0;
+    TickType_t now = xTaskGetTickCount();
+
+    if (!preemptionEnabled || severity < PREEMPTION_MIN_SEVERITY || department >= NUM_DEPARTMENTS) {
+        return false;
+    }
+    if (hasPreempted && (now - lastPreemptionAt) < pdMS_TO_TICKS(PREEMPTION_MIN_INTERVAL_MS)) {
+        attemptsHeldBack++;
+        return false;
+    }
+    int shortfall = getAllocationShortfall(department, requiredVehicles, severity);
+    if (shortfall == 0) {
+        return false; // Lost to another request of the batch; retrying is enough
+    }
+
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+        DispatchRequest inProgress[DISPATCH_SHARD_QUEUE_LENGTH];
+        int count = (d == department) ? 0 : getIncidentsInProgress(d, inProgress, DISPATCH_SHARD_QUEUE_LENGTH);
+        for (int i = 0; i < count; i++) {
+            Victim candidate = {.request = inProgress[i]};
+            if (!incidentRemainingTime(candidate.request.id, &candidate.remaining)) {
+                continue; // Just finished
+            }
+            remaining[inProgressCount] = candidate.remaining;
+            vehicles[inProgressCount++] = candidate.request.requiredVehicles;
+            // Too severe, preempted often enough already, or about to free its vehicles anyway
+            if (candidate.request.severity > PREEMPTION_MAX_VICTIM_SEVERITY ||
+                candidate.request.preemptions >= PREEMPTION_MAX_PER_INCIDENT ||
+                candidate.remaining < pdMS_TO_TICKS(PREEMPTION_MIN_GAIN_MS)) {
+                continue;
+            }
+            victimCount = considerVictim(victims, victimCount, &candidate);
+        }
+    }
+    if (naturalWait(remaining, vehicles, inProgressCount, shortfall) < pdMS_TO_TICKS(PREEMPTION_MIN_GAIN_MS)) {
+        attemptsWithoutVictims++;
+        return false; // Completions will cover it soon enough
+    }
+
+    // The fewest victims that cover the shortfall, or none if they cannot
+    int needed = 0;
+    int freed = 0;
+    while (needed < victimCount && freed < shortfall) {
+        freed += victims[needed++].request.requiredVehicles;
+    }
+    if (freed < shortfall) {
+        attemptsWithoutVictims++;
+        return false;
+    }
+
+    int preempted = 0;
+    for (int i = 0; i < needed; i++) {
+        if (preemptIncident(&victims[i].request)) {
+            preempted++;
+            LOG_INFO(LOG_MODULE_DISPATCHER, "%s incident %u preempted for %s, %lu ms of work left\r\n",
+                     departmentName(victims[i].request.department), (unsigned)victims[i].request.id,
+                     departmentName(department),
+                     (unsigned long)(victims[i].remaining * portTICK_PERIOD_MS));
+        }
+    }
+    if (preempted == 0) {
+        return false; // They finished meanwhile, so their vehicles are idle anyway
+    }
+
+    taskENTER_CRITICAL();
+    lastPreemptionAt = now;
+    hasPreempted = true;
+    allocationsHelped++;
+    victimsPreempted += (uint32_t)preempted;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+/**
+ * @brief Checks whether critical incidents may preempt.
+ *
+ * @return True if preemption is on.
+ */
+bool getPreemptionEnabled(void) {
+    return preemptionEnabled;
+}
+
+/**
+ * @brief Enables or disables preemption.
+ *
+ * @param enabled True to let critical incidents preempt.
+ */
+void setPreemptionEnabled(bool enabled) {
+    preemptionEnabled = enabled;
+}
+
+/**
+ * @brief Logs the preemption statistics.
+ */
+void preemptionReport(void) {
+    logMessage("Preemption %s: %lu incidents preempted for %lu allocations\n",
+               preemptionEnabled ? "on" : "off", (unsigned long)victimsPreempted, (unsigned long)allocationsHelped);
+    logMessage("  %lu attempts found no victims worth it, %lu held back by the interval\n",
+               (unsigned long)attemptsWithoutVictims, (unsigned long)attemptsHeldBack);
+}
+#endif
@@ -0,0 +1,33 @@
+/*
+ * preemption.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file preemption.h
+/// @brief Preemption of low-severity incidents for critical ones.
+
+#ifndef INC_PREEMPTION_H_
+#define INC_PREEMPTION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "project_defines.h"
+
+/**
+ * @brief Preemption is built in.
+ *
+ * Only the batched allocator sees the vehicles of incidents in progress as
+ * committed, and only timed incidents can be stopped; department tasks cannot.
+ */
+#define PREEMPTION_SUPPORTED (VEHICLE_ALLOCATION_BATCHED && INCIDENT_HANDLER_MODE != INCIDENT_HANDLER_TASKS)
+
+#if PREEMPTION_SUPPORTED
+bool preemptForIncident(uint8_t department, int requiredVehicles, uint8_t severity);
+bool getPreemptionEnabled(void);
+void setPreemptionEnabled(bool enabled);
+void preemptionReport(void);
+#endif
+
+#endif /* INC_PREEMPTION_H_ */
@@ -0,0 +1,179 @@
+/**
+ * @file priority_controller.c
+ * @brief Backlog-aware dynamic priorities for the dispatcher shards.
+ *
+ * Every PRIORITY_CONTROLLER_PERIOD the controller looks at each department's
+ * pending incidents and how long the oldest one has waited. A department with
+ * at least PRIORITY_RAISE_PENDING pending incidents, or one waiting
+ * PRIORITY_RAISE_AGE_MS or longer, becomes a candidate; the candidates with
+ * the highest pressure
+ *
+ *     pending * PRIORITY_BACKLOG_WEIGHT_MS + oldest wait in ms
+ *
+ * get their shard raised by PRIORITY_BOOST_LEVELS, at most
+ * PRIORITY_MAX_BOOSTED departments at a time. A boosted shard wins the
+ * reallocation semaphore and the vehicle mutex ahead of the others, since
+ * FreeRTOS hands them to the highest-priority waiter.
+ *
+ * Hysteresis: a boost is only dropped once the backlog is empty and at least
+ * PRIORITY_MIN_BOOST_MS have passed. Against starvation a boost never lasts
+ * longer than PRIORITY_MAX_BOOST_MS; the department is then lowered and
+ * cannot be raised again for PRIORITY_COOLDOWN_MS, giving the others their
+ * turn.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "priority_controller.h"
+#include "dispatcher.h"
+#include "logger.h"
+#include "profiler.h"
+#include "scenario.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/**
+ * @brief Boost state of one department.
+ */
+typedef struct {
+    bool boosted;              /**< The shard runs above its base priority */
+    TickType_t boostedSince;   /**< Tick count when the current boost started */
+    TickType_t cooldownUntil;  /**< Tick count before which no new boost is given */
+    uint32_t boosts;           /**< Number of boosts given */
+    uint32_t forcedReleases;   /**< Boosts ended by PRIORITY_MAX_BOOST_MS */
+    uint32_t boostedMs;        /**< Total time spent boosted, finished boosts only */
+} DepartmentBoost;
+
+static DepartmentBoost boostStates[NUM_DEPARTMENTS]; /**< Written only by the controller task */
+
+/**
+ * @brief Initializes the priority controller task.
+ */
+void initPriorityController(void) {
+    if (xTaskCreate(priorityControllerTask, "PriorityControl", PRIORITY_CONTROLLER_STACK_SIZE, NULL,
+                    PRIORITY_CONTROLLER_PRIORITY, NULL) == pdPASS) {
+        logMessage("Priority controller task created successfully\r\n");
+    } else {
+        logMessage("Failed to create priority controller task\r\n");
+    }
+}
+
+/**
+ * @brief Tells whether a department's shard is currently boosted.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return True if the shard runs above DISPATCH_SHARD_PRIORITY.
+ */
+bool priorityIsBoosted(uint8_t department) {
+    return department < NUM_DEPARTMENTS && boostStates[department].boosted;
+}
+
+/**
+ * @brief Raises or lowers a department's shard.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param boosted True to raise the shard, false to restore its base priority.
+ * @param now The current tick count.
+ */
+static void setBoost(uint8_t department, bool boosted, TickType_t now) {
+    DepartmentBoost *state = &boostStates[department];
+    TaskHandle_t shard = getShardTask(department);
+
+    if (shard == NULL || state->boosted == boosted) {
+        return;
+    }
+    if (boosted) {
+        state->boostedSince = now;
+        state->boosts++;
+    } else {
+        state->boostedMs += (now - state->boostedSince) * portTICK_PERIOD_MS;
+    }
+    state->boosted = boosted;
+    vTaskPrioritySet(shard, DISPATCH_SHARD_PRIORITY + (boosted ? PRIORITY_BOOST_LEVELS : 0));
+}
+
+/**
+ * @brief Runs one control step over all departments.
+ */
+static void controlStep(void) {
+    PROFILE_BEGIN(PROF_PRIORITY_CONTROL);
+    TickType_t now = xTaskGetTickCount();
+    uint32_t pressure[NUM_DEPARTMENTS];
+    bool candidate[NUM_DEPARTMENTS];
+    int boostedCount = 0;
+
+    for (uint8_t i = 0; i < NUM_DEPARTMENTS; i++) {
+        DepartmentBoost *state = &boostStates[i];
+        uint32_t pending = (uint32_t)getShardQueueDepth(i);
+        uint32_t ageMs = getOldestPendingAge(i) * portTICK_PERIOD_MS;
+
+        pressure[i] = pending * PRIORITY_BACKLOG_WEIGHT_MS + ageMs;
+        candidate[i] = pending >= PRIORITY_RAISE_PENDING || ageMs >= PRIORITY_RAISE_AGE_MS;
+
+        if (state->boosted) {
+            TickType_t heldMs = (now - state->boostedSince) * portTICK_PERIOD_MS;
+            if (heldMs >= PRIORITY_MAX_BOOST_MS) {
+                setBoost(i, false, now);
+                state->forcedReleases++;
+                state->cooldownUntil = now + pdMS_TO_TICKS(PRIORITY_COOLDOWN_MS);
+            } else if (pending == 0 && heldMs >= PRIORITY_MIN_BOOST_MS) {
+                setBoost(i, false, now);
+            }
+        }
+        boostedCount += state->boosted ? 1 : 0;
+    }
+
+    while (boostedCount < PRIORITY_MAX_BOOSTED) {
+        int best = -1;
+        for (uint8_t i = 0; i < NUM_DEPARTMENTS; i++) {
+            const DepartmentBoost *state = &boostStates[i];
+            if (!candidate[i] || state->boosted || (int32_t)(now - state->cooldownUntil) < 0) {
+                continue;
+            }
+            if (best < 0 || pressure[i] > pressure[best]) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        setBoost((uint8_t)best, true, now);
+        boostedCount++;
+    }
+    PROFILE_END(PROF_PRIORITY_CONTROL);
+}
+
+/**
+ * @brief Logs how often and how long each department was boosted.
+ */
+void priorityControllerReport(void) {
+    TickType_t now = xTaskGetTickCount();
+
+    logMessage("Priority boosts (+%d, at most %d departments):\n", PRIORITY_BOOST_LEVELS, PRIORITY_MAX_BOOSTED);
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        const DepartmentBoost *state = &boostStates[i];
+        uint32_t boostedMs = state->boostedMs;
+        if (state->boosted) {
+            boostedMs += (now - state->boostedSince) * portTICK_PERIOD_MS;
+        }
+        logMessage("  %-10s boosts:%lu forced releases:%lu boosted:%lu ms%s\n", departmentName(i),
+                   (unsigned long)state->boosts, (unsigned long)state->forcedReleases, (unsigned long)boostedMs,
+                   state->boosted ? " (now)" : "");
+    }
+}
+
+/**
+ * @brief Priority controller task: adjusts the shard priorities once per period.
+ *
+ * @param params Unused task parameters.
+ */
+void priorityControllerTask(void *params) {
+    TickType_t lastWake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&lastWake, PRIORITY_CONTROLLER_PERIOD);
+        controlStep();
+    }
+}
@@ -0,0 +1,22 @@
+/*
+ * priority_controller.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file priority_controller.h
+/// @brief Backlog-aware dynamic shard priority interface.
+
+#ifndef INC_PRIORITY_CONTROLLER_H_
+#define INC_PRIORITY_CONTROLLER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void initPriorityController(void);
+bool priorityIsBoosted(uint8_t department);
+void priorityControllerReport(void);
+void priorityControllerTask(void *params);
+
+#endif /* INC_PRIORITY_CONTROLLER_H_ */
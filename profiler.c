@@ -0,0 +1,311 @@
+/**
+ * @file profiler.c
+ * @brief Scoped hot-path profiling with per-task statistics slots.
+ *
+ * Each task records into its own slot, so the hot path never takes a lock: a
+ * slot has exactly one writer. A task claims a free slot on its first sample
+ * and keeps it in its task number (nothing else sets task numbers); the slot
+ * is released when the task is deleted (traceTASK_DELETE) and its samples stay
+ * in the report. Samples of tasks beyond PROFILER_MAX_TASKS, and of code run
+ * before the scheduler starts, are only counted. The report
+ * merges all slots into per-region count/min/max/mean and a log2 histogram.
+ * Values are CPU cycles on the board and nanoseconds on the host.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "profiler.h"
+#include "logger.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
+
+/**
+ * @brief Statistics of one region as seen by one task.
+ */
+typedef struct {
+    uint32_t count;                                  /**< Number of samples */
+    uint32_t min;                                    /**< Shortest sample */
+    uint32_t max;                                    /**< Longest sample */
+    uint64_t total;                                  /**< Sum of all samples */
+    uint32_t histogram[PROFILER_HISTOGRAM_BUCKETS];  /**< Bucket i counts samples in [2^i, 2^(i+1)) */
+} ProfileStats;
+
+static const char *profileRegionNames[PROF_REGION_COUNT] = {
+    "checkAndAllocateVehicles", "reallocateVehicles", "getVehicleCount", "logMessage",
+    "generateIncident", "completeIncident", "incidentPhase", "checkpointHold", "moveIdleVehicles",
+    "priorityControl"
+};
+
+static ProfileStats profileSlots[PROFILER_MAX_TASKS][PROF_REGION_COUNT]; /**< Per-task, per-region statistics */
+static TaskHandle_t slotOwners[PROFILER_MAX_TASKS];  /**< Task recording into each slot, NULL = free */
+static volatile uint32_t unrecordedSamples = 0;      /**< Samples of tasks that found no free slot */
+
+/**
+ * @brief A lock whose statistics are part of the report.
+ */
+typedef struct {
+    const char *name;
+    LockStats *stats;
+} ProfiledLock;
+
+static ProfiledLock profiledLocks[PROFILER_MAX_LOCKS]; /**< Registered locks */
+static int profiledLockCount = 0;                      /**< Number of used entries in profiledLocks */
+
+/**
+ * @brief Starts the profiling clock.
+ *
+ * On the board this enables the DWT cycle counter, which is off after reset.
+ * Also used by the kernel to start its run-time statistics counter.
+ */
+void profilerStartClock(void) {
+#if defined(STM32F746xx)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55; // Unlock the DWT registers (Cortex-M7)
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/**
+ * @brief Reads the profiling clock for the kernel's run-time statistics.
+ *
+ * @return The current clock value.
+ */
+uint32_t profilerRunTimeCounter(void) {
+    return profilerNow();
+}
+
+/**
+ * @brief Initializes the profiler: starts the clock and clears all samples.
+ */
+void profilerInit(void) {
+    profilerStartClock();
+    profilerReset();
+}
+
+/**
+ * @brief Gets the slot of the calling task, claiming a free one on its first sample.
+ *
+ * @return The slot index, or -1 if there is no task or no free slot.
+ */
+static int taskSlot(void) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    int slot = -1;
+
+    if (task == NULL) {
+        return -1;
+    }
+    UBaseType_t number = uxTaskGetTaskNumber(task);
+    if (number > 0) {
+        return (int)number - 1; // Offset by one, so 0 means no slot yet
+    }
+
+    taskENTER_CRITICAL();
+    for (int i = 0; i < PROFILER_MAX_TASKS; i++) {
+        if (slotOwners[i] == NULL) {
+            slotOwners[i] = task;
+            slot = i;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+    if (slot >= 0) {
+        vTaskSetTaskNumber(task, (UBaseType_t)slot + 1);
+    }
+    return slot;
+}
+
+/**
+ * @brief Releases the slot of a deleted task.
+ *
+ * Called by the kernel from traceTASK_DELETE, inside its critical section. The
+ * slot keeps its samples; the next task to claim it adds to them.
+ *
+ * @param task The task being deleted.
+ */
+void profilerTaskDeleted(void *task) {
+    for (int i = 0; i < PROFILER_MAX_TASKS; i++) {
+        if (slotOwners[i] == (TaskHandle_t)task) {
+            slotOwners[i] = NULL;
+        }
+    }
+}
+
+/**
+ * @brief Records one sample of a region for the calling task.
+ *
+ * @param region The profiled region.
+ * @param elapsed Duration of the sample in clock units.
+ */
+void profilerRecord(ProfileRegion region, uint32_t elapsed) {
+    if (region >= PROF_REGION_COUNT) {
+        return;
+    }
+
+    int slot = taskSlot();
+    if (slot < 0) {
+        unrecordedSamples++;
+        return;
+    }
+    ProfileStats *stats = &profileSlots[slot][region];
+
+    int bucket = (elapsed == 0) ? 0 : 31 - __builtin_clz(elapsed);
+    if (bucket >= PROFILER_HISTOGRAM_BUCKETS) {
+        bucket = PROFILER_HISTOGRAM_BUCKETS - 1;
+    }
+
+    if (stats->count == 0 || elapsed < stats->min) {
+        stats->min = elapsed;
+    }
+    if (elapsed > stats->max) {
+        stats->max = elapsed;
+    }
+    stats->total += elapsed;
+    stats->histogram[bucket]++;
+    stats->count++;
+}
+
+/**
+ * @brief Clears all collected samples.
+ */
+void profilerReset(void) {
+    memset(profileSlots, 0, sizeof(profileSlots));
+    unrecordedSamples = 0;
+}
+
+/**
+ * @brief Merges the statistics of one region over all task slots.
+ *
+ * Slots are read without locking, so a sample recorded meanwhile may be only
+ * partially included.
+ *
+ * @param region The profiled region.
+ * @param merged Receives the merged statistics.
+ */
+static void mergeRegion(ProfileRegion region, ProfileStats *merged) {
+    memset(merged, 0, sizeof(*merged));
+    for (int slot = 0; slot < PROFILER_MAX_TASKS; slot++) {
+        const ProfileStats *stats = &profileSlots[slot][region];
+        if (stats->count == 0) {
+            continue;
+        }
+        if (merged->count == 0 || stats->min < merged->min) {
+            merged->min = stats->min;
+        }
+        if (stats->max > merged->max) {
+            merged->max = stats->max;
+        }
+        merged->count += stats->count;
+        merged->total += stats->total;
+        for (int b = 0; b < PROFILER_HISTOGRAM_BUCKETS; b++) {
+            merged->histogram[b] += stats->histogram[b];
+        }
+    }
+}
+
+/**
+ * @brief Gets the merged statistics of one region.
+ *
+ * @param region The profiled region.
+ * @param summary Receives count/min/max/mean in clock units.
+ * @return True if the region has samples.
+ */
+bool profilerSummary(ProfileRegion region, ProfileSummary *summary) {
+    ProfileStats merged;
+
+    if (region >= PROF_REGION_COUNT) {
+        return false;
+    }
+    mergeRegion(region, &merged);
+    summary->count = merged.count;
+    summary->min = merged.min;
+    summary->max = merged.max;
+    summary->mean = (merged.count > 0) ? (uint32_t)(merged.total / merged.count) : 0;
+    return merged.count > 0;
+}
+
+/**
+ * @brief Converts a profiler clock interval to nanoseconds.
+ *
+ * @param elapsed Interval in clock units.
+ * @return The interval in nanoseconds.
+ */
+uint64_t profilerToNs(uint32_t elapsed) {
+#if defined(STM32F746xx)
+    return ((uint64_t)elapsed * 1000000000ULL) / SystemCoreClock;
+#else
+    return elapsed;
+#endif
+}
+
+/**
+ * @brief Converts a sum of clock intervals to microseconds without overflowing.
+ */
+static uint64_t totalToUs(uint64_t total) {
+#if defined(STM32F746xx)
+    return total / (SystemCoreClock / 1000000U);
+#else
+    return total / 1000U;
+#endif
+}
+
+/**
+ * @brief Adds a lock's statistics to the report.
+ *
+ * Call during initialization, before the scheduler starts.
+ *
+ * @param name Name of the lock in the report.
+ * @param stats Statistics kept by the lock's owner.
+ */
+void profilerRegisterLock(const char *name, LockStats *stats) {
+    if (profiledLockCount < PROFILER_MAX_LOCKS) {
+        profiledLocks[profiledLockCount].name = name;
+        profiledLocks[profiledLockCount].stats = stats;
+        profiledLockCount++;
+    }
+}
+
+/**
+ * @brief Logs the merged statistics of every region and of the registered locks.
+ */
+void profilerReport(void) {
+#if defined(STM32F746xx)
+    const char *unit = "cycles";
+#else
+    const char *unit = "ns";
+#endif
+
+    logMessage("Profile report (%s):\r\n", unit);
+    for (int region = 0; region < PROF_REGION_COUNT; region++) {
+        ProfileStats merged;
+
+        mergeRegion((ProfileRegion)region, &merged);
+        if (merged.count == 0) {
+            continue;
+        }
+
+        logMessage("  %-24s n:%lu min:%lu max:%lu mean:%lu\r\n", profileRegionNames[region],
+                   (unsigned long)merged.count, (unsigned long)merged.min, (unsigned long)merged.max,
+                   (unsigned long)(merged.total / merged.count));
+        for (int b = 0; b < PROFILER_HISTOGRAM_BUCKETS; b++) {
+            if (merged.histogram[b] > 0) {
+                logMessage("    >=%-10lu %lu\r\n", 1UL << b, (unsigned long)merged.histogram[b]);
+            }
+        }
+    }
+
+    if (unrecordedSamples > 0) {
+        logMessage("  %lu samples not recorded: more than %d tasks\r\n", (unsigned long)unrecordedSamples,
+                   PROFILER_MAX_TASKS);
+    }
+
+    for (int i = 0; i < profiledLockCount; i++) {
+        const LockStats *stats = profiledLocks[i].stats;
+        logMessage("  lock %-19s taken:%lu held total:%lu us max:%lu us\r\n", profiledLocks[i].name,
+                   (unsigned long)stats->acquisitions, (unsigned long)totalToUs(stats->holdTotal),
+                   (unsigned long)(profilerToNs(stats->holdMax) / 1000U));
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * profiler.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file profiler.h
+/// @brief Scoped hot-path profiling interface.
+///
+/// Wrap a region with PROFILE_BEGIN(region) / PROFILE_END(region). Both macros
+/// compile to nothing when PROFILER_ENABLED is 0.
+
+#ifndef INC_PROFILER_H_
+#define INC_PROFILER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "project_defines.h"
+
+#if defined(STM32F746xx)
+#include "stm32f7xx_hal.h"
+#else
+#include <time.h>
+#endif
+
+typedef enum {
+    PROF_CHECK_AND_ALLOCATE = 0,
+    PROF_REALLOCATE,
+    PROF_GET_VEHICLE_COUNT,
+    PROF_LOG_MESSAGE,
+    PROF_GENERATE_INCIDENT,
+    PROF_COMPLETE_INCIDENT,
+    PROF_INCIDENT_PHASE,
+    PROF_CHECKPOINT_HOLD,
+    PROF_MOVE_IDLE_VEHICLES,
+    PROF_PRIORITY_CONTROL,
+    PROF_REGION_COUNT
+} ProfileRegion;
+
+/**
+ * @brief Statistics of one region merged over all tasks.
+ */
+typedef struct {
+    uint32_t count;    /**< Number of samples */
+    uint32_t min;      /**< Shortest sample */
+    uint32_t max;      /**< Longest sample */
+    uint32_t mean;     /**< Average sample */
+} ProfileSummary;
+
+/**
+ * @brief Reads the profiling clock.
+ *
+ * CPU cycles from the DWT cycle counter on the board, nanoseconds from the
+ * monotonic clock on the host.
+ */
+static inline uint32_t profilerNow(void) {
+#if defined(STM32F746xx)
+    return DWT->CYCCNT;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec);
+#endif
+}
+
+/**
+ * @brief Acquisitions and hold times of one lock.
+ *
+ * Updated only by the lock's current holder, so it needs no lock of its own.
+ */
+typedef struct {
+    uint32_t acquisitions;   /**< Number of times the lock was taken */
+    uint32_t holdMax;        /**< Longest hold in clock units */
+    uint64_t holdTotal;      /**< Sum of all holds in clock units */
+    uint32_t takenAt;        /**< Clock when the current holder took the lock */
+} LockStats;
+
+/**
+ * @brief Call right after taking the lock.
+ */
+static inline void lockStatsAcquired(LockStats *stats) {
+    stats->acquisitions++;
+    stats->takenAt = profilerNow();
+}
+
+/**
+ * @brief Call right before giving the lock back.
+ */
+static inline void lockStatsReleased(LockStats *stats) {
+    uint32_t held = profilerNow() - stats->takenAt;
+    stats->holdTotal += held;
+    if (held > stats->holdMax) {
+        stats->holdMax = held;
+    }
+}
+
+void profilerStartClock(void);
+uint32_t profilerRunTimeCounter(void);
+void profilerInit(void);
+void profilerRecord(ProfileRegion region, uint32_t elapsed);
+void profilerTaskDeleted(void *task);
+void profilerReset(void);
+bool profilerSummary(ProfileRegion region, ProfileSummary *summary);
+uint64_t profilerToNs(uint32_t elapsed);
+void profilerRegisterLock(const char *name, LockStats *stats);
+void profilerReport(void);
+
+#if PROFILER_ENABLED
+#define PROFILE_BEGIN(region) const uint32_t profileStart_##region = profilerNow()
+#define PROFILE_END(region) profilerRecord((region), profilerNow() - profileStart_##region)
+#else
+#define PROFILE_BEGIN(region) do { } while (0)
+#define PROFILE_END(region) do { } while (0)
+#endif
+
+#endif /* INC_PROFILER_H_ */
@@ -18,6 +18,7 @@
 #define AMBULANCE_TASK_PRIORITY 3
 #define CORONA_TASK_PRIORITY 3
 #define RANDOM_EVENT_PRIORITY 5
+#define DISPATCH_SHARD_PRIORITY 4
 
 // Task stack sizes
 #define POLICE_STACK_SIZE 256
@@ -26,6 +27,22 @@
 #define CORONA_STACK_SIZE 256
 #define LOGGER_STACK_SIZE 256
 #define RANDOM_EVENT_STACK_SIZE 256
+// Tasks that put O(NUM_DEPARTMENTS) arrays on their stack grow by this much per department past the first four:
+// preemption lists every incident in progress elsewhere (5 bytes each, DISPATCH_SHARD_QUEUE_LENGTH per department)
+#define STACK_WORDS_PER_DEPARTMENT ((5 * DISPATCH_SHARD_QUEUE_LENGTH + 3) / 4)
+#define DEPARTMENT_SCALED_STACK(words) ((words) + STACK_WORDS_PER_DEPARTMENT * (NUM_DEPARTMENTS - 4))
+#define DISPATCH_SHARD_STACK_SIZE DEPARTMENT_SCALED_STACK(256) // Planning and preemption scratch
+
+// Department model
+#define NUM_DEPARTMENTS 4                   // Police, Fire, Ambulance, Corona, then generic "DeptN" departments
+#define EXTRA_DEPARTMENT_FLEET 2            // Initial vehicles of each department past the first four
+#define EXTRA_DEPARTMENT_RESERVE 1          // Its reserve floor
+#define EXTRA_DEPARTMENT_DEADLINE_MS {3000, 2000, 1200} // Its deadlines: low, medium, high
+
+// FreeRTOS heap, in bytes (configTOTAL_HEAP_SIZE); stacks are 4-byte words
+#define SHARD_HEAP_BYTES (4 * DISPATCH_SHARD_STACK_SIZE + 512) // Per department: shard stack, TCB, intake queue, semaphore
+#define SCALED_TASKS_HEAP_BYTES (4 * 4 * STACK_WORDS_PER_DEPARTMENT * (NUM_DEPARTMENTS - 4)) // Console, telemetry, rebalancer, controller growth
+#define FIXED_HEAP_BYTES 14336 // Every other task, queue and timer; the benchmark build uses the shards' share
 
 // Vehicle counts
 #define POLICE_COUNT_INITIAL 3
@@ -36,14 +53,169 @@
 // Logger defines
 #define LOGGER_QUEUE_LENGTH 10
 #define LOGGER_MESSAGE_SIZE 128
+#define LOG_COMPILE_LEVEL 0            // LOG_LEVEL_DEBUG; calls below this level are compiled out
+#define LOG_DEFAULT_LEVEL 1            // LOG_LEVEL_INFO; initial runtime level of every module
+#define LOG_AGGREGATION_ENABLED 1      // Initial state of the aggregation mode
+#define LOG_AGGREGATION_SLOTS 32
+#define LOG_AGGREGATION_INTERVAL pdMS_TO_TICKS(10000)
+#define LOGGER_PRIORITY 1                   // Flushes the aggregated events, below the simulation
+#define SKETCH_SUB_BUCKET_BITS 3       // Quantile sketch resolution: 1/16 relative error
+#define SKETCH_RANGE_BITS 16           // Quantile sketch range: values up to 65535
+
+// Dispatcher defines
+#define DISPATCH_SHARD_QUEUE_LENGTH 4                          // Incidents a department's shard can hold
+#define DISPATCH_MAX_OUTSTANDING (NUM_DEPARTMENTS * DISPATCH_SHARD_QUEUE_LENGTH)
+
+// Timer wheel defines
+#define TIMER_WHEEL_ENABLED 1
+#define TIMER_WHEEL_PRIORITY 5              // Above the shards so phases advance on time
+#define TIMER_WHEEL_STACK_SIZE 256
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6             // 4 levels x 64 slots: delays up to 2^24 ticks
+
+// Incident handler defines
+#define INCIDENT_HANDLER_TASKS 0                               // One blocking task per department
+#define INCIDENT_HANDLER_TIMERS 1                              // Phases driven by software timers
+#define INCIDENT_HANDLER_PROTOTHREADS 2                        // Stackless handlers in one worker task
+#define INCIDENT_HANDLER_MODE INCIDENT_HANDLER_TIMERS
+#define INCIDENT_POOL_SIZE DISPATCH_MAX_OUTSTANDING            // Incidents in progress at once
+#define INCIDENT_PHASE_SHARES {10, 30, 40, 20}                 // % of handling time: dispatch, travel, on scene, return
+#define INCIDENT_WORKER_PRIORITY 5                             // Protothread worker, above the shards
+#define INCIDENT_WORKER_STACK_SIZE 256
 
 // General defines
 #define MAX_CARS 11
+#define VEHICLE_ALLOCATION_BATCHED 1         // 1 = combine concurrent allocations under one vehicle lock
+#define VEHICLE_BATCH_SLOTS 8                // Callers that can publish a request at once
 #define NULL_PARAM NULL
 #define DEFAULT_DELAY pdMS_TO_TICKS(1000)
 #define Short_DELAY pdMS_TO_TICKS(500)
 
+// History defines
+#define HISTORY_BUCKETS 60                  // Per-department ring of time buckets
+#define HISTORY_BUCKET_MS 10000             // 60 x 10 s = last 10 minutes
+#define HISTORY_REPORT_WINDOW_MS 300000     // Window shown in the statistics report
+
+// Stack monitor defines
+#define STACK_MONITOR_ENABLED 1
+#define STACK_MONITOR_PRIORITY 1
+#define STACK_MONITOR_STACK_SIZE 256
+#define STACK_MONITOR_MAX_TASKS (16 + NUM_DEPARTMENTS) // Every task, one shard per department; telemetry uses it too
+#define STACK_MONITOR_MARGIN_WORDS 32
+#define STACK_MONITOR_PERIOD pdMS_TO_TICKS(2000)
+#define STACK_MONITOR_REPORT_EVERY 15
+#define STACK_MONITOR_STRESS 0            // 1 = back-to-back events to exercise worst-case paths
+#define STRESS_EVENT_DELAY pdMS_TO_TICKS(10)
+
+// Heap tracker defines
+#define HEAP_TRACKER_MAX_BLOCKS 64
+
+// Profiler defines
+#define PROFILER_ENABLED 1
+#define PROFILER_MAX_TASKS 24              // Tasks with their own statistics slot; more are only counted
+#define PROFILER_HISTOGRAM_BUCKETS 24
+#define PROFILER_MAX_LOCKS 4                // Locks whose acquisitions and hold times are reported
+
+// Checkpoint defines
+#define CHECKPOINT_ENABLED 1
+#define CHECKPOINT_RESTORE_AT_STARTUP 0   // 1 = a warm reset resumes the state kept in .noinit RAM
+#define CHECKPOINT_FILE "citysim.ckpt"     // Default file of "checkpoint export" on the host
+#define CHECKPOINT_JOURNAL_LENGTH 32      // Journal records between snapshots
+
+// Scenario defines
+#define SCENARIO_TEXT ""                  // Scenario applied on top of the defaults at startup
+#define SCENARIO_ARENA_SIZE (256 + 64 * NUM_DEPARTMENTS) // Department configs and names
+#define SCENARIO_FILE_MAX 2048
+#define SCENARIO_DEFAULT_ARRIVAL_MS 500
+#define SCENARIO_DEFAULT_HANDLING_MS 500
+
+// Console defines
+#define CONSOLE_ENABLED 1
+#define CONSOLE_PRIORITY 1
+#define CONSOLE_STACK_SIZE DEPARTMENT_SCALED_STACK(256) // Per-department reports and the offline comparison
+#define CONSOLE_IRQ_PRIORITY 6              // Must be >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+#define CONSOLE_RX_BUFFER_SIZE 64
+#define CONSOLE_LINE_SIZE 48
+
+// Telemetry defines
+#define TELEMETRY_ENABLED 1
+#define TELEMETRY_PRIORITY 2
+#define TELEMETRY_STACK_SIZE DEPARTMENT_SCALED_STACK(256)
+#define TELEMETRY_PERIOD pdMS_TO_TICKS(1000)
+
+// Benchmark defines
+#define BENCHMARK_ENABLED 0                 // 1 = run the microbenchmarks instead of the simulation
+#define BENCHMARK_ITERATIONS 2000
+#define BENCHMARK_LOG_ITERATIONS 50
+#define BENCHMARK_MAX_CONTENDERS 4
+#define BENCHMARK_WORKER_PRIORITY 2
+#define BENCHMARK_STACK_SIZE DEPARTMENT_SCALED_STACK(256) // Runs the shards' allocation path
+#define BENCHMARK_TIMER_COUNT 1600          // Largest number of concurrent timeouts in the timer benchmark
+#define BENCHMARK_CAPACITY_MAX 512          // Most concurrent incidents tried by the capacity benchmark
+#define BENCHMARK_HEAP_RESERVE 1024         // Heap bytes the capacity benchmark leaves free
+#define BENCHMARK_SCALE_FLEET 100           // Vehicles per department in the scaling benchmark
+#define BENCHMARK_SCALE_ITERATIONS 500      // Donor selections and allocations timed by the scaling benchmark
+
+// Rebalancer defines
+#define REBALANCER_ENABLED 1
+#define REBALANCER_PRIORITY 1
+#define REBALANCER_STACK_SIZE DEPARTMENT_SCALED_STACK(256)
+#define REBALANCER_PERIOD pdMS_TO_TICKS(1000)
+#define REBALANCER_EWMA_SHIFT 3             // Smoothing factor 1/8 per period
+#define REBALANCER_MAX_MOVES 2              // Vehicles moved per period at most
+
+// Reallocation policy defines
+#define REALLOCATION_POLICY_DEFAULT REALLOCATION_FIXED_ORDER // Donor order of the original code
+#define REALLOCATION_COMPARE_INCIDENTS 2000 // Incidents in each run of a policy comparison
+#define REALLOCATION_COMPARE_SEED 2026      // Same seed, so both policies see the same incidents
+#define REALLOCATION_COMPARE_MAX_WAITING 64 // Waiting incidents simulated at most; more are dropped
+#define REALLOCATION_COMPARE_MAX_ACTIVE 32  // Incidents simulated in progress at most
+#define REALLOCATION_COMPARE_TRANSFER_MS 200 // Time borrowed vehicles need to reach the borrower
+#define REALLOCATION_STARVATION_MS 2000     // An incident waiting longer than this counts as starved
+
+// Reserve floor defines
+#define RESERVE_FLOORS_ENABLED 0            // Off by default: see `reserve compare` for the trade-off
+#define RESERVE_FLOORS {1, 1, 1, 1}         // Vehicles per department never lent to routine incidents
+#define RESERVE_OVERRIDE_SEVERITY SEVERITY_HIGH // Incidents this severe may borrow reserve vehicles
+#define RESERVE_OVERRIDE_AFTER_MS 2000      // Any incident waiting this long for vehicles may too
+#define RESERVE_CASCADE_WINDOW_MS 2000      // A lender borrowing within this time is a cascade
+
+// Preemption defines (need VEHICLE_ALLOCATION_BATCHED and timer or protothread incidents)
+#define PREEMPTION_ENABLED 0                // Off by default: see `preempt compare` for the trade-off
+#define PREEMPTION_MIN_SEVERITY SEVERITY_HIGH // Incidents this severe may preempt...
+#define PREEMPTION_MAX_VICTIM_SEVERITY SEVERITY_LOW // ...incidents at most this severe
+#define PREEMPTION_MAX_PER_INCIDENT 1       // Times one incident can be preempted, against starvation
+#define PREEMPTION_MAX_VICTIMS 2            // Incidents preempted for one allocation at most
+#define PREEMPTION_RESTART_MS 200           // Extra handling time of a preempted incident
+#define PREEMPTION_MIN_GAIN_MS 400          // Preempt only if the vehicles would otherwise stay busy this long
+#define PREEMPTION_MIN_INTERVAL_MS 500      // Shortest time between two preemptions, against churn
+
+// Priority controller defines
+#define PRIORITY_CONTROLLER_ENABLED 1
+#define PRIORITY_CONTROLLER_PRIORITY 6      // Above boosted shards, so it can always lower them again
+#define PRIORITY_CONTROLLER_STACK_SIZE DEPARTMENT_SCALED_STACK(256)
+#define PRIORITY_CONTROLLER_PERIOD pdMS_TO_TICKS(100)
+#define PRIORITY_BOOST_LEVELS 1             // Levels added to a backlogged shard's priority
+#define PRIORITY_MAX_BOOSTED 2              // Departments boosted at once at most
+#define PRIORITY_RAISE_PENDING 2            // Boost at this many pending incidents...
+#define PRIORITY_RAISE_AGE_MS 1000          // ...or when the oldest one has waited this long
+#define PRIORITY_BACKLOG_WEIGHT_MS 500      // One pending incident counts like this much waiting
+#define PRIORITY_MIN_BOOST_MS 500           // Shortest boost, against flapping
+#define PRIORITY_MAX_BOOST_MS 3000          // Longest boost before a forced cooldown
+#define PRIORITY_COOLDOWN_MS 2000           // No new boost for this long after a forced release
+
 // Department names for logging
 #define DEPARTMENT_NAMES {"Police", "Fire", "Ambulance", "Corona"}
 
+// Incident severities and deadlines
+#define SEVERITY_NAMES {"low", "medium", "high"}
+#define SEVERITY_WEIGHTS {60, 30, 10}       // Relative share of low, medium and high severity incidents
+#define INCIDENT_DEADLINE_MS { \
+    {3000, 2000, 1200},   /* Police: low, medium, high */ \
+    {2500, 1500, 1000},   /* Fire */ \
+    {2500, 1500, 900},    /* Ambulance */ \
+    {4000, 2500, 1500},   /* Corona */ \
+}
+#define DISPATCH_ORDER_DEFAULT DISPATCH_ORDER_EDF // Order of a shard's pending incidents
+
 #endif /* INC_PROJECT_DEFINES_H_ */
@@ -0,0 +1,44 @@
+/*
+ * pt.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file pt.h
+/// @brief Minimal stackless protothreads.
+///
+/// A protothread is a function that returns whenever it has to wait and
+/// resumes at the same point on its next call. The resume point is kept in
+/// two bytes (a line number used as a `switch` label), so a waiting handler
+/// costs no stack. Local variables are not preserved across waits; keep state
+/// in the record passed to the function, and do not use `switch` inside it.
+
+#ifndef INC_PT_H_
+#define INC_PT_H_
+
+#include <stdint.h>
+
+typedef struct {
+    uint16_t resume;    /**< Line to resume at, 0 at the start */
+} Protothread;
+
+#define PT_WAITING 0    /**< The protothread is blocked */
+#define PT_ENDED 1      /**< The protothread has run to the end */
+
+#define PT_INIT(pt) ((pt)->resume = 0)
+
+#define PT_BEGIN(pt) switch ((pt)->resume) { case 0:
+
+#define PT_WAIT_UNTIL(pt, condition) \
+    do { \
+        (pt)->resume = __LINE__; \
+        case __LINE__: \
+        if (!(condition)) { \
+            return PT_WAITING; \
+        } \
+    } while (0)
+
+#define PT_END(pt) } (pt)->resume = 0; return PT_ENDED
+
+#endif /* INC_PT_H_ */
@@ -0,0 +1,126 @@
+/**
+ * @file quantile_sketch.c
+ * @brief Constant-memory streaming quantile estimator.
+ *
+ * A log-linear (HDR-style) histogram: recording a sample is one bucket index
+ * computation and two atomic increments, and no raw samples are kept. The
+ * increments are lock-free read-modify-writes (LDREX/STREX on the Cortex-M7),
+ * so any number of tasks may record into the same sketch. Quantiles are
+ * read by walking the buckets, optionally summed over several sketches so
+ * per-department sketches can also answer for all departments together.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "quantile_sketch.h"
+#include <stdbool.h>
+
+/**
+ * @brief Maps a value to its bucket.
+ *
+ * @param value The value.
+ * @return The bucket index.
+ */
+static uint32_t bucketIndex(uint32_t value) {
+    if (value >= (1UL << SKETCH_RANGE_BITS)) {
+        return SKETCH_BUCKETS - 1;
+    }
+    if (value < SKETCH_SUB_BUCKETS) {
+        return value;
+    }
+
+    // Keep the top SKETCH_SUB_BUCKET_BITS + 1 bits of the value
+    uint32_t shift = (31U - (uint32_t)__builtin_clz(value)) - SKETCH_SUB_BUCKET_BITS;
+    return shift * SKETCH_SUB_BUCKETS + (value >> shift);
+}
+
+/**
+ * @brief Gets the value a bucket stands for.
+ *
+ * @param index The bucket index.
+ * @return The middle of the bucket's value range.
+ */
+static uint32_t bucketValue(uint32_t index) {
+    if (index < 2 * SKETCH_SUB_BUCKETS) {
+        return index;
+    }
+
+    uint32_t shift = index / SKETCH_SUB_BUCKETS - 1;
+    uint32_t mantissa = index % SKETCH_SUB_BUCKETS + SKETCH_SUB_BUCKETS;
+    return (mantissa << shift) + ((1UL << shift) - 1) / 2;
+}
+
+/**
+ * @brief Adds a sample to a sketch.
+ *
+ * Values beyond the sketch range are counted in the last bucket. Safe to call
+ * from several tasks at once without a lock.
+ *
+ * @param sketch The sketch.
+ * @param value The sample.
+ */
+void sketchRecord(QuantileSketch *sketch, uint32_t value) {
+    __atomic_fetch_add(&sketch->counts[bucketIndex(value)], 1U, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&sketch->total, 1U, __ATOMIC_RELAXED);
+
+    uint32_t max = __atomic_load_n(&sketch->max, __ATOMIC_RELAXED);
+    // A failed exchange reloads max; stop once another writer has recorded a larger one
+    while (value > max &&
+           !__atomic_compare_exchange_n(&sketch->max, &max, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * @brief Counts the samples of one or more sketches.
+ *
+ * @param sketches Array of sketches.
+ * @param count Number of sketches.
+ * @return The number of samples.
+ */
+uint32_t sketchTotal(const QuantileSketch *sketches, int count) {
+    uint32_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total += sketches[i].total;
+    }
+    return total;
+}
+
+/**
+ * @brief Estimates a quantile over one or more sketches.
+ *
+ * @param sketches Array of sketches.
+ * @param count Number of sketches.
+ * @param percentile The percentile, 1 to 100.
+ * @return The estimated value, or 0 if nothing was recorded yet.
+ */
+uint32_t sketchQuantile(const QuantileSketch *sketches, int count, int percentile) {
+    uint32_t total = 0;
+    uint32_t max = 0;
+
+    // Sum the buckets rather than the totals, which a writer may have bumped since
+    for (int i = 0; i < count; i++) {
+        for (uint32_t b = 0; b < SKETCH_BUCKETS; b++) {
+            total += sketches[i].counts[b];
+        }
+        if (sketches[i].max > max) {
+            max = sketches[i].max;
+        }
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint32_t rank = (uint32_t)(((uint64_t)total * (uint32_t)percentile + 99U) / 100U);
+    uint32_t seen = 0;
+    for (uint32_t b = 0; b < SKETCH_BUCKETS; b++) {
+        for (int i = 0; i < count; i++) {
+            seen += sketches[i].counts[b];
+        }
+        if (seen >= rank) {
+            uint32_t value = bucketValue(b);
+            return (value < max) ? value : max;
+        }
+    }
+    return max;
+}
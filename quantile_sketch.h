@@ -0,0 +1,40 @@
+/*
+ * quantile_sketch.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file quantile_sketch.h
+/// @brief Constant-memory streaming quantile estimator interface.
+
+#ifndef INC_QUANTILE_SKETCH_H_
+#define INC_QUANTILE_SKETCH_H_
+
+#include <stdint.h>
+#include "project_defines.h"
+
+#define SKETCH_SUB_BUCKETS (1U << SKETCH_SUB_BUCKET_BITS)
+#define SKETCH_BUCKETS ((SKETCH_RANGE_BITS - SKETCH_SUB_BUCKET_BITS + 1) * SKETCH_SUB_BUCKETS)
+
+/**
+ * @brief Log-linear histogram of a stream of values.
+ *
+ * Values below 2^(SKETCH_SUB_BUCKET_BITS + 1) are counted exactly; above that
+ * every power of two is split into SKETCH_SUB_BUCKETS buckets, so a quantile
+ * is off by at most half a bucket (1/2^(SKETCH_SUB_BUCKET_BITS + 1) relative).
+ *
+ * Writers update a sketch with atomic increments, so several tasks may record
+ * into it; readers need no lock and at worst miss the sample being recorded.
+ */
+typedef struct {
+    volatile uint32_t counts[SKETCH_BUCKETS]; /**< Samples per bucket */
+    volatile uint32_t total;                  /**< Samples recorded */
+    volatile uint32_t max;                    /**< Largest sample recorded */
+} QuantileSketch;
+
+void sketchRecord(QuantileSketch *sketch, uint32_t value);
+uint32_t sketchQuantile(const QuantileSketch *sketches, int count, int percentile);
+uint32_t sketchTotal(const QuantileSketch *sketches, int count);
+
+#endif /* INC_QUANTILE_SKETCH_H_ */
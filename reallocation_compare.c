@@ -0,0 +1,619 @@
+/**
+ * @file reallocation_compare.c
+ * @brief Runs two reallocation policies on the same incident stream.
+ *
+ * Comparing policies on the live system is unfair: every run sees different
+ * incidents, and the timing of the other tasks changes the outcome. The
+ * comparison instead simulates the fleet in virtual time, once per policy,
+ * on an identical stream of REALLOCATION_COMPARE_INCIDENTS incidents drawn
+ * from the active scenario with a fixed seed.
+ *
+ * In the simulation an incident keeps its vehicles busy for its handling
+ * time. Each department serves its waiting incidents in the live dispatch
+ * order (arrival or deadline, see `setDispatchOrder`); when the department's
+ * idle vehicles are not enough, the policy under test borrows the rest from
+ * the other departments' idle vehicles. Borrowed
+ * vehicles stay with the borrower, as in the live system, and take
+ * REALLOCATION_COMPARE_TRANSFER_MS to get there, during which they are busy.
+ * An incident that cannot be covered waits, and holds up the later incidents
+ * of its department.
+ *
+ * Lenders keep their reserve floors as on the live system: only incidents of
+ * RESERVE_OVERRIDE_SEVERITY, or waiting RESERVE_OVERRIDE_AFTER_MS, may take
+ * reserve vehicles. `reallocationCompareReserves` runs one policy without and
+ * with the floors, to show what the floors cost or save in tail latency.
+ *
+ * `reallocationComparePreemption` runs one policy without and with
+ * preemption: a waiting incident of PREEMPTION_MIN_SEVERITY that the idle
+ * vehicles cannot cover takes the vehicles of low-severity incidents in
+ * progress in other departments, under the same cost model as the live
+ * system (see preemption.c). The preempted incidents wait again and then
+ * need their remaining time plus PREEMPTION_RESTART_MS.
+ *
+ * Any idle vehicle above the floors can be lent, so whether an incident can
+ * start does not depend on the policy; the policies differ in where they
+ * leave the vehicles, and so in how often later incidents have to borrow and
+ * pay the transfer.
+ *
+ * Reported per run, with the difference:
+ * - the wait from arrival to the first start: mean, 95th and 99th percentile,
+ *   and worst per department;
+ * - the 99th percentile response time (arrival to completion) per severity;
+ * - deadline misses (wait plus handling beyond the incident's deadline) and
+ *   incidents starved for longer than REALLOCATION_STARVATION_MS;
+ * - incidents that borrowed, lends (one per donor per borrow), vehicles moved,
+ *   and cascades (a department borrowing within RESERVE_CASCADE_WINDOW_MS of
+ *   lending);
+ * - incidents preempted.
+ *
+ * The simulation runs to completion in the caller's task and uses no kernel
+ * objects.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "reallocation_compare.h"
+#include "dispatcher.h"
+#include "vehicle_management.h"
+#include "logger.h"
+#include "scenario.h"
+#include "quantile_sketch.h"
+#include "project_defines.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief A simulated incident.
+ */
+typedef struct {
+    uint32_t arrivalMs;    /**< Virtual arrival time */
+    uint32_t handlingMs;   /**< Time the vehicles stay busy */
+    uint8_t department;    /**< Department index (POLICE, FIRE, etc.) */
+    uint8_t severity;      /**< IncidentSeverity */
+    uint8_t preemptions;   /**< Times the incident was preempted */
+    int vehicles;          /**< Vehicles required */
+} SimIncident;
+
+/**
+ * @brief A simulated incident in progress.
+ */
+typedef struct {
+    uint32_t endMs;        /**< Virtual completion time */
+    SimIncident incident;  /**< The incident; its vehicles return to its department */
+} SimActive;
+
+/**
+ * @brief Outcome of one run on the stream.
+ */
+typedef struct {
+    uint32_t served;              /**< Incidents started */
+    uint32_t dropped;             /**< Incidents that found the waiting list full */
+    uint64_t totalWaitMs;         /**< Sum of the waits of served incidents */
+    uint32_t maxWaitMs[NUM_DEPARTMENTS]; /**< Longest wait per department */
+    QuantileSketch waits;         /**< Wait distribution, for the tail */
+    QuantileSketch responses[SEVERITY_COUNT]; /**< Arrival to completion per severity */
+    uint32_t deadlineMisses;      /**< Incidents completed after their deadline */
+    uint32_t starved;             /**< Incidents that waited longer than REALLOCATION_STARVATION_MS */
+    uint32_t borrowingIncidents;  /**< Incidents that needed other departments' vehicles */
+    uint32_t lends;               /**< Donor transfers */
+    uint32_t vehiclesMoved;       /**< Vehicles moved between departments */
+    uint32_t cascades;            /**< Borrows by a department that had just lent */
+    uint32_t preemptions;         /**< Incidents preempted */
+} CompareResult;
+
+/**
+ * @brief Configuration and lending state of one run.
+ */
+typedef struct {
+    ReallocationPolicyId policy;  /**< Policy under test */
+    int floors[NUM_DEPARTMENTS];  /**< Reserve floor per department, 0 when floors are off */
+    ReallocationHistory history;  /**< Lending history for the policy */
+    bool hasLent[NUM_DEPARTMENTS]; /**< Department has lent in this run */
+    uint32_t lastLentMs[NUM_DEPARTMENTS]; /**< When each department last lent */
+    bool edf;                     /**< Waiting incidents in deadline order, as DISPATCH_ORDER_EDF */
+    bool preemption;              /**< Critical incidents may preempt */
+    bool hasPreempted;            /**< An incident has been preempted in this run */
+    uint32_t lastPreemptionMs;    /**< When the last incident was preempted */
+} SimRun;
+
+static SimIncident waiting[REALLOCATION_COMPARE_MAX_WAITING]; /**< In dispatch order */
+static int waitingCount;
+static SimActive active[REALLOCATION_COMPARE_MAX_ACTIVE];
+static int activeCount;
+static SimIncident requeued[PREEMPTION_MAX_VICTIMS]; /**< Preempted, not yet waiting again */
+static int requeuedCount;
+
+/**
+ * @brief Advances the comparison's own xorshift32 generator.
+ *
+ * The dispatcher's generator is left alone, so a comparison does not change
+ * the live incident stream.
+ *
+ * @param state Generator state.
+ * @return The next pseudo-random value.
+ */
+static uint32_t nextRandom(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Draws one incident the way the event generator does.
+ *
+ * @param state Generator state.
+ * @param index Position in the stream.
+ * @param fleetTotal Vehicles in the whole fleet; no incident needs more.
+ * @param incident Receives the incident.
+ */
+static void drawIncident(uint32_t *state, uint32_t index, int fleetTotal, SimIncident *incident) {
+    static const uint8_t severityWeights[SEVERITY_COUNT] = SEVERITY_WEIGHTS;
+    const Scenario *config = scenarioGet();
+    uint32_t totalWeight = 0;
+
+    for (int i = 0; i < config->departmentCount; i++) {
+        totalWeight += config->departments[i].arrivalWeight;
+    }
+    uint32_t pick = nextRandom(state) % ((totalWeight > 0) ? totalWeight : (uint32_t)config->departmentCount);
+    incident->department = 0;
+    for (uint8_t i = 0; i < config->departmentCount; i++) {
+        uint32_t weight = (totalWeight > 0) ? config->departments[i].arrivalWeight : 1;
+        if (pick < weight) {
+            incident->department = i;
+            break;
+        }
+        pick -= weight;
+    }
+
+    incident->preemptions = 0;
+    incident->vehicles = (int)(nextRandom(state) % (uint32_t)config->maxCars) + 1;
+    if (incident->vehicles > fleetTotal) {
+        incident->vehicles = fleetTotal;
+    }
+
+    totalWeight = 0;
+    for (int i = 0; i < SEVERITY_COUNT; i++) {
+        totalWeight += severityWeights[i];
+    }
+    pick = (totalWeight > 0) ? nextRandom(state) % totalWeight : 0;
+    incident->severity = SEVERITY_LOW;
+    for (uint8_t i = 0; i < SEVERITY_COUNT; i++) {
+        if (pick < severityWeights[i]) {
+            incident->severity = i;
+            break;
+        }
+        pick -= severityWeights[i];
+    }
+
+    const DepartmentConfig *department = &config->departments[incident->department];
+    uint32_t span = department->handleMaxMs - department->handleMinMs;
+    incident->handlingMs = department->handleMinMs + ((span > 0) ? nextRandom(state) % (span + 1) : 0);
+    incident->arrivalMs = index * ((config->arrivalMs > 0) ? config->arrivalMs : 1);
+}
+
+/**
+ * @brief Estimates how long an incident waits for vehicles without preemption.
+ *
+ * @param now Virtual time.
+ * @param shortfall Vehicles it lacks after borrowing every idle one.
+ * @return Time until the incidents in progress have freed that many vehicles.
+ */
+static uint32_t naturalWaitMs(uint32_t now, int shortfall) {
+    bool counted[REALLOCATION_COMPARE_MAX_ACTIVE] = {false};
+    uint32_t freeAtMs = now;
+    int freed = 0;
+
+    while (freed < shortfall) {
+        int next = -1;
+        for (int i = 0; i < activeCount; i++) {
+            if (!counted[i] && (next < 0 || active[i].endMs < active[next].endMs)) {
+                next = i;
+            }
+        }
+        if (next < 0) {
+            return UINT32_MAX;
+        }
+        counted[next] = true;
+        freed += active[next].incident.vehicles;
+        freeAtMs = active[next].endMs;
+    }
+    return freeAtMs - now;
+}
+
+/**
+ * @brief Preempts low-severity incidents in progress for a critical waiting one.
+ *
+ * Applies the cost model of the live system: the incident must otherwise
+ * wait PREEMPTION_MIN_GAIN_MS for completions, victims must still need that
+ * long too, the ones with the most vehicles go first, and none are taken
+ * unless they cover the shortfall. The victims are kept in
+ * `requeued` until the caller puts them back on the waiting list.
+ *
+ * @param run The run.
+ * @param now Virtual time.
+ * @param incident The critical incident.
+ * @param shortfall Vehicles it lacks after borrowing every idle one.
+ * @param counts Idle vehicles per department, updated with the victims' vehicles.
+ * @param result Statistics of this run.
+ * @return True if incidents were preempted.
+ */
+static bool preemptFor(SimRun *run, uint32_t now, const SimIncident *incident, int shortfall,
+                       int counts[NUM_DEPARTMENTS],
+                       CompareResult *result) {
+    int victims[PREEMPTION_MAX_VICTIMS]; // Indices into active, most vehicles first
+    int victimCount = 0;
+
+    if (!run->preemption || incident->severity < PREEMPTION_MIN_SEVERITY ||
+        (run->hasPreempted && now - run->lastPreemptionMs < PREEMPTION_MIN_INTERVAL_MS) ||
+        requeuedCount > 0 || waitingCount + PREEMPTION_MAX_VICTIMS > REALLOCATION_COMPARE_MAX_WAITING ||
+        naturalWaitMs(now, shortfall) < PREEMPTION_MIN_GAIN_MS) {
+        return false;
+    }
+    for (int i = 0; i < activeCount; i++) {
+        const SimIncident *candidate = &active[i].incident;
+        if (candidate->department == incident->department || candidate->severity > PREEMPTION_MAX_VICTIM_SEVERITY ||
+            candidate->preemptions >= PREEMPTION_MAX_PER_INCIDENT || active[i].endMs - now < PREEMPTION_MIN_GAIN_MS) {
+            continue;
+        }
+        if (victimCount == PREEMPTION_MAX_VICTIMS &&
+            candidate->vehicles <= active[victims[victimCount - 1]].incident.vehicles) {
+            continue;
+        }
+        int j = (victimCount < PREEMPTION_MAX_VICTIMS) ? victimCount++ : victimCount - 1;
+        while (j > 0 && candidate->vehicles > active[victims[j - 1]].incident.vehicles) {
+            victims[j] = victims[j - 1];
+            j--;
+        }
+        victims[j] = i;
+    }
+
+    int needed = 0;
+    int freed = 0;
+    while (needed < victimCount && freed < shortfall) {
+        freed += active[victims[needed++]].incident.vehicles;
+    }
+    if (freed < shortfall) {
+        return false;
+    }
+
+    // Highest index first, so removing one does not move the others
+    for (int i = 0; i < needed; i++) {
+        for (int j = i + 1; j < needed; j++) {
+            if (victims[j] > victims[i]) {
+                int swap = victims[i];
+                victims[i] = victims[j];
+                victims[j] = swap;
+            }
+        }
+    }
+    for (int i = 0; i < needed; i++) {
+        SimActive *victim = &active[victims[i]];
+        SimIncident *again = &requeued[requeuedCount++];
+        *again = victim->incident;
+        again->handlingMs = victim->endMs - now + PREEMPTION_RESTART_MS;
+        again->preemptions++;
+        counts[again->department] += again->vehicles;
+        *victim = active[--activeCount];
+        result->preemptions++;
+    }
+    run->hasPreempted = true;
+    run->lastPreemptionMs = now;
+    return true;
+}
+
+/**
+ * @brief Gets the position of an incident in the waiting list.
+ *
+ * @param run The run.
+ * @param incident The incident.
+ * @return Its deadline with EDF, otherwise its arrival time.
+ */
+static uint32_t waitingKey(const SimRun *run, const SimIncident *incident) {
+    return incident->arrivalMs + (run->edf ? getDeadlineMs(incident->department, incident->severity) : 0);
+}
+
+/**
+ * @brief Adds an incident to the waiting list, after the ones with the same key.
+ *
+ * The caller makes sure the list has room.
+ *
+ * @param run The run.
+ * @param incident The incident.
+ */
+static void addWaiting(const SimRun *run, const SimIncident *incident) {
+    uint32_t key = waitingKey(run, incident);
+    int i = waitingCount;
+
+    while (i > 0 && waitingKey(run, &waiting[i - 1]) > key) {
+        waiting[i] = waiting[i - 1];
+        i--;
+    }
+    waiting[i] = *incident;
+    waitingCount++;
+}
+
+/**
+ * @brief Starts every waiting incident whose vehicles can be found.
+ *
+ * @param run The run.
+ * @param now Virtual time.
+ * @param counts Idle vehicles per department.
+ * @param result Statistics of this run.
+ */
+static void startWaiting(SimRun *run, uint32_t now, int counts[NUM_DEPARTMENTS], CompareResult *result) {
+    static bool blocked[NUM_DEPARTMENTS]; // Kept off the caller's stack
+    static int lendable[NUM_DEPARTMENTS];
+    static int take[NUM_DEPARTMENTS];
+    int i = 0;
+
+    memset(blocked, 0, sizeof(blocked));
+
+    while (i < waitingCount) {
+        SimIncident *incident = &waiting[i];
+        uint8_t d = incident->department;
+        int missing = incident->vehicles - counts[d];
+        bool useReserve = incident->severity >= RESERVE_OVERRIDE_SEVERITY ||
+                          now - incident->arrivalMs >= RESERVE_OVERRIDE_AFTER_MS;
+        int totalLendable = 0;
+
+        for (int l = 0; l < NUM_DEPARTMENTS; l++) {
+            int floor = useReserve ? 0 : run->floors[l];
+            lendable[l] = (l != d && counts[l] > floor) ? counts[l] - floor : 0;
+            totalLendable += lendable[l];
+        }
+        if (!blocked[d] && activeCount < REALLOCATION_COMPARE_MAX_ACTIVE && missing > totalLendable &&
+            preemptFor(run, now, incident, missing - totalLendable, counts, result)) {
+            continue; // Try again with the victims' vehicles idle
+        }
+        if (blocked[d] || activeCount >= REALLOCATION_COMPARE_MAX_ACTIVE || missing > totalLendable) {
+            blocked[d] = true; // Later incidents of the department wait behind this one
+            i++;
+            continue;
+        }
+
+        uint32_t startMs = now;
+        if (missing > 0) {
+            (void)planReallocation(run->policy, d, missing, lendable, &run->history, take);
+            for (int l = 0; l < NUM_DEPARTMENTS; l++) {
+                if (take[l] > 0) {
+                    counts[l] -= take[l];
+                    counts[d] += take[l];
+                    run->hasLent[l] = true;
+                    run->lastLentMs[l] = now;
+                    result->lends++;
+                    result->vehiclesMoved += (uint32_t)take[l];
+                }
+            }
+            if (run->hasLent[d] && now - run->lastLentMs[d] < RESERVE_CASCADE_WINDOW_MS) {
+                result->cascades++;
+            }
+            result->borrowingIncidents++;
+            startMs += REALLOCATION_COMPARE_TRANSFER_MS; // The borrowed vehicles drive over first
+        }
+
+        uint32_t waitMs = startMs - incident->arrivalMs;
+        counts[d] -= incident->vehicles;
+        active[activeCount++] = (SimActive){.endMs = startMs + incident->handlingMs, .incident = *incident};
+        if (incident->preemptions == 0) { // A preempted incident restarting was served already
+            result->served++;
+            result->totalWaitMs += waitMs;
+            sketchRecord(&result->waits, waitMs);
+            if (waitMs > result->maxWaitMs[d]) {
+                result->maxWaitMs[d] = waitMs;
+            }
+            if (waitMs > REALLOCATION_STARVATION_MS) {
+                result->starved++;
+            }
+        }
+
+        memmove(&waiting[i], &waiting[i + 1], (size_t)(waitingCount - i - 1) * sizeof(waiting[0]));
+        waitingCount--;
+    }
+    for (int r = 0; r < requeuedCount; r++) {
+        addWaiting(run, &requeued[r]);
+    }
+    requeuedCount = 0;
+}
+
+/**
+ * @brief Simulates the whole stream under one policy.
+ *
+ * @param policy The policy under test.
+ * @param reserves True to keep the scenario's reserve floors.
+ * @param preemption True to let critical incidents preempt.
+ * @param result Receives the statistics.
+ */
+static void runPolicy(ReallocationPolicyId policy, bool reserves, bool preemption, CompareResult *result) {
+    static SimRun run; // Kept off the caller's stack; grows with NUM_DEPARTMENTS
+    static int counts[NUM_DEPARTMENTS];
+    uint32_t state = REALLOCATION_COMPARE_SEED;
+    uint32_t generated = 0;
+    uint32_t now = 0;
+    SimIncident next;
+    int fleetTotal = 0;
+
+    run = (SimRun){.policy = policy, .edf = getDispatchOrder() == DISPATCH_ORDER_EDF, .preemption = preemption};
+    memset(result, 0, sizeof(*result));
+    waitingCount = 0;
+    activeCount = 0;
+    requeuedCount = 0;
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+        counts[d] = scenarioDepartment(d)->fleet;
+        run.floors[d] = reserves ? scenarioDepartment(d)->reserve : 0;
+        fleetTotal += counts[d];
+    }
+    if (fleetTotal <= 0) {
+        return;
+    }
+    drawIncident(&state, generated, fleetTotal, &next);
+
+    while (generated < REALLOCATION_COMPARE_INCIDENTS || waitingCount > 0 || activeCount > 0) {
+        // Jump to the next arrival, completion, or waiting incident allowed to use reserves
+        uint32_t nextMs = (generated < REALLOCATION_COMPARE_INCIDENTS) ? next.arrivalMs : UINT32_MAX;
+        for (int i = 0; i < activeCount; i++) {
+            if (active[i].endMs < nextMs) {
+                nextMs = active[i].endMs;
+            }
+        }
+        for (int i = 0; i < waitingCount; i++) {
+            uint32_t overrideMs = waiting[i].arrivalMs + RESERVE_OVERRIDE_AFTER_MS;
+            if (overrideMs > now && overrideMs < nextMs) {
+                nextMs = overrideMs;
+            }
+        }
+        if (nextMs == UINT32_MAX) {
+            break; // Only incidents no fleet could serve are left
+        }
+        now = nextMs;
+
+        for (int i = activeCount - 1; i >= 0; i--) {
+            if (active[i].endMs <= now) {
+                const SimIncident *incident = &active[i].incident;
+                uint32_t responseMs = now - incident->arrivalMs;
+                sketchRecord(&result->responses[incident->severity], responseMs);
+                if (responseMs > getDeadlineMs(incident->department, incident->severity)) {
+                    result->deadlineMisses++;
+                }
+                counts[incident->department] += incident->vehicles;
+                active[i] = active[--activeCount];
+            }
+        }
+        while (generated < REALLOCATION_COMPARE_INCIDENTS && next.arrivalMs <= now) {
+            if (waitingCount < REALLOCATION_COMPARE_MAX_WAITING) {
+                addWaiting(&run, &next);
+            } else {
+                result->dropped++;
+            }
+            generated++;
+            drawIncident(&state, generated, fleetTotal, &next);
+        }
+        startWaiting(&run, now, counts, result);
+    }
+}
+
+/**
+ * @brief Logs one line of the comparison table.
+ *
+ * @param label Row label.
+ * @param first Value for the first run.
+ * @param second Value for the second run.
+ */
+static void compareRow(const char *label, uint32_t first, uint32_t second) {
+    logMessage("  %-24s %10lu %10lu %+10ld\r\n", label, (unsigned long)first, (unsigned long)second,
+               (long)second - (long)first);
+}
+
+/**
+ * @brief Logs two runs side by side.
+ *
+ * @param first Column name of the first run.
+ * @param second Column name of the second run.
+ * @param results Statistics of the runs.
+ */
+static void reportRuns(const char *first, const char *second, const CompareResult results[2]) {
+    const char *severityNames[] = SEVERITY_NAMES;
+    char label[32];
+
+    logMessage("  %-24s %10s %10s %10s\r\n", "", first, second, "difference");
+    compareRow("served", results[0].served, results[1].served);
+    compareRow("dropped", results[0].dropped, results[1].dropped);
+    compareRow("mean wait ms",
+               (results[0].served > 0) ? (uint32_t)(results[0].totalWaitMs / results[0].served) : 0,
+               (results[1].served > 0) ? (uint32_t)(results[1].totalWaitMs / results[1].served) : 0);
+    compareRow("p95 wait ms", sketchQuantile(&results[0].waits, 1, 95), sketchQuantile(&results[1].waits, 1, 95));
+    compareRow("p99 wait ms", sketchQuantile(&results[0].waits, 1, 99), sketchQuantile(&results[1].waits, 1, 99));
+    for (int severity = SEVERITY_COUNT - 1; severity >= 0; severity--) {
+        snprintf(label, sizeof(label), "p99 response ms %s", severityNames[severity]);
+        compareRow(label, sketchQuantile(&results[0].responses[severity], 1, 99),
+                   sketchQuantile(&results[1].responses[severity], 1, 99));
+    }
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+        snprintf(label, sizeof(label), "max wait ms %s", departmentName(d));
+        compareRow(label, results[0].maxWaitMs[d], results[1].maxWaitMs[d]);
+    }
+    compareRow("deadline misses", results[0].deadlineMisses, results[1].deadlineMisses);
+    snprintf(label, sizeof(label), "starved > %u ms", (unsigned)REALLOCATION_STARVATION_MS);
+    compareRow(label, results[0].starved, results[1].starved);
+    compareRow("incidents borrowing", results[0].borrowingIncidents, results[1].borrowingIncidents);
+    compareRow("lends", results[0].lends, results[1].lends);
+    compareRow("vehicles moved", results[0].vehiclesMoved, results[1].vehiclesMoved);
+    compareRow("cascades", results[0].cascades, results[1].cascades);
+    compareRow("preemptions", results[0].preemptions, results[1].preemptions);
+}
+
+/**
+ * @brief Runs two policies on the same incident stream and reports the difference.
+ *
+ * Both runs keep the reserve floors if they are enabled on the live system.
+ *
+ * @param first The baseline policy.
+ * @param second The policy compared against it.
+ */
+void reallocationCompare(ReallocationPolicyId first, ReallocationPolicyId second) {
+    static CompareResult results[2]; // Kept off the caller's stack
+    const ReallocationPolicy *policies[2] = {getReallocationPolicy(first), getReallocationPolicy(second)};
+    bool reserves = getReserveFloorsEnabled();
+
+    if (policies[0] == NULL || policies[1] == NULL) {
+        logMessage("Unknown reallocation policy\r\n");
+        return;
+    }
+    runPolicy(first, reserves, false, &results[0]);
+    runPolicy(second, reserves, false, &results[1]);
+
+    logMessage("Reallocation policies on %lu incidents of scenario %s (seed %lu, floors %s):\r\n",
+               (unsigned long)REALLOCATION_COMPARE_INCIDENTS, scenarioGet()->name,
+               (unsigned long)REALLOCATION_COMPARE_SEED, reserves ? "on" : "off");
+    reportRuns(policies[0]->name, policies[1]->name, results);
+}
+
+/**
+ * @brief Runs one policy without and with the reserve floors on the same stream.
+ *
+ * @param policy The policy.
+ */
+void reallocationCompareReserves(ReallocationPolicyId policy) {
+    static CompareResult results[2]; // Kept off the caller's stack
+    const ReallocationPolicy *config = getReallocationPolicy(policy);
+
+    if (config == NULL) {
+        logMessage("Unknown reallocation policy\r\n");
+        return;
+    }
+    runPolicy(policy, false, false, &results[0]);
+    runPolicy(policy, true, false, &results[1]);
+
+    logMessage("Reserve floors under policy %s on %lu incidents of scenario %s (seed %lu):\r\n", config->name,
+               (unsigned long)REALLOCATION_COMPARE_INCIDENTS, scenarioGet()->name,
+               (unsigned long)REALLOCATION_COMPARE_SEED);
+    reportRuns("no floors", "floors", results);
+}
+
+/**
+ * @brief Runs one policy without and with preemption on the same stream.
+ *
+ * Both runs keep the reserve floors if they are enabled on the live system.
+ *
+ * @param policy The policy.
+ */
+void reallocationComparePreemption(ReallocationPolicyId policy) {
+    static CompareResult results[2]; // Kept off the caller's stack
+    const ReallocationPolicy *config = getReallocationPolicy(policy);
+    bool reserves = getReserveFloorsEnabled();
+
+    if (config == NULL) {
+        logMessage("Unknown reallocation policy\r\n");
+        return;
+    }
+    runPolicy(policy, reserves, false, &results[0]);
+    runPolicy(policy, reserves, true, &results[1]);
+
+    logMessage("Preemption under policy %s on %lu incidents of scenario %s (seed %lu, floors %s):\r\n",
+               config->name, (unsigned long)REALLOCATION_COMPARE_INCIDENTS, scenarioGet()->name,
+               (unsigned long)REALLOCATION_COMPARE_SEED, reserves ? "on" : "off");
+    reportRuns("no preempt", "preempt", results);
+}
@@ -0,0 +1,20 @@
+/*
+ * reallocation_compare.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file reallocation_compare.h
+/// @brief Offline head-to-head comparison of reallocation policies.
+
+#ifndef INC_REALLOCATION_COMPARE_H_
+#define INC_REALLOCATION_COMPARE_H_
+
+#include "reallocation_policy.h"
+
+void reallocationCompare(ReallocationPolicyId first, ReallocationPolicyId second);
+void reallocationCompareReserves(ReallocationPolicyId policy);
+void reallocationComparePreemption(ReallocationPolicyId policy);
+
+#endif /* INC_REALLOCATION_COMPARE_H_ */
@@ -0,0 +1,242 @@
+/**
+ * @file reallocation_policy.c
+ * @brief Built-in donor selection policies for vehicle reallocation.
+ *
+ * When a department is short of vehicles, the active policy decides which
+ * departments lend and how many vehicles each gives. A policy only plans; the
+ * caller moves the vehicles, so the same policy serves the live reallocation,
+ * the batched allocator and the offline comparison in reallocation_compare.c.
+ *
+ * - fixed: donors in department order, skipping the requester. This is the
+ *   order the original reallocation code hard-coded.
+ * - largest: the donor with the most idle vehicles first.
+ * - proportional: every donor gives its share of the vehicles needed, in
+ *   proportion to its idle vehicles (largest remainders round up).
+ * - recent: the donor that lent least recently first, spreading the lending.
+ *
+ * The ordered policies pick their donors from a department heap: O(D) to
+ * build and O(log D) per donor, so a plan with k donors is O(D + k log D)
+ * rather than a scan of every department per donor.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "reallocation_policy.h"
+#include "project_defines.h"
+#include "department_heap.h"
+#include <string.h>
+
+static void planFixedOrder(uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                           const ReallocationHistory *history, int take[NUM_DEPARTMENTS]);
+static void planLargestIdle(uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                            const ReallocationHistory *history, int take[NUM_DEPARTMENTS]);
+static void planProportional(uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                             const ReallocationHistory *history, int take[NUM_DEPARTMENTS]);
+static void planLeastRecent(uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                            const ReallocationHistory *history, int take[NUM_DEPARTMENTS]);
+
+static const ReallocationPolicy policies[REALLOCATION_POLICY_COUNT] = {
+    [REALLOCATION_FIXED_ORDER] = {"fixed", planFixedOrder},
+    [REALLOCATION_LARGEST_IDLE] = {"largest", planLargestIdle},
+    [REALLOCATION_PROPORTIONAL] = {"proportional", planProportional},
+    [REALLOCATION_LEAST_RECENT] = {"recent", planLeastRecent},
+};
+
+static volatile ReallocationPolicyId activePolicy = REALLOCATION_POLICY_DEFAULT; /**< Used by the live system */
+
+/**
+ * @brief Takes from a donor if it has idle vehicles.
+ *
+ * @param donor The donor department.
+ * @param needed Vehicles still needed.
+ * @param idle Vehicles each department can lend.
+ * @param take Receives the vehicles to take from each department.
+ * @return Vehicles still needed.
+ */
+static int takeFrom(uint8_t donor, int needed, const int idle[NUM_DEPARTMENTS], int take[NUM_DEPARTMENTS]) {
+    int amount = (idle[donor] < needed) ? idle[donor] : needed;
+    if (amount > 0) {
+        take[donor] = amount;
+        needed -= amount;
+    }
+    return needed;
+}
+
+/**
+ * @brief Takes from the donors, largest key first, until the need is covered.
+ *
+ * Each donor costs O(log D), so a plan that needs k donors is O(D + k log D)
+ * including building the heap.
+ *
+ * @param department The requesting department, left out.
+ * @param key Donor preference indexed by department, largest first.
+ * @param needed Vehicles needed.
+ * @param idle Vehicles each department can lend.
+ * @param take Receives the vehicles to take from each department.
+ */
+static void takeByKey(uint8_t department, const int32_t key[NUM_DEPARTMENTS], int needed,
+                      const int idle[NUM_DEPARTMENTS], int take[NUM_DEPARTMENTS]) {
+    DepartmentHeap donors;
+    int donor;
+
+    departmentHeapBuild(&donors, key, department);
+    while (needed > 0 && (donor = departmentHeapPop(&donors)) >= 0) {
+        needed = takeFrom((uint8_t)donor, needed, idle, take);
+    }
+}
+
+static void planFixedOrder(uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                           const ReallocationHistory *history, int take[NUM_DEPARTMENTS]) {
+    (void)history;
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS && needed > 0; d++) {
+        if (d != department) {
+            needed = takeFrom(d, needed, idle, take);
+        }
+    }
+}
+
+static void planLargestIdle(uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                            const ReallocationHistory *history, int take[NUM_DEPARTMENTS]) {
+    DepartmentHeap donors;
+    int32_t key[NUM_DEPARTMENTS];
+    int donor;
+    (void)history;
+
+    for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+        key[d] = idle[d];
+    }
+    departmentHeapBuild(&donors, key, department);
+    // The rest have no more idle vehicles than the top, so stop at the first empty one
+    while (needed > 0 && (donor = departmentHeapPop(&donors)) >= 0 && idle[donor] > 0) {
+        needed = takeFrom((uint8_t)donor, needed, idle, take);
+    }
+}
+
+static void planProportional(uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                             const ReallocationHistory *history, int take[NUM_DEPARTMENTS]) {
+    int32_t remainder[NUM_DEPARTMENTS];
+    int total = 0;
+    (void)history;
+
+    for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+        total += (d != department && idle[d] > 0) ? idle[d] : 0;
+    }
+    if (total <= needed) {
+        planFixedOrder(department, needed, idle, history, take); // Everyone gives everything
+        return;
+    }
+
+    int given = 0;
+    for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+        int share = (d != department && idle[d] > 0) ? idle[d] : 0;
+        take[d] = needed * share / total;
+        remainder[d] = needed * share % total;
+        given += take[d];
+    }
+
+    // Largest remainders round up
+    DepartmentHeap donors;
+    int donor;
+    departmentHeapBuild(&donors, remainder, department);
+    while (given < needed && (donor = departmentHeapPop(&donors)) >= 0) {
+        if (take[donor] < idle[donor]) {
+            take[donor]++;
+            given++;
+        }
+    }
+}
+
+static void planLeastRecent(uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                            const ReallocationHistory *history, int take[NUM_DEPARTMENTS]) {
+    int32_t age[NUM_DEPARTMENTS];
+    for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+        // Lends since the department last lent; never lent is the oldest
+        uint32_t since = history->sequence - history->lastLent[d];
+        age[d] = (since > INT32_MAX) ? INT32_MAX : (int32_t)since;
+    }
+    takeByKey(department, age, needed, idle, take);
+}
+
+/**
+ * @brief Gets a built-in policy.
+ *
+ * @param id The policy.
+ * @return The policy, or NULL for an invalid id.
+ */
+const ReallocationPolicy *getReallocationPolicy(ReallocationPolicyId id) {
+    return ((unsigned)id < REALLOCATION_POLICY_COUNT) ? &policies[id] : NULL;
+}
+
+/**
+ * @brief Looks a policy up by name.
+ *
+ * @param name The policy name ("fixed", "largest", "proportional", "recent").
+ * @param id Receives the policy.
+ * @return True if the name is known.
+ */
+bool findReallocationPolicy(const char *name, ReallocationPolicyId *id) {
+    for (int i = 0; name != NULL && i < REALLOCATION_POLICY_COUNT; i++) {
+        if (strcmp(name, policies[i].name) == 0) {
+            *id = (ReallocationPolicyId)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Gets the policy used by the live system.
+ *
+ * @return The active policy.
+ */
+ReallocationPolicyId getActiveReallocationPolicy(void) {
+    return activePolicy;
+}
+
+/**
+ * @brief Sets the policy used by the live system.
+ *
+ * Takes effect with the next reallocation.
+ *
+ * @param id The policy.
+ */
+void setActiveReallocationPolicy(ReallocationPolicyId id) {
+    if ((unsigned)id < REALLOCATION_POLICY_COUNT) {
+        activePolicy = id;
+    }
+}
+
+/**
+ * @brief Plans a reallocation and records the lenders in the history.
+ *
+ * @param id The policy.
+ * @param department The department that needs vehicles.
+ * @param needed Vehicles it still needs.
+ * @param idle Vehicles each department can lend; the requester's entry is ignored.
+ * @param history Lending history, updated with the donors of this plan.
+ * @param take Receives the vehicles to take from each department.
+ * @return Vehicles still missing after the plan.
+ */
+int planReallocation(ReallocationPolicyId id, uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                     ReallocationHistory *history, int take[NUM_DEPARTMENTS]) {
+    const ReallocationPolicy *policy = getReallocationPolicy(id);
+    int clamped[NUM_DEPARTMENTS];
+
+    for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+        take[d] = 0;
+        clamped[d] = (d == department || idle[d] < 0) ? 0 : idle[d];
+    }
+    if (policy == NULL || department >= NUM_DEPARTMENTS || needed <= 0) {
+        return (needed > 0) ? needed : 0;
+    }
+    policy->plan(department, needed, clamped, history, take);
+
+    for (int d = 0; d < NUM_DEPARTMENTS; d++) {
+        if (take[d] > 0) {
+            needed -= take[d];
+            history->lastLent[d] = ++history->sequence;
+        }
+    }
+    return needed;
+}
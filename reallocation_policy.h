@@ -0,0 +1,65 @@
+/*
+ * reallocation_policy.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file reallocation_policy.h
+/// @brief Pluggable donor selection for vehicle reallocation.
+
+#ifndef INC_REALLOCATION_POLICY_H_
+#define INC_REALLOCATION_POLICY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "project_defines.h"
+
+/**
+ * @brief Built-in reallocation policies.
+ */
+typedef enum {
+    REALLOCATION_FIXED_ORDER = 0,  /**< Donors in department order, as the original code did */
+    REALLOCATION_LARGEST_IDLE,     /**< Donor with the most idle vehicles first */
+    REALLOCATION_PROPORTIONAL,     /**< Every donor gives in proportion to its idle vehicles */
+    REALLOCATION_LEAST_RECENT,     /**< Donor that lent least recently first */
+    REALLOCATION_POLICY_COUNT
+} ReallocationPolicyId;
+
+/**
+ * @brief Lending history the policies may consult.
+ */
+typedef struct {
+    uint32_t sequence;       /**< Number of lends so far */
+    uint32_t lastLent[NUM_DEPARTMENTS];   /**< Sequence number of each department's last lend, 0 = never */
+} ReallocationHistory;
+
+/**
+ * @brief Decides how many vehicles to take from each donor.
+ *
+ * @param department The department that needs vehicles.
+ * @param needed Vehicles it still needs.
+ * @param idle Vehicles each department can lend; the requester's entry is ignored.
+ * @param history Lending history.
+ * @param take Receives the vehicles to take from each department; never more
+ *             than idle, and in total the smaller of needed and all idle vehicles.
+ */
+typedef void (*ReallocationPlanFn)(uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                                   const ReallocationHistory *history, int take[NUM_DEPARTMENTS]);
+
+/**
+ * @brief A named reallocation policy.
+ */
+typedef struct {
+    const char *name;          /**< Name used by the console */
+    ReallocationPlanFn plan;   /**< Donor selection */
+} ReallocationPolicy;
+
+const ReallocationPolicy *getReallocationPolicy(ReallocationPolicyId id);
+bool findReallocationPolicy(const char *name, ReallocationPolicyId *id);
+ReallocationPolicyId getActiveReallocationPolicy(void);
+void setActiveReallocationPolicy(ReallocationPolicyId id);
+int planReallocation(ReallocationPolicyId id, uint8_t department, int needed, const int idle[NUM_DEPARTMENTS],
+                     ReallocationHistory *history, int take[NUM_DEPARTMENTS]);
+
+#endif /* INC_REALLOCATION_POLICY_H_ */
@@ -0,0 +1,215 @@
+/**
+ * @file rebalancer.c
+ * @brief Demand-forecast-driven proactive vehicle rebalancing.
+ *
+ * The dispatcher reports the vehicles requested by every new incident. Once
+ * per `REBALANCER_PERIOD` the rebalancer folds the requests of the period into
+ * an exponentially weighted moving average per department, kept in fixed point
+ * with REBALANCER_FIXED_BITS fractional bits:
+ *
+ *     estimate += (sample - estimate) >> REBALANCER_EWMA_SHIFT
+ *
+ * Each department's target is its share of the whole fleet in proportion to
+ * its estimate. Up to `REBALANCER_MAX_MOVES` idle vehicles per period are then
+ * moved from the department furthest above its target to the one furthest
+ * below, so borrowing happens off the incident's critical path. Two department
+ * heaps, of surpluses and of deficits, are built each period in O(D) and then
+ * give each further pair in O(log D).
+ *
+ * An incident counts as "borrowing avoided" when its department had enough
+ * vehicles only thanks to vehicles the rebalancer moved there earlier.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "rebalancer.h"
+#include "vehicle_management.h"
+#include "department_heap.h"
+#include "scenario.h"
+#include "logger.h"
+#include "profiler.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define REBALANCER_FIXED_BITS 8 /**< Fractional bits of the demand estimates */
+
+static uint32_t periodDemand[NUM_DEPARTMENTS] = {0};   /**< Vehicles requested since the last period */
+static uint32_t demandEstimate[NUM_DEPARTMENTS] = {0}; /**< Smoothed vehicles per period, fixed point */
+static int prepositioned[NUM_DEPARTMENTS] = {0};       /**< Vehicles moved in by the rebalancer, still at the department */
+static uint32_t incidentsAllocated = 0;  /**< Incidents that got their vehicles */
+static uint32_t reactiveBorrows = 0;     /**< Incidents that still had to borrow on demand */
+static uint32_t borrowsAvoided = 0;      /**< Incidents served by prepositioned vehicles */
+static uint32_t vehiclesMoved = 0;       /**< Vehicles moved by the rebalancer */
+
+/**
+ * @brief Initializes the rebalancer task.
+ */
+void initRebalancer(void) {
+    if (xTaskCreate(rebalancerTask, "Rebalancer", REBALANCER_STACK_SIZE, NULL, REBALANCER_PRIORITY, NULL) == pdPASS) {
+        logMessage("Rebalancer task created successfully\r\n");
+    } else {
+        logMessage("Failed to create rebalancer task\r\n");
+    }
+}
+
+/**
+ * @brief Records the vehicles requested by a new incident.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param vehicles Vehicles required by the incident.
+ */
+void rebalancerRecordDemand(uint8_t department, int vehicles) {
+    if (department >= NUM_DEPARTMENTS || vehicles <= 0) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    periodDemand[department] += (uint32_t)vehicles;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Records how an incident got its vehicles.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param requiredVehicles Vehicles required by the incident.
+ * @param availableVehicles Vehicles the department had before any borrowing.
+ * @param borrowed True if vehicles had to be borrowed on demand.
+ */
+void rebalancerRecordAllocation(uint8_t department, int requiredVehicles, int availableVehicles, bool borrowed) {
+    if (department >= NUM_DEPARTMENTS) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    // On-demand borrowing may have taken prepositioned vehicles away again
+    if (prepositioned[department] > availableVehicles) {
+        prepositioned[department] = availableVehicles;
+    }
+    incidentsAllocated++;
+    if (borrowed) {
+        reactiveBorrows++;
+    } else if (availableVehicles - prepositioned[department] < requiredVehicles) {
+        borrowsAvoided++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Folds the demand of the last period into the estimates.
+ */
+static void updateEstimates(void) {
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        taskENTER_CRITICAL();
+        uint32_t sample = periodDemand[i] << REBALANCER_FIXED_BITS;
+        periodDemand[i] = 0;
+        taskEXIT_CRITICAL();
+
+        int32_t error = (int32_t)(sample - demandEstimate[i]);
+        demandEstimate[i] = (uint32_t)((int32_t)demandEstimate[i] + (error >> REBALANCER_EWMA_SHIFT));
+    }
+}
+
+/**
+ * @brief Moves idle vehicles toward the departments furthest below their target.
+ *
+ * A donor whose vehicles are all committed to its incidents in progress is
+ * skipped for the rest of the period.
+ */
+static void rebalance(void) {
+    // Off the stack; only the rebalancer task runs this
+    static int counts[NUM_DEPARTMENTS];
+    static int32_t surplus[NUM_DEPARTMENTS];
+    static int32_t deficit[NUM_DEPARTMENTS];
+    static DepartmentHeap donors;
+    static DepartmentHeap recipients;
+    int total = 0;
+    uint32_t totalDemand = 0;
+
+    getVehicleCounts(counts);
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        total += counts[i];
+        totalDemand += demandEstimate[i];
+    }
+    if (totalDemand == 0) {
+        return; // No forecast yet
+    }
+
+    // Surplus against the demand-proportional target, in vehicles
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        int target = (int)(((uint64_t)total * demandEstimate[i] + totalDemand / 2) / totalDemand);
+        surplus[i] = counts[i] - target;
+        deficit[i] = -surplus[i];
+    }
+    departmentHeapBuild(&donors, surplus, -1);
+    departmentHeapBuild(&recipients, deficit, -1);
+
+    int budget = REBALANCER_MAX_MOVES;
+    while (budget > 0) {
+        int donor = departmentHeapTop(&donors);
+        int recipient = departmentHeapTop(&recipients);
+        if (donor < 0 || recipient < 0 || donors.keys[donor] <= 0 || recipients.keys[recipient] <= 0) {
+            break; // Every department is at its target
+        }
+        int amount = budget;
+        if (donors.keys[donor] < amount) {
+            amount = donors.keys[donor];
+        }
+        if (recipients.keys[recipient] < amount) {
+            amount = recipients.keys[recipient];
+        }
+
+        PROFILE_BEGIN(PROF_MOVE_IDLE_VEHICLES);
+        int moved = moveIdleVehicles((uint8_t)donor, (uint8_t)recipient, amount);
+        PROFILE_END(PROF_MOVE_IDLE_VEHICLES);
+        if (moved == 0) {
+            (void)departmentHeapPop(&donors); // The donor's vehicles are committed to its current incidents
+            continue;
+        }
+        budget -= moved;
+        departmentHeapUpdate(&donors, (uint8_t)donor, donors.keys[donor] - moved);
+        departmentHeapUpdate(&recipients, (uint8_t)donor, recipients.keys[donor] + moved);
+        departmentHeapUpdate(&donors, (uint8_t)recipient, donors.keys[recipient] + moved);
+        departmentHeapUpdate(&recipients, (uint8_t)recipient, recipients.keys[recipient] - moved);
+
+        taskENTER_CRITICAL();
+        vehiclesMoved += (uint32_t)moved;
+        prepositioned[recipient] += moved;
+        prepositioned[donor] -= (prepositioned[donor] < moved) ? prepositioned[donor] : moved;
+        taskEXIT_CRITICAL();
+    }
+}
+
+/**
+ * @brief Logs the demand estimates and the rebalancing statistics.
+ */
+void rebalancerReport(void) {
+    logMessage("Rebalancer demand estimates (vehicles per period):\r\n");
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        uint32_t estimate = demandEstimate[i];
+        logMessage("  %-10s %lu.%02lu\r\n", departmentName((uint8_t)i),
+                   (unsigned long)(estimate >> REBALANCER_FIXED_BITS),
+                   (unsigned long)(((estimate & ((1U << REBALANCER_FIXED_BITS) - 1)) * 100) >> REBALANCER_FIXED_BITS));
+    }
+    logMessage("Rebalancer: %lu vehicles moved, %lu of %lu incidents avoided borrowing, %lu borrowed on demand\r\n",
+               (unsigned long)vehiclesMoved, (unsigned long)borrowsAvoided,
+               (unsigned long)incidentsAllocated, (unsigned long)reactiveBorrows);
+}
+
+/**
+ * @brief Rebalancer task.
+ *
+ * Runs at low priority, so moving vehicles never delays a dispatch.
+ *
+ * @param params Unused task parameters.
+ */
+void rebalancerTask(void *params) {
+    TickType_t lastWake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&lastWake, REBALANCER_PERIOD);
+
+        updateEstimates();
+        rebalance();
+    }
+}
@@ -0,0 +1,23 @@
+/*
+ * rebalancer.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file rebalancer.h
+/// @brief Proactive vehicle rebalancer interface.
+
+#ifndef INC_REBALANCER_H_
+#define INC_REBALANCER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void initRebalancer(void);
+void rebalancerRecordDemand(uint8_t department, int vehicles);
+void rebalancerRecordAllocation(uint8_t department, int requiredVehicles, int availableVehicles, bool borrowed);
+void rebalancerReport(void);
+void rebalancerTask(void *params);
+
+#endif /* INC_REBALANCER_H_ */
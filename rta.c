@@ -0,0 +1,321 @@
+/**
+ * @file rta.c
+ * @brief Worst-case response-time analysis of the dispatch path.
+ *
+ * The analysis models the dispatch path as sporadic tasks under fixed
+ * priority preemptive scheduling: the incident generator, the dispatcher
+ * shards, the task that advances incident phases and, with
+ * PRIORITY_CONTROLLER_ENABLED, the periodic priority controller. Execution times are the
+ * profiler's maxima (PROFILER_ENABLED), blocking times are the longest
+ * measured holds of the locks shared with lower or equal priority tasks, and
+ * every task's minimum inter-arrival time is the scenario's arrival interval.
+ *
+ * Response times follow the classic recurrence
+ *   R = C + B + sum over other tasks j with priority >= own of ceil(R / Tj) * Cj
+ * iterated to a fixed point. Equal-priority tasks are counted as
+ * interference, since FreeRTOS time-slices between them. Interrupts and
+ * kernel overhead are not modelled.
+ *
+ * From the task bounds the report derives, per department, a bound on the
+ * dispatch latency (arrival to vehicles allocated) and on the incident
+ * response time, and compares both with the maxima measured at run time and
+ * with the department's tightest deadline (high severity). Department handling is a wait rather than CPU
+ * time, so it enters the incident bound through the scenario's longest
+ * handling time; with INCIDENT_HANDLER_TASKS a shard waits for each incident
+ * in turn, so a full backlog queues behind it.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "rta.h"
+#include "dispatcher.h"
+#include "incident.h"
+#include "profiler.h"
+#include "scenario.h"
+#include "logger.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define RTA_UNBOUNDED UINT32_MAX /**< Response time without a finite bound */
+
+/**
+ * @brief Tasks of the dispatch path, in the order of the report.
+ */
+enum {
+    RTA_TASK_GENERATOR = 0,
+    RTA_TASK_SHARDS,
+#if INCIDENT_HANDLER_MODE != INCIDENT_HANDLER_TASKS
+    RTA_TASK_PHASES,
+#endif
+#if PRIORITY_CONTROLLER_ENABLED
+    RTA_TASK_PRIORITY_CONTROL,
+#endif
+    RTA_TASK_COUNT
+};
+
+static volatile uint32_t maxDispatchMs[NUM_DEPARTMENTS]; /**< Longest measured dispatch latency per department */
+static volatile uint32_t maxResponseMs[NUM_DEPARTMENTS]; /**< Longest measured response time per department */
+
+/**
+ * @brief Records the dispatch latency of an incident.
+ *
+ * Called by the department's shard, the only writer of its entry.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param latencyMs Time from arrival until the vehicles were allocated.
+ */
+void rtaRecordDispatch(uint8_t department, uint32_t latencyMs) {
+    if (department < NUM_DEPARTMENTS && latencyMs > maxDispatchMs[department]) {
+        maxDispatchMs[department] = latencyMs;
+    }
+}
+
+/**
+ * @brief Records the response time of a completed incident.
+ *
+ * Called by the department's shard, the only writer of its entry.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param responseMs Time from arrival until the incident was completed.
+ */
+void rtaRecordResponse(uint8_t department, uint32_t responseMs) {
+    if (department < NUM_DEPARTMENTS && responseMs > maxResponseMs[department]) {
+        maxResponseMs[department] = responseMs;
+    }
+}
+
+/**
+ * @brief Computes the worst-case response time of every task.
+ *
+ * @param tasks The task set; `responseUs` is written, RTA_UNBOUNDED past the deadline.
+ * @param count Number of tasks.
+ * @return True if every task meets its deadline.
+ */
+bool rtaAnalyze(RtaTask *tasks, int count) {
+    bool schedulable = true;
+
+    for (int i = 0; i < count; i++) {
+        uint64_t base = (uint64_t)tasks[i].wcetUs + tasks[i].blockingUs;
+        uint64_t response = base;
+
+        while (1) {
+            uint64_t next = base;
+            for (int j = 0; j < count; j++) {
+                if (j == i || tasks[j].priority < tasks[i].priority || tasks[j].periodUs == 0) {
+                    continue;
+                }
+                next += ((response + tasks[j].periodUs - 1) / tasks[j].periodUs) * tasks[j].wcetUs;
+            }
+            if (next > tasks[i].periodUs) {
+                response = RTA_UNBOUNDED;
+                break;
+            }
+            if (next == response) {
+                break;
+            }
+            response = next;
+        }
+
+        tasks[i].responseUs = (uint32_t)response;
+        schedulable = schedulable && response != RTA_UNBOUNDED;
+    }
+    return schedulable;
+}
+
+/**
+ * @brief Gets the longest measured sample of a profiled region.
+ *
+ * @param region The profiled region.
+ * @return The sample in microseconds, rounded up; 0 without samples.
+ */
+static uint32_t measuredMaxUs(ProfileRegion region) {
+    ProfileSummary summary;
+
+    if (!profilerSummary(region, &summary)) {
+        return 0;
+    }
+    return (uint32_t)((profilerToNs(summary.max) + 999U) / 1000U);
+}
+
+/**
+ * @brief Fills in the task set of the dispatch path from the profiler's measurements.
+ *
+ * @param tasks Receives RTA_TASK_COUNT tasks.
+ */
+static void buildTaskSet(RtaTask *tasks) {
+    uint32_t periodUs = scenarioGet()->arrivalMs * 1000U;
+    uint32_t checkpointHoldUs = measuredMaxUs(PROF_CHECKPOINT_HOLD);
+    uint32_t lowVehicleHoldUs = measuredMaxUs(PROF_GET_VEHICLE_COUNT);
+
+    // The rebalancer, console and telemetry take vehicleMutex below the shards' priority
+    if (measuredMaxUs(PROF_MOVE_IDLE_VEHICLES) > lowVehicleHoldUs) {
+        lowVehicleHoldUs = measuredMaxUs(PROF_MOVE_IDLE_VEHICLES);
+    }
+
+    tasks[RTA_TASK_GENERATOR] = (RtaTask){
+        .name = "RandomEvent",
+        .priority = scenarioGet()->dispatcherPriority,
+        .periodUs = periodUs,
+        .wcetUs = measuredMaxUs(PROF_GENERATE_INCIDENT) + checkpointHoldUs,
+        .blockingUs = checkpointHoldUs, // A shard holding the store
+    };
+
+    // One incident per arrival interval reaches the shards in total: one new and one completion event
+    tasks[RTA_TASK_SHARDS] = (RtaTask){
+        .name = "DispatchShard",
+#if PRIORITY_CONTROLLER_ENABLED
+        .priority = DISPATCH_SHARD_PRIORITY + PRIORITY_BOOST_LEVELS, // A boosted shard interferes at its raised priority
+#else
+        .priority = DISPATCH_SHARD_PRIORITY,
+#endif
+        .periodUs = periodUs,
+        .wcetUs = measuredMaxUs(PROF_CHECK_AND_ALLOCATE) + measuredMaxUs(PROF_COMPLETE_INCIDENT),
+        .blockingUs = measuredMaxUs(PROF_REALLOCATE) + lowVehicleHoldUs,
+    };
+
+#if INCIDENT_HANDLER_MODE != INCIDENT_HANDLER_TASKS
+    tasks[RTA_TASK_PHASES] = (RtaTask){
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+        .name = "IncidentWorker",
+        .priority = INCIDENT_WORKER_PRIORITY,
+#elif TIMER_WHEEL_ENABLED
+        .name = "TimerWheel",
+        .priority = TIMER_WHEEL_PRIORITY,
+#else
+        .name = "TmrSvc",
+        .priority = configTIMER_TASK_PRIORITY,
+#endif
+        .periodUs = periodUs,
+        .wcetUs = INCIDENT_PHASE_COUNT * measuredMaxUs(PROF_INCIDENT_PHASE),
+        .blockingUs = 0,
+    };
+#endif
+
+#if PRIORITY_CONTROLLER_ENABLED
+    // Runs above the boosted shards every period, so it interferes with the whole dispatch path
+    tasks[RTA_TASK_PRIORITY_CONTROL] = (RtaTask){
+        .name = "PriorityControl",
+        .priority = PRIORITY_CONTROLLER_PRIORITY,
+        .periodUs = PRIORITY_CONTROLLER_PERIOD * portTICK_PERIOD_MS * 1000U,
+        .wcetUs = measuredMaxUs(PROF_PRIORITY_CONTROL),
+        .blockingUs = 0,
+    };
+#endif
+}
+
+/**
+ * @brief Adds two bounds, keeping RTA_UNBOUNDED sticky.
+ */
+static uint32_t addBound(uint32_t a, uint32_t b) {
+    if (a == RTA_UNBOUNDED || b == RTA_UNBOUNDED || (uint64_t)a + b >= RTA_UNBOUNDED) {
+        return RTA_UNBOUNDED;
+    }
+    return a + b;
+}
+
+/**
+ * @brief Converts a bound in microseconds to whole milliseconds, rounding up.
+ */
+static uint32_t boundToMs(uint32_t us) {
+    return (us == RTA_UNBOUNDED) ? RTA_UNBOUNDED : (us + 999U) / 1000U;
+}
+
+/**
+ * @brief Logs a bound in milliseconds, or "unbounded".
+ */
+static void logBound(const char *label, uint32_t boundMs, uint32_t measuredMs) {
+    if (boundMs == RTA_UNBOUNDED) {
+        logMessage(" %s unbounded (max %lu)", label, (unsigned long)measuredMs);
+    } else {
+        logMessage(" %s <=%lu (max %lu%s)", label, (unsigned long)boundMs, (unsigned long)measuredMs,
+                   (measuredMs > boundMs) ? ", exceeds bound" : "");
+    }
+}
+
+/**
+ * @brief Analyses the dispatch path and logs the bounds next to the measured maxima.
+ *
+ * Configurations whose bounds can exceed a department's high-severity deadline are flagged.
+ */
+void rtaReport(void) {
+    uint32_t arrivalMs = scenarioGet()->arrivalMs;
+    RtaTask tasks[RTA_TASK_COUNT];
+    ProfileSummary summary;
+
+    buildTaskSet(tasks);
+    bool schedulable = rtaAnalyze(tasks, RTA_TASK_COUNT);
+
+    logMessage("Response-time analysis (us, one incident every %lu ms):\r\n", (unsigned long)arrivalMs);
+    if (!profilerSummary(PROF_GENERATE_INCIDENT, &summary)) {
+        logMessage("  No profiler samples yet, execution times count as 0\r\n");
+    }
+    for (int i = 0; i < RTA_TASK_COUNT; i++) {
+        logMessage("  %-15s prio:%u T:%lu C:%lu B:%lu R:", tasks[i].name, (unsigned)tasks[i].priority,
+                   (unsigned long)tasks[i].periodUs, (unsigned long)tasks[i].wcetUs,
+                   (unsigned long)tasks[i].blockingUs);
+        if (tasks[i].responseUs == RTA_UNBOUNDED) {
+            logMessage("unbounded, misses its deadline\r\n");
+        } else {
+            logMessage("%lu\r\n", (unsigned long)tasks[i].responseUs);
+        }
+    }
+
+    uint32_t generatorUs = tasks[RTA_TASK_GENERATOR].responseUs;
+    uint32_t shardUs = tasks[RTA_TASK_SHARDS].responseUs;
+    bool missPossible = !schedulable;
+
+    logMessage("Incident bounds (ms, against the high-severity deadline):\r\n");
+    for (uint8_t i = 0; i < NUM_DEPARTMENTS; i++) {
+        uint32_t handlingUs = scenarioDepartment(i)->handleMaxMs * 1000U;
+        uint32_t dispatchUs;
+        uint32_t responseUs;
+        uint32_t slotsNeeded;
+
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_TASKS
+        // The shard handles one incident at a time, so the backlog waits in turn
+        uint32_t serviceUs = addBound(shardUs, handlingUs);
+        dispatchUs = addBound(generatorUs, shardUs);
+        for (int queued = 1; queued < DISPATCH_SHARD_QUEUE_LENGTH; queued++) {
+            dispatchUs = addBound(dispatchUs, serviceUs);
+        }
+        responseUs = addBound(dispatchUs, handlingUs);
+        // Incidents arriving faster than they are served fill the backlog and stall the generator
+        slotsNeeded = (serviceUs != RTA_UNBOUNDED && serviceUs <= arrivalMs * 1000U) ? 1 : RTA_UNBOUNDED;
+#else
+        uint32_t phaseUs = addBound(tasks[RTA_TASK_PHASES].responseUs, portTICK_PERIOD_MS * 1000U);
+        dispatchUs = addBound(generatorUs, shardUs);
+        responseUs = addBound(addBound(dispatchUs, handlingUs), shardUs);
+#if INCIDENT_HANDLER_MODE == INCIDENT_HANDLER_PROTOTHREADS
+        // Phase deadlines follow on from each other, so only the last wake-up is late
+        responseUs = addBound(responseUs, phaseUs);
+#else
+        // Every phase timer is re-armed from the late callback, so lateness adds up
+        for (int phase = 0; phase < INCIDENT_PHASE_COUNT; phase++) {
+            responseUs = addBound(responseUs, phaseUs);
+        }
+#endif
+        // Each incident holds a backlog slot for its whole response time
+        slotsNeeded = (responseUs == RTA_UNBOUNDED) ? RTA_UNBOUNDED
+                                                    : (responseUs + arrivalMs * 1000U - 1) / (arrivalMs * 1000U);
+#endif
+        if (slotsNeeded > DISPATCH_SHARD_QUEUE_LENGTH) {
+            // The generator can block on a full backlog while incidents keep arriving
+            dispatchUs = RTA_UNBOUNDED;
+            responseUs = RTA_UNBOUNDED;
+        }
+
+        uint32_t responseMs = boundToMs(responseUs);
+        uint32_t deadlineMs = getDeadlineMs(i, SEVERITY_HIGH);
+        bool miss = responseMs == RTA_UNBOUNDED || responseMs > deadlineMs;
+        missPossible = missPossible || miss;
+
+        logMessage("  %-10s", departmentName(i));
+        logBound("dispatch", boundToMs(dispatchUs), maxDispatchMs[i]);
+        logMessage(" |");
+        logBound("response", responseMs, maxResponseMs[i]);
+        logMessage(" deadline %lu %s\r\n", (unsigned long)deadlineMs, miss ? "MISS POSSIBLE" : "ok");
+    }
+    logMessage("Configuration %s\r\n", missPossible ? "can miss incident deadlines" : "meets all deadlines");
+}
@@ -0,0 +1,34 @@
+/*
+ * rta.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file rta.h
+/// @brief Worst-case response-time analysis interface.
+
+#ifndef INC_RTA_H_
+#define INC_RTA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief One sporadic task of the analysed task set.
+ */
+typedef struct {
+    const char *name;       /**< Task name in the report */
+    uint8_t priority;       /**< FreeRTOS priority, higher runs first */
+    uint32_t periodUs;      /**< Shortest time between two jobs, also the deadline */
+    uint32_t wcetUs;        /**< Worst-case execution time of one job */
+    uint32_t blockingUs;    /**< Longest wait for a lock held by a lower or equal priority task */
+    uint32_t responseUs;    /**< Computed worst-case response time */
+} RtaTask;
+
+void rtaRecordDispatch(uint8_t department, uint32_t latencyMs);
+void rtaRecordResponse(uint8_t department, uint32_t responseMs);
+bool rtaAnalyze(RtaTask *tasks, int count);
+void rtaReport(void);
+
+#endif /* INC_RTA_H_ */
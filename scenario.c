@@ -0,0 +1,419 @@
+/**
+ * @file scenario.c
+ * @brief Runtime scenario configuration parsed into a fixed arena.
+ *
+ * A scenario describes the departments, their fleets, task priorities and
+ * stack sizes, the incident arrival rate and the handling-time distribution.
+ * It starts from the compile-time defaults in project_defines.h and is then
+ * overridden by a compact text format, one directive per line:
+ *
+ *     # comment
+ *     name rush-hour
+ *     max_cars 11
+ *     arrival 250
+ *     dispatcher priority=5 stack=256
+ *     dept Police fleet=5 priority=3 stack=256 handle=300-900 weight=2 reserve=1
+ *
+ * The defaults have NUM_DEPARTMENTS departments: the four of DEPARTMENT_NAMES
+ * and then generic ones named Dept4, Dept5 and so on, with EXTRA_DEPARTMENT_*
+ * settings. A `dept` line must name one of them. Everything parsed is stored
+ * in a static arena that is reset on each load, so loading a scenario never
+ * touches the FreeRTOS heap and the same binary can run many scenarios.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "scenario.h"
+#include "logger.h"
+#include "project_defines.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t scenarioArena[SCENARIO_ARENA_SIZE] __attribute__((aligned(8))); /**< Backing store of the scenario */
+static size_t arenaUsed = 0;                                                  /**< Bytes handed out from the arena */
+static Scenario scenario;                                                     /**< The active scenario */
+
+/**
+ * @brief Allocates from the scenario arena.
+ *
+ * @param size Number of bytes.
+ * @return Pointer to 8-byte aligned memory, or NULL if the arena is full.
+ */
+static void *arenaAlloc(size_t size) {
+    size_t aligned = (size + 7U) & ~(size_t)7U;
+    if (arenaUsed + aligned > SCENARIO_ARENA_SIZE) {
+        return NULL;
+    }
+    void *block = &scenarioArena[arenaUsed];
+    arenaUsed += aligned;
+    return block;
+}
+
+/**
+ * @brief Copies a string of known length into the arena.
+ *
+ * @param text The characters to copy.
+ * @param length Number of characters.
+ * @return The NUL-terminated copy, or NULL if the arena is full.
+ */
+static const char *arenaString(const char *text, size_t length) {
+    char *copy = arenaAlloc(length + 1);
+    if (copy != NULL) {
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+/**
+ * @brief Parses an unsigned decimal number.
+ *
+ * @param text The text, not necessarily NUL-terminated.
+ * @param length Number of characters.
+ * @param value Output value.
+ * @return True if the whole text is a number that fits in 32 bits.
+ */
+static bool parseNumber(const char *text, size_t length, uint32_t *value) {
+    uint32_t result = 0;
+    if (length == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        uint32_t digit = (uint32_t)(text[i] - '0');
+        if (result > (UINT32_MAX - digit) / 10U) {
+            return false; // Would wrap around
+        }
+        result = result * 10U + digit;
+    }
+    *value = result;
+    return true;
+}
+
+/**
+ * @brief Splits the next whitespace-separated token off a line.
+ *
+ * @param cursor In/out position in the line.
+ * @param end End of the line.
+ * @param length Output token length.
+ * @return Start of the token, or NULL at the end of the line.
+ */
+static const char *nextToken(const char **cursor, const char *end, size_t *length) {
+    const char *p = *cursor;
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        p++;
+    }
+    if (p >= end || *p == '#') {
+        *cursor = end;
+        return NULL;
+    }
+    const char *start = p;
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r') {
+        p++;
+    }
+    *length = (size_t)(p - start);
+    *cursor = p;
+    return start;
+}
+
+/**
+ * @brief Checks whether a token is `key=...` and returns the value part.
+ */
+static bool matchKey(const char *token, size_t length, const char *key,
+                     const char **value, size_t *valueLength) {
+    size_t keyLength = strlen(key);
+    if (length <= keyLength || strncmp(token, key, keyLength) != 0 || token[keyLength] != '=') {
+        return false;
+    }
+    *value = token + keyLength + 1;
+    *valueLength = length - keyLength - 1;
+    return true;
+}
+
+/**
+ * @brief Applies the key=value options of a `dept` directive.
+ */
+static bool parseDepartmentOptions(DepartmentConfig *config, const char *cursor, const char *end) {
+    const char *token;
+    size_t length;
+
+    while ((token = nextToken(&cursor, end, &length)) != NULL) {
+        const char *value;
+        size_t valueLength;
+        uint32_t number;
+
+        if (matchKey(token, length, "fleet", &value, &valueLength) && parseNumber(value, valueLength, &number) &&
+            number <= INT16_MAX) { // Checkpoints keep the counts in 16 bits
+            config->fleet = (int)number;
+        } else if (matchKey(token, length, "priority", &value, &valueLength) &&
+                   parseNumber(value, valueLength, &number)) {
+            config->priority = (uint8_t)number;
+        } else if (matchKey(token, length, "stack", &value, &valueLength) &&
+                   parseNumber(value, valueLength, &number)) {
+            config->stackWords = (uint16_t)number;
+        } else if (matchKey(token, length, "weight", &value, &valueLength) &&
+                   parseNumber(value, valueLength, &number)) {
+            config->arrivalWeight = (uint16_t)number;
+        } else if (matchKey(token, length, "reserve", &value, &valueLength) &&
+                   parseNumber(value, valueLength, &number)) {
+            config->reserve = (int)number;
+        } else if (matchKey(token, length, "handle", &value, &valueLength)) {
+            const char *dash = memchr(value, '-', valueLength);
+            uint32_t low;
+            uint32_t high;
+            if (dash == NULL) {
+                if (!parseNumber(value, valueLength, &low)) {
+                    return false;
+                }
+                high = low;
+            } else if (!parseNumber(value, (size_t)(dash - value), &low) ||
+                       !parseNumber(dash + 1, valueLength - (size_t)(dash - value) - 1, &high) || high < low) {
+                return false;
+            }
+            config->handleMinMs = low;
+            config->handleMaxMs = high;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Parses one scenario line.
+ *
+ * @return True if the line is valid (blank lines and comments are valid).
+ */
+static bool parseLine(const char *line, const char *end) {
+    const char *cursor = line;
+    size_t length;
+    const char *directive = nextToken(&cursor, end, &length);
+    const char *argument;
+    size_t argumentLength;
+    uint32_t number;
+
+    if (directive == NULL) {
+        return true;
+    }
+    argument = nextToken(&cursor, end, &argumentLength);
+    if (argument == NULL) {
+        return false;
+    }
+
+    if (length == 4 && strncmp(directive, "name", 4) == 0) {
+        scenario.name = arenaString(argument, argumentLength);
+        return scenario.name != NULL;
+    }
+    if (length == 8 && strncmp(directive, "max_cars", 8) == 0) {
+        if (!parseNumber(argument, argumentLength, &number) || number == 0) {
+            return false;
+        }
+        scenario.maxCars = (int)number;
+        return true;
+    }
+    if (length == 7 && strncmp(directive, "arrival", 7) == 0) {
+        if (!parseNumber(argument, argumentLength, &number) || number == 0) {
+            return false;
+        }
+        scenario.arrivalMs = number;
+        return true;
+    }
+    if (length == 10 && strncmp(directive, "dispatcher", 10) == 0) {
+        DepartmentConfig options = {
+            .priority = scenario.dispatcherPriority,
+            .stackWords = scenario.dispatcherStackWords
+        };
+        if (!parseDepartmentOptions(&options, argument, end)) {
+            return false;
+        }
+        scenario.dispatcherPriority = options.priority;
+        scenario.dispatcherStackWords = options.stackWords;
+        return true;
+    }
+    if (length == 4 && strncmp(directive, "dept", 4) == 0) {
+        for (int i = 0; i < scenario.departmentCount; i++) {
+            const char *name = scenario.departments[i].name;
+            if (strlen(name) == argumentLength && strncmp(name, argument, argumentLength) == 0) {
+                return parseDepartmentOptions(&scenario.departments[i], cursor, end);
+            }
+        }
+        return false;
+    }
+    return false;
+}
+
+/**
+ * @brief Checks that every incident the scenario can generate can be served.
+ *
+ * An incident needs up to `max_cars` vehicles, which must fit the 8-bit
+ * request field and the fleets of all departments together; otherwise its
+ * shard would wait for vehicles forever.
+ *
+ * @return True if the scenario is consistent.
+ */
+static bool scenarioValid(void) {
+    int totalFleet = 0;
+
+    for (int i = 0; i < scenario.departmentCount; i++) {
+        totalFleet += scenario.departments[i].fleet;
+    }
+    if (scenario.maxCars > UINT8_MAX || scenario.maxCars > totalFleet) {
+        logMessage("Scenario max_cars %d exceeds the largest servable incident (%d vehicles), using defaults\r\n",
+                   scenario.maxCars, (totalFleet < UINT8_MAX) ? totalFleet : UINT8_MAX);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Resets the scenario to the compile-time defaults of project_defines.h.
+ */
+void scenarioLoadDefaults(void) {
+    const char *departmentNames[] = DEPARTMENT_NAMES;
+    const int fleets[] = {POLICE_COUNT_INITIAL, FIRE_COUNT_INITIAL, AMBULANCE_COUNT_INITIAL, CORONA_COUNT_INITIAL};
+    const uint8_t priorities[] = {POLICE_TASK_PRIORITY, FIRE_TASK_PRIORITY, AMBULANCE_TASK_PRIORITY, CORONA_TASK_PRIORITY};
+    const uint16_t stacks[] = {POLICE_STACK_SIZE, FIRE_STACK_SIZE, AMBULANCE_STACK_SIZE, CORONA_STACK_SIZE};
+    const int reserves[] = RESERVE_FLOORS;
+    const int named = sizeof(fleets) / sizeof(fleets[0]);
+
+    arenaUsed = 0;
+    scenario.name = "default";
+    scenario.departmentCount = NUM_DEPARTMENTS;
+    scenario.departments = arenaAlloc(sizeof(DepartmentConfig) * NUM_DEPARTMENTS);
+    scenario.maxCars = MAX_CARS;
+    scenario.arrivalMs = SCENARIO_DEFAULT_ARRIVAL_MS;
+    scenario.dispatcherPriority = RANDOM_EVENT_PRIORITY;
+    scenario.dispatcherStackWords = RANDOM_EVENT_STACK_SIZE;
+
+    for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+        char extraName[8];
+        int length = snprintf(extraName, sizeof(extraName), "Dept%d", i);
+        scenario.departments[i] = (DepartmentConfig){
+            .name = (i < named) ? departmentNames[i] : arenaString(extraName, (size_t)length),
+            .fleet = (i < named) ? fleets[i] : EXTRA_DEPARTMENT_FLEET,
+            .priority = priorities[(i < named) ? i : 0], // Only department tasks use these, and they are four
+            .stackWords = stacks[(i < named) ? i : 0],
+            .handleMinMs = SCENARIO_DEFAULT_HANDLING_MS,
+            .handleMaxMs = SCENARIO_DEFAULT_HANDLING_MS,
+            .arrivalWeight = 1,
+            .reserve = (i < named) ? reserves[i] : EXTRA_DEPARTMENT_RESERVE
+        };
+    }
+}
+
+/**
+ * @brief Loads a scenario from text on top of the defaults.
+ *
+ * On a parse error the defaults stay active and the offending line is logged;
+ * so do they for a scenario with incidents no fleet can serve.
+ *
+ * @param text The scenario text, NUL-terminated.
+ * @return True if the whole text was applied.
+ */
+bool scenarioLoad(const char *text) {
+    int lineNumber = 1;
+
+    scenarioLoadDefaults();
+    while (*text != '\0') {
+        const char *end = strchr(text, '\n');
+        if (end == NULL) {
+            end = text + strlen(text);
+        }
+
+        if (!parseLine(text, end)) {
+            logMessage("Scenario error at line %d, using defaults\r\n", lineNumber);
+            scenarioLoadDefaults();
+            return false;
+        }
+
+        text = (*end == '\n') ? end + 1 : end;
+        lineNumber++;
+    }
+    if (!scenarioValid()) {
+        scenarioLoadDefaults();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Loads a scenario file (host builds only).
+ *
+ * @param path The file path.
+ * @return True if the file was read and applied.
+ */
+bool scenarioLoadFile(const char *path) {
+#if defined(STM32F746xx)
+    (void)path;
+    return false;
+#else
+    static char text[SCENARIO_FILE_MAX];
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    size_t length = fread(text, 1, sizeof(text) - 1, file);
+    fclose(file);
+    text[length] = '\0';
+    return scenarioLoad(text);
+#endif
+}
+
+/**
+ * @brief Gets the active scenario.
+ *
+ * @return The scenario.
+ */
+const Scenario *scenarioGet(void) {
+    return &scenario;
+}
+
+/**
+ * @brief Gets the configuration of one department.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return The configuration, or NULL for an unknown department.
+ */
+const DepartmentConfig *scenarioDepartment(uint8_t department) {
+    return (department < scenario.departmentCount) ? &scenario.departments[department] : NULL;
+}
+
+/**
+ * @brief Gets the name of a department, for logging.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @return The name, or "?" for an unknown department.
+ */
+const char *departmentName(uint8_t department) {
+    const DepartmentConfig *config = scenarioDepartment(department);
+    return (config != NULL && config->name != NULL) ? config->name : "?";
+}
+
+/**
+ * @brief Changes the time between incidents while the simulation runs.
+ *
+ * @param arrivalMs The new inter-arrival time in milliseconds (at least 1).
+ */
+void scenarioSetArrivalMs(uint32_t arrivalMs) {
+    scenario.arrivalMs = (arrivalMs > 0) ? arrivalMs : 1;
+}
+
+/**
+ * @brief Logs the active scenario.
+ */
+void scenarioReport(void) {
+    logMessage("Scenario '%s': max_cars %d, arrival %lu ms, arena %u/%u bytes\r\n",
+               scenario.name, scenario.maxCars, (unsigned long)scenario.arrivalMs,
+               (unsigned)arenaUsed, (unsigned)SCENARIO_ARENA_SIZE);
+    for (int i = 0; i < scenario.departmentCount; i++) {
+        const DepartmentConfig *config = &scenario.departments[i];
+        logMessage("  %-10s fleet:%d priority:%u stack:%u handle:%lu-%lu ms weight:%u reserve:%d\r\n",
+                   config->name, config->fleet, config->priority, config->stackWords,
+                   (unsigned long)config->handleMinMs, (unsigned long)config->handleMaxMs,
+                   config->arrivalWeight, config->reserve);
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * scenario.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file scenario.h
+/// @brief Runtime scenario configuration interface.
+
+#ifndef INC_SCENARIO_H_
+#define INC_SCENARIO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Configuration of one department.
+ */
+typedef struct {
+    const char *name;          /**< Department name (stored in the scenario arena) */
+    int fleet;                 /**< Initial number of vehicles */
+    uint8_t priority;          /**< Department task priority */
+    uint16_t stackWords;       /**< Department task stack size in words */
+    uint32_t handleMinMs;      /**< Shortest incident handling time */
+    uint32_t handleMaxMs;      /**< Longest incident handling time */
+    uint16_t arrivalWeight;    /**< Relative share of incidents, 0 = never */
+    int reserve;               /**< Vehicles the department never lends to routine incidents */
+} DepartmentConfig;
+
+/**
+ * @brief Complete scenario, parsed once at startup.
+ */
+typedef struct {
+    const char *name;                  /**< Scenario name (stored in the scenario arena) */
+    int departmentCount;               /**< Number of entries in departments */
+    DepartmentConfig *departments;     /**< Indexed by department (POLICE, FIRE, etc.) */
+    int maxCars;                       /**< Largest number of vehicles one incident requests */
+    volatile uint32_t arrivalMs;       /**< Time between two incidents */
+    uint8_t dispatcherPriority;        /**< Dispatcher task priority */
+    uint16_t dispatcherStackWords;     /**< Dispatcher task stack size in words */
+} Scenario;
+
+void scenarioLoadDefaults(void);
+bool scenarioLoad(const char *text);
+bool scenarioLoadFile(const char *path);
+const Scenario *scenarioGet(void);
+const DepartmentConfig *scenarioDepartment(uint8_t department);
+const char *departmentName(uint8_t department);
+void scenarioSetArrivalMs(uint32_t arrivalMs);
+void scenarioReport(void);
+
+#endif /* INC_SCENARIO_H_ */
@@ -0,0 +1,253 @@
+/**
+ * @file stack_monitor.c
+ * @brief Stack high-water monitoring and stack-size recommendation.
+ *
+ * This file implements a low-priority task that periodically samples the stack
+ * high-water mark of every task in the system and keeps the worst value seen
+ * per task. The report lists the minimum safe stack size for each task and can
+ * also be emitted as a ready-to-paste block of `*_STACK_SIZE` defines.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "stack_monitor.h"
+#include "logger.h"
+#include "project_defines.h"
+#include "scenario.h"
+#include "vehicle_management.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
+
+/**
+ * @brief Configured stack size of a task created by the simulation.
+ */
+typedef struct {
+    const char *taskName;     /**< Name passed to xTaskCreate */
+    const char *defineName;   /**< Define holding the default size */
+    int department;           /**< Department whose scenario sets the size, -1 if none */
+    uint16_t defaultWords;    /**< Default stack size in words */
+} StackBudget;
+
+/**
+ * @brief Worst observed stack usage for one task.
+ */
+typedef struct {
+    char taskName[configMAX_TASK_NAME_LEN];  /**< Task name as reported by the kernel */
+    uint16_t minFreeWords;                   /**< Lowest high-water mark seen, in words */
+} StackRecord;
+
+static const StackBudget stackBudgets[] = {
+    {"PoliceTask",    "POLICE_STACK_SIZE",        POLICE,    POLICE_STACK_SIZE},
+    {"FireTask",      "FIRE_STACK_SIZE",          FIRE,      FIRE_STACK_SIZE},
+    {"AmbulanceTask", "AMBULANCE_STACK_SIZE",     AMBULANCE, AMBULANCE_STACK_SIZE},
+    {"CoronaTask",    "CORONA_STACK_SIZE",        CORONA,    CORONA_STACK_SIZE},
+    {"RandomEvent",   "RANDOM_EVENT_STACK_SIZE",  -1,        RANDOM_EVENT_STACK_SIZE},
+    {"*Shard",        "DISPATCH_SHARD_STACK_SIZE", -1,       DISPATCH_SHARD_STACK_SIZE}, // One per department
+    {"StackMonitor",  "STACK_MONITOR_STACK_SIZE", -1,        STACK_MONITOR_STACK_SIZE},
+    {"Console",       "CONSOLE_STACK_SIZE",       -1,        CONSOLE_STACK_SIZE},
+    {"Telemetry",     "TELEMETRY_STACK_SIZE",     -1,        TELEMETRY_STACK_SIZE},
+    {"Rebalancer",    "REBALANCER_STACK_SIZE",    -1,        REBALANCER_STACK_SIZE},
+    {"TimerWheel",    "TIMER_WHEEL_STACK_SIZE",   -1,        TIMER_WHEEL_STACK_SIZE},
+    {"IncidentWorker", "INCIDENT_WORKER_STACK_SIZE", -1,     INCIDENT_WORKER_STACK_SIZE},
+    {"PriorityControl", "PRIORITY_CONTROLLER_STACK_SIZE", -1, PRIORITY_CONTROLLER_STACK_SIZE},
+    {"LogFlush",      "LOGGER_STACK_SIZE",        -1,        LOGGER_STACK_SIZE},
+    {"Tmr Svc",       "configTIMER_TASK_STACK_DEPTH", -1,    configTIMER_TASK_STACK_DEPTH}, // Runs the incident timers
+};
+
+static TaskStatus_t taskStatus[STACK_MONITOR_MAX_TASKS]; /**< Scratch buffer for uxTaskGetSystemState */
+static StackRecord stackRecords[STACK_MONITOR_MAX_TASKS]; /**< Worst case per task */
+static int stackRecordCount = 0;                          /**< Number of used entries in stackRecords */
+
+/**
+ * @brief Looks up the configured stack budget of a task by name.
+ *
+ * A budget name starting with '*' matches every task name ending in the rest.
+ *
+ * @param taskName The task name.
+ * @return The matching budget, or NULL for tasks not created by the simulation.
+ */
+static const StackBudget *findBudget(const char *taskName) {
+    size_t nameLength = strlen(taskName);
+
+    for (size_t i = 0; i < sizeof(stackBudgets) / sizeof(stackBudgets[0]); i++) {
+        const char *budgetName = stackBudgets[i].taskName;
+        if (budgetName[0] == '*') {
+            size_t suffixLength = strlen(budgetName + 1);
+            if (nameLength >= suffixLength && strncmp(taskName + nameLength - suffixLength, budgetName + 1,
+                                                      suffixLength) == 0) {
+                return &stackBudgets[i];
+            }
+        } else if (strncmp(budgetName, taskName, configMAX_TASK_NAME_LEN) == 0) {
+            return &stackBudgets[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Gets the stack size a task was actually created with.
+ *
+ * @param budget The task's budget entry.
+ * @return The stack size in words.
+ */
+static uint16_t configuredWords(const StackBudget *budget) {
+    if (budget->department >= 0) {
+        return scenarioDepartment((uint8_t)budget->department)->stackWords;
+    }
+    if (strcmp(budget->taskName, "RandomEvent") == 0) {
+        return scenarioGet()->dispatcherStackWords;
+    }
+    return budget->defaultWords;
+}
+
+/**
+ * @brief Returns the record of a task, creating it on first sight.
+ *
+ * @param taskName The task name.
+ * @return The record, or NULL if the table is full.
+ */
+static StackRecord *findOrAddRecord(const char *taskName) {
+    for (int i = 0; i < stackRecordCount; i++) {
+        if (strncmp(stackRecords[i].taskName, taskName, configMAX_TASK_NAME_LEN) == 0) {
+            return &stackRecords[i];
+        }
+    }
+    if (stackRecordCount >= STACK_MONITOR_MAX_TASKS) {
+        return NULL;
+    }
+
+    StackRecord *record = &stackRecords[stackRecordCount++];
+    strncpy(record->taskName, taskName, configMAX_TASK_NAME_LEN - 1);
+    record->taskName[configMAX_TASK_NAME_LEN - 1] = '\0';
+    record->minFreeWords = UINT16_MAX;
+    return record;
+}
+
+/**
+ * @brief Computes the recommended stack size for an observed usage.
+ *
+ * Adds the safety margin, rounds up to a multiple of 8 words and never goes
+ * below the kernel's minimal stack size.
+ *
+ * @param usedWords Peak number of stack words used.
+ * @return The recommended stack size in words.
+ */
+static uint16_t recommendStackWords(uint16_t usedWords) {
+    uint32_t words = usedWords + STACK_MONITOR_MARGIN_WORDS;
+    words = (words + 7U) & ~7U;
+    if (words < configMINIMAL_STACK_SIZE) {
+        words = configMINIMAL_STACK_SIZE;
+    }
+    return (uint16_t)words;
+}
+
+/**
+ * @brief Initializes the stack monitor task.
+ */
+void initStackMonitor(void) {
+    if (xTaskCreate(stackMonitorTask, "StackMonitor", STACK_MONITOR_STACK_SIZE, NULL,
+                    STACK_MONITOR_PRIORITY, NULL) == pdPASS) {
+        logMessage("Stack monitor task created successfully\r\n");
+    } else {
+        logMessage("Failed to create stack monitor task\r\n");
+    }
+}
+
+/**
+ * @brief Samples the stack high-water mark of every task.
+ *
+ * The high-water mark is the minimum amount of free stack a task ever had, so
+ * keeping the lowest value seen is enough to capture the worst case.
+ */
+void stackMonitorSample(void) {
+    UBaseType_t taskCount = uxTaskGetSystemState(taskStatus, STACK_MONITOR_MAX_TASKS, NULL);
+
+    for (UBaseType_t i = 0; i < taskCount; i++) {
+        StackRecord *record = findOrAddRecord(taskStatus[i].pcTaskName);
+        if (record != NULL && taskStatus[i].usStackHighWaterMark < record->minFreeWords) {
+            record->minFreeWords = taskStatus[i].usStackHighWaterMark;
+        }
+    }
+}
+
+/**
+ * @brief Reports worst-case stack usage and the minimum safe size per task.
+ *
+ * @param emitHeader If true, also prints the recommendations as a block of
+ *                   defines that can replace the ones in project_defines.h.
+ */
+void stackMonitorReport(bool emitHeader) {
+    logMessage("Stack usage report (words):\r\n");
+    for (int i = 0; i < stackRecordCount; i++) {
+        const StackBudget *budget = findBudget(stackRecords[i].taskName);
+        if (budget == NULL) {
+            logMessage("  %-16s free:%u\r\n", stackRecords[i].taskName, stackRecords[i].minFreeWords);
+            continue;
+        }
+
+        uint16_t size = configuredWords(budget);
+        uint16_t used = size - stackRecords[i].minFreeWords;
+        logMessage("  %-16s size:%u used:%u free:%u recommended:%u\r\n",
+                   stackRecords[i].taskName, size, used,
+                   stackRecords[i].minFreeWords, recommendStackWords(used));
+    }
+
+    if (!emitHeader) {
+        return;
+    }
+
+    logMessage("// Task stack sizes (tuned by stack monitor, margin %d words)\r\n",
+               STACK_MONITOR_MARGIN_WORDS);
+    for (int i = 0; i < stackRecordCount; i++) {
+        const StackBudget *budget = findBudget(stackRecords[i].taskName);
+        if (budget == NULL) {
+            continue;
+        }
+
+        // Tasks sharing a define (the dispatcher shards) are sized for the deepest one
+        uint16_t used = configuredWords(budget) - stackRecords[i].minFreeWords;
+        bool printed = false;
+        for (int j = 0; j < stackRecordCount; j++) {
+            const StackBudget *other = findBudget(stackRecords[j].taskName);
+            if (j == i || other == NULL || strcmp(other->defineName, budget->defineName) != 0) {
+                continue;
+            }
+            if (j < i) {
+                printed = true;
+                break;
+            }
+            uint16_t otherUsed = configuredWords(other) - stackRecords[j].minFreeWords;
+            if (otherUsed > used) {
+                used = otherUsed;
+            }
+        }
+        if (!printed) {
+            logMessage("#define %s %u\r\n", budget->defineName, recommendStackWords(used));
+        }
+    }
+}
+
+/**
+ * @brief Stack monitor task.
+ *
+ * Samples all tasks every `STACK_MONITOR_PERIOD` and prints a report with the
+ * tuned header every `STACK_MONITOR_REPORT_EVERY` samples.
+ *
+ * @param params Unused task parameters.
+ */
+void stackMonitorTask(void *params) {
+    int samples = 0;
+
+    while (1) {
+        stackMonitorSample();
+
+        if (++samples >= STACK_MONITOR_REPORT_EVERY) {
+            stackMonitorReport(true);
+            samples = 0;
+        }
+
+        vTaskDelay(STACK_MONITOR_PERIOD);
+    }
+}
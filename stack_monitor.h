@@ -0,0 +1,21 @@
+/*
+ * stack_monitor.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file stack_monitor.h
+/// @brief Stack high-water monitor interface.
+
+#ifndef INC_STACK_MONITOR_H_
+#define INC_STACK_MONITOR_H_
+
+#include <stdbool.h>
+
+void initStackMonitor(void);
+void stackMonitorSample(void);
+void stackMonitorReport(bool emitHeader);
+void stackMonitorTask(void *params);
+
+#endif /* INC_STACK_MONITOR_H_ */
@@ -0,0 +1,213 @@
+/**
+ * @file telemetry.c
+ * @brief Fixed-rate binary telemetry frames on the UART.
+ *
+ * Once per `TELEMETRY_PERIOD` a TelemetryFrame is sampled, followed by a
+ * CRC-16/CCITT and COBS-encoded, so the frame contains no zero bytes. Every
+ * frame is sent as 0x00 <COBS bytes> 0x00. Text log output never contains
+ * 0x00, so a decoder can pick frames out of a mixed stream and resynchronize
+ * after any garbage. With the four default departments a frame costs about 35
+ * bytes per second, far less than the text log of a single incident, and
+ * each further department adds three bytes.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "telemetry.h"
+#include "dispatcher.h"
+#include "vehicle_management.h"
+#include "logger.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(STM32F746xx)
+#include "stm32f7xx_hal.h"
+
+extern UART_HandleTypeDef huart3;
+#endif
+
+#define TELEMETRY_MAX_TASKS STACK_MONITOR_MAX_TASKS /**< Every task, as the stack monitor samples them */
+#define TELEMETRY_ENCODED_SIZE (sizeof(TelemetryFrame) + 2 + (sizeof(TelemetryFrame) + 2) / 254 + 3)
+
+static TaskStatus_t taskStatus[TELEMETRY_MAX_TASKS]; /**< Scratch buffer for uxTaskGetSystemState */
+static uint32_t lastTotalRunTime = 0;                 /**< Run-time counter at the previous sample */
+static uint32_t lastIdleRunTime = 0;                  /**< Idle task run time at the previous sample */
+
+/**
+ * @brief Computes the CRC-16/CCITT-FALSE of a buffer.
+ *
+ * @param data The data.
+ * @param length Number of bytes.
+ * @return The CRC value.
+ */
+static uint16_t crc16(const uint8_t *data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief COBS-encodes a buffer.
+ *
+ * @param input The data.
+ * @param length Number of bytes.
+ * @param output Destination, at least length + length / 254 + 1 bytes.
+ * @return Number of encoded bytes.
+ */
+static size_t cobsEncode(const uint8_t *input, size_t length, uint8_t *output) {
+    size_t codeIndex = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        if (input[i] == 0) {
+            output[codeIndex] = code;
+            codeIndex = out++;
+            code = 1;
+        } else {
+            output[out++] = input[i];
+            if (++code == 0xFF) {
+                output[codeIndex] = code;
+                codeIndex = out++;
+                code = 1;
+            }
+        }
+    }
+    output[codeIndex] = code;
+    return out;
+}
+
+/**
+ * @brief Computes the CPU load since the previous call from the idle task's run time.
+ *
+ * @return CPU load in percent.
+ */
+static uint8_t sampleCpuPercent(void) {
+    uint32_t totalRunTime = 0;
+    uint32_t idleRunTime = 0;
+    // Fills nothing if there are more tasks than entries, so the buffer must hold every task
+    UBaseType_t taskCount = uxTaskGetSystemState(taskStatus, TELEMETRY_MAX_TASKS, &totalRunTime);
+    if (taskCount == 0) {
+        return 0;
+    }
+
+    for (UBaseType_t i = 0; i < taskCount; i++) {
+        if (strcmp(taskStatus[i].pcTaskName, "IDLE") == 0) {
+            idleRunTime = taskStatus[i].ulRunTimeCounter;
+        }
+    }
+
+    uint32_t totalDelta = totalRunTime - lastTotalRunTime;
+    uint32_t idleDelta = idleRunTime - lastIdleRunTime;
+    lastTotalRunTime = totalRunTime;
+    lastIdleRunTime = idleRunTime;
+
+    if (totalDelta == 0 || idleDelta > totalDelta) {
+        return 0;
+    }
+    return (uint8_t)(100U - (uint32_t)(((uint64_t)idleDelta * 100U) / totalDelta));
+}
+
+/**
+ * @brief Saturates a millisecond value to the 16-bit frame field.
+ */
+static uint16_t clampMs(uint32_t milliseconds) {
+    return (milliseconds > UINT16_MAX) ? UINT16_MAX : (uint16_t)milliseconds;
+}
+
+/**
+ * @brief Initializes the telemetry task.
+ */
+void initTelemetry(void) {
+    if (xTaskCreate(telemetryTask, "Telemetry", TELEMETRY_STACK_SIZE, NULL, TELEMETRY_PRIORITY, NULL) == pdPASS) {
+        logMessage("Telemetry task created successfully\r\n");
+    } else {
+        logMessage("Failed to create telemetry task\r\n");
+    }
+}
+
+/**
+ * @brief Appends the CRC to a frame and COBS-encodes it with both delimiters.
+ *
+ * @param frame The frame.
+ * @param output Destination buffer.
+ * @param size Size of the destination buffer.
+ * @return Number of bytes to transmit, 0 if the buffer is too small.
+ */
+size_t telemetryEncode(const TelemetryFrame *frame, uint8_t *output, size_t size) {
+    uint8_t raw[sizeof(TelemetryFrame) + 2];
+
+    if (size < TELEMETRY_ENCODED_SIZE) {
+        return 0;
+    }
+
+    memcpy(raw, frame, sizeof(TelemetryFrame));
+    uint16_t crc = crc16(raw, sizeof(TelemetryFrame));
+    raw[sizeof(TelemetryFrame)] = (uint8_t)(crc & 0xFF);
+    raw[sizeof(TelemetryFrame) + 1] = (uint8_t)(crc >> 8);
+
+    output[0] = 0x00;
+    size_t length = cobsEncode(raw, sizeof(raw), &output[1]);
+    output[1 + length] = 0x00;
+    return length + 2;
+}
+
+/**
+ * @brief Telemetry task.
+ *
+ * Samples and transmits one frame per `TELEMETRY_PERIOD`. The scheduler is
+ * suspended while a frame is sent so that no text line is written into the
+ * middle of it.
+ *
+ * @param params Unused task parameters.
+ */
+void telemetryTask(void *params) {
+    static uint8_t encoded[TELEMETRY_ENCODED_SIZE];
+    TickType_t lastWake = xTaskGetTickCount();
+    uint16_t sequence = 0;
+
+    while (1) {
+        vTaskDelayUntil(&lastWake, TELEMETRY_PERIOD);
+
+        TelemetryFrame frame = {
+            .version = TELEMETRY_VERSION,
+            .departmentCount = NUM_DEPARTMENTS,
+            .sequence = sequence++,
+            .simulationTime = getSimulationTime(),
+            .queueDepth = (uint16_t)getDispatchQueueDepth(),
+            .cpuPercent = sampleCpuPercent(),
+            .latencyP50 = clampMs(getResponseTimePercentile(50)),
+            .latencyP95 = clampMs(getResponseTimePercentile(95)),
+            .latencyP99 = clampMs(getResponseTimePercentile(99)),
+        };
+        int counts[NUM_DEPARTMENTS];
+        getVehicleCounts(counts);
+        for (int i = 0; i < NUM_DEPARTMENTS; i++) {
+            frame.vehicleCounts[i] = (counts[i] > UINT16_MAX) ? UINT16_MAX : (uint16_t)counts[i];
+            frame.inFlight[i] = (uint8_t)getInFlightCount((uint8_t)i);
+        }
+
+        size_t length = telemetryEncode(&frame, encoded, sizeof(encoded));
+        if (length == 0) {
+            continue;
+        }
+
+        vTaskSuspendAll();
+#if defined(STM32F746xx)
+        HAL_UART_Transmit(&huart3, encoded, (uint16_t)length, 0xFFFF);
+#else
+        fwrite(encoded, 1, length, stdout);
+        fflush(stdout);
+#endif
+        (void)xTaskResumeAll();
+    }
+}
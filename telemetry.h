@@ -0,0 +1,46 @@
+/*
+ * telemetry.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file telemetry.h
+/// @brief Binary telemetry stream interface.
+
+#ifndef INC_TELEMETRY_H_
+#define INC_TELEMETRY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "project_defines.h"
+
+#define TELEMETRY_VERSION 2
+
+/**
+ * @brief One telemetry sample, sent little-endian and packed.
+ *
+ * The per-department arrays come last, so a decoder reads the fixed fields
+ * first and sizes the rest from departmentCount.
+ * Keep in sync with HEADER_FORMAT in tools/telemetry_decode.py.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t version;            /**< TELEMETRY_VERSION */
+    uint8_t departmentCount;    /**< Number of entries in the per-department arrays */
+    uint16_t sequence;          /**< Frame counter, wraps */
+    uint32_t simulationTime;    /**< Simulated time in ticks */
+    uint16_t queueDepth;        /**< Dispatch requests waiting */
+    uint8_t cpuPercent;         /**< CPU load over the last period */
+    uint16_t latencyP50;        /**< Response time percentiles in ms */
+    uint16_t latencyP95;
+    uint16_t latencyP99;
+    uint16_t vehicleCounts[NUM_DEPARTMENTS]; /**< Vehicles per department */
+    uint8_t inFlight[NUM_DEPARTMENTS];       /**< Incidents in progress per department */
+} TelemetryFrame;
+
+void initTelemetry(void);
+size_t telemetryEncode(const TelemetryFrame *frame, uint8_t *output, size_t size);
+void telemetryTask(void *params);
+
+#endif /* INC_TELEMETRY_H_ */
@@ -0,0 +1,250 @@
+/**
+ * @file timer_wheel.c
+ * @brief Hierarchical timing wheel for large numbers of timeouts.
+ *
+ * TIMER_WHEEL_LEVELS wheels of 2^TIMER_WHEEL_SLOT_BITS slots each. Level 0
+ * has one slot per tick; each level above covers 2^TIMER_WHEEL_SLOT_BITS
+ * times the span of the level below. A timeout is linked into the slot of
+ * the lowest level that can hold its expiry, so scheduling and cancelling are
+ * O(1) regardless of how many timeouts are pending; the FreeRTOS timer list
+ * is sorted on insert and costs O(n). When a lower wheel wraps, the entries of
+ * the current slot one level up are redistributed downward ("cascade").
+ *
+ * The wheel task sleeps while nothing is pending and otherwise advances the
+ * wheel once per tick, calling expired callbacks in its own context.
+ * Callbacks may schedule and cancel entries but must not block for long.
+ *
+ * The slot lists are guarded by suspending the scheduler rather than by
+ * critical sections, so a long cascade never holds off interrupts. Schedule
+ * and cancel are therefore task-level calls, not for interrupts.
+ *
+ * @date Oct 18, 2026
+ * @author Haim
+ */
+
+#include "timer_wheel.h"
+#include "logger.h"
+#include "project_defines.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define WHEEL_SLOTS (1U << TIMER_WHEEL_SLOT_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1U)
+#define WHEEL_MAX_DELAY ((1UL << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1UL)
+
+static TimerWheelEntry *wheel[TIMER_WHEEL_LEVELS][WHEEL_SLOTS]; /**< Slot lists per level */
+static uint32_t wheelTime = 0;                                  /**< Last tick processed */
+static uint32_t pendingCount = 0;                               /**< Scheduled entries */
+static TaskHandle_t wheelTaskHandle = NULL;                     /**< Woken when the wheel leaves idle */
+
+/**
+ * @brief Links an entry into the slot matching its expiry. Call with the scheduler suspended.
+ *
+ * @param entry The entry, with its expiry set.
+ */
+static void wheelInsert(TimerWheelEntry *entry) {
+    uint32_t delta = entry->expiry - wheelTime;
+    int level = 0;
+
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1UL << (TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    TimerWheelEntry **head = &wheel[level][(entry->expiry >> (TIMER_WHEEL_SLOT_BITS * level)) & WHEEL_MASK];
+
+    entry->next = *head;
+    if (*head != NULL) {
+        (*head)->pprev = &entry->next;
+    }
+    *head = entry;
+    entry->pprev = head;
+}
+
+/**
+ * @brief Unlinks an entry from its slot. Call with the scheduler suspended.
+ *
+ * @param entry A scheduled entry.
+ */
+static void wheelUnlink(TimerWheelEntry *entry) {
+    *entry->pprev = entry->next;
+    if (entry->next != NULL) {
+        entry->next->pprev = entry->pprev;
+    }
+    entry->next = NULL;
+    entry->pprev = NULL;
+}
+
+/**
+ * @brief Redistributes the current slot of a level into the levels below.
+ *
+ * Call with the scheduler suspended.
+ *
+ * @param level The level to cascade, at least 1.
+ * @return The slot index that was cascaded; zero means the level wrapped too.
+ */
+static uint32_t cascade(int level) {
+    uint32_t index = (wheelTime >> (TIMER_WHEEL_SLOT_BITS * level)) & WHEEL_MASK;
+    TimerWheelEntry *entry = wheel[level][index];
+
+    wheel[level][index] = NULL;
+    while (entry != NULL) {
+        TimerWheelEntry *next = entry->next;
+        wheelInsert(entry);
+        entry = next;
+    }
+    return index;
+}
+
+/**
+ * @brief Advances the wheel by one tick and runs the callbacks that expire.
+ */
+static void wheelStep(void) {
+    vTaskSuspendAll();
+    wheelTime++;
+    if ((wheelTime & WHEEL_MASK) == 0) {
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (cascade(level) != 0) {
+                break;
+            }
+        }
+    }
+    xTaskResumeAll();
+
+    TimerWheelEntry **head = &wheel[0][wheelTime & WHEEL_MASK];
+    while (1) {
+        vTaskSuspendAll();
+        TimerWheelEntry *entry = *head;
+        if (entry != NULL) {
+            wheelUnlink(entry);
+            pendingCount--;
+        }
+        xTaskResumeAll();
+        if (entry == NULL) {
+            break;
+        }
+        entry->callback(entry); // May reschedule the entry
+    }
+}
+
+/**
+ * @brief Initializes the wheel task.
+ */
+void initTimerWheel(void) {
+    if (xTaskCreate(timerWheelTask, "TimerWheel", TIMER_WHEEL_STACK_SIZE, NULL, TIMER_WHEEL_PRIORITY,
+                    &wheelTaskHandle) == pdPASS) {
+        logMessage("Timer wheel task created successfully\r\n");
+    } else {
+        logMessage("Failed to create timer wheel task\r\n");
+    }
+}
+
+/**
+ * @brief Prepares an entry for use.
+ *
+ * @param entry The entry.
+ * @param callback Called from the wheel task when the entry expires.
+ * @param context Caller data for the callback.
+ */
+void timerWheelEntryInit(TimerWheelEntry *entry, TimerWheelCallback callback, void *context) {
+    entry->next = NULL;
+    entry->pprev = NULL;
+    entry->expiry = 0;
+    entry->callback = callback;
+    entry->context = context;
+}
+
+/**
+ * @brief Schedules an entry, replacing any earlier schedule of it. O(1).
+ *
+ * @param entry The entry.
+ * @param delay Ticks until expiry; clamped to 1 .. 2^(TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS) - 1.
+ */
+void timerWheelSchedule(TimerWheelEntry *entry, TickType_t delay) {
+    bool wake;
+
+    if (delay == 0) {
+        delay = 1;
+    } else if (delay > WHEEL_MAX_DELAY) {
+        delay = WHEEL_MAX_DELAY;
+    }
+
+    vTaskSuspendAll();
+    if (entry->pprev != NULL) {
+        wheelUnlink(entry);
+        pendingCount--;
+    }
+    // Callbacks run while the wheel task is at the current tick; any other caller
+    // may find the wheel stopped at the tick it went idle
+    wake = (pendingCount == 0 && xTaskGetCurrentTaskHandle() != wheelTaskHandle);
+    if (wake) {
+        wheelTime = (uint32_t)xTaskGetTickCount();
+    }
+    entry->expiry = wheelTime + (uint32_t)delay;
+    wheelInsert(entry);
+    pendingCount++;
+    xTaskResumeAll();
+
+    if (wake && wheelTaskHandle != NULL) {
+        xTaskNotifyGive(wheelTaskHandle);
+    }
+}
+
+/**
+ * @brief Cancels an entry. O(1).
+ *
+ * @param entry The entry.
+ * @return True if the entry was scheduled.
+ */
+bool timerWheelCancel(TimerWheelEntry *entry) {
+    bool scheduled;
+
+    vTaskSuspendAll();
+    scheduled = (entry->pprev != NULL);
+    if (scheduled) {
+        wheelUnlink(entry);
+        pendingCount--;
+    }
+    xTaskResumeAll();
+    return scheduled;
+}
+
+/**
+ * @brief Checks whether an entry is scheduled.
+ *
+ * @param entry The entry.
+ * @return True if the entry will still fire.
+ */
+bool timerWheelIsScheduled(const TimerWheelEntry *entry) {
+    return entry->pprev != NULL;
+}
+
+/**
+ * @brief Gets the number of scheduled entries.
+ *
+ * @return The number of entries.
+ */
+uint32_t timerWheelPending(void) {
+    return pendingCount;
+}
+
+/**
+ * @brief Timer wheel task.
+ *
+ * Sleeps until the first entry is scheduled, then advances the wheel to the
+ * current tick once per tick, catching up on any ticks it missed.
+ *
+ * @param params Unused task parameters.
+ */
+void timerWheelTask(void *params) {
+    while (1) {
+        if (pendingCount == 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        vTaskDelay(1);
+        uint32_t now = (uint32_t)xTaskGetTickCount();
+        while ((int32_t)(now - wheelTime) > 0 && pendingCount > 0) {
+            wheelStep();
+        }
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ * timer_wheel.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Haim
+ */
+
+/// @file timer_wheel.h
+/// @brief Hierarchical timing wheel interface.
+
+#ifndef INC_TIMER_WHEEL_H_
+#define INC_TIMER_WHEEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "FreeRTOS.h"
+
+struct TimerWheelEntry;
+
+typedef void (*TimerWheelCallback)(struct TimerWheelEntry *entry);
+
+/**
+ * @brief One timeout, embedded in the caller's own record.
+ *
+ * The wheel keeps no storage of its own; an entry stays owned by the caller
+ * and must not be reused while it is scheduled.
+ */
+typedef struct TimerWheelEntry {
+    struct TimerWheelEntry *next;    /**< Next entry in the same slot */
+    struct TimerWheelEntry **pprev;  /**< Link pointing to this entry, NULL if not scheduled */
+    uint32_t expiry;                 /**< Wheel time at which the entry fires */
+    TimerWheelCallback callback;     /**< Called from the wheel task on expiry */
+    void *context;                   /**< Caller data for the callback */
+} TimerWheelEntry;
+
+void initTimerWheel(void);
+void timerWheelEntryInit(TimerWheelEntry *entry, TimerWheelCallback callback, void *context);
+void timerWheelSchedule(TimerWheelEntry *entry, TickType_t delay);
+bool timerWheelCancel(TimerWheelEntry *entry);
+bool timerWheelIsScheduled(const TimerWheelEntry *entry);
+uint32_t timerWheelPending(void);
+void timerWheelTask(void *params);
+
+#endif /* INC_TIMER_WHEEL_H_ */
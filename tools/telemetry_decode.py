@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""Decode the binary telemetry stream of the city simulation into CSV.
+
+The firmware sends each TelemetryFrame (telemetry.h) followed by a CRC-16/CCITT,
+COBS-encoded and wrapped in 0x00 delimiters, interleaved with normal text log
+output. This tool extracts the frames from a raw capture (file, stdin or a
+serial port), checks the CRC and writes one CSV row per frame. With
+--columnar DIR it also writes one file per field, one value per line.
+
+The number of departments is read from each frame, so the same tool decodes
+firmware built with any NUM_DEPARTMENTS; the columns follow the first frame.
+
+Usage:
+    telemetry_decode.py capture.bin -o telemetry.csv
+    telemetry_decode.py --serial /dev/ttyACM0 --baud 115200 -o telemetry.csv
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+
+HEADER_FORMAT = "<BBHIHBHHH"  # keep in sync with the fixed fields of TelemetryFrame
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+HEADER_FIELDS = ["version", "department_count", "sequence", "sim_time_ticks", "queue_depth", "cpu_percent",
+                 "latency_p50_ms", "latency_p95_ms", "latency_p99_ms"]
+DEPARTMENTS = ["police", "fire", "ambulance", "corona"]  # then dept4, dept5, ...
+TELEMETRY_VERSION = 2
+
+
+def frame_format(department_count):
+    """Format of a whole frame: the fixed fields, then the per-department arrays."""
+    return HEADER_FORMAT + "%dH%dB" % (department_count, department_count)
+
+
+def fields(department_count):
+    names = [DEPARTMENTS[i] if i < len(DEPARTMENTS) else "dept%d" % i for i in range(department_count)]
+    return HEADER_FIELDS + ["vehicles_" + d for d in names] + ["in_flight_" + d for d in names]
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def decode_frames(chunks):
+    """Yields decoded frame tuples from an iterable of byte chunks."""
+    buffer = bytearray()
+    for chunk in chunks:
+        buffer += chunk
+        while True:
+            end = buffer.find(b"\x00")
+            if end < 0:
+                break
+            segment = bytes(buffer[:end])
+            del buffer[:end + 1]
+            if not segment:
+                continue
+            raw = cobs_decode(segment)
+            if raw is None or len(raw) < HEADER_SIZE + 2 or raw[0] != TELEMETRY_VERSION:
+                continue  # text output, a damaged frame or another version
+            size = struct.calcsize(frame_format(raw[1]))
+            if len(raw) != size + 2:
+                continue
+            payload, crc = raw[:size], struct.unpack("<H", raw[size:])[0]
+            if crc16(payload) != crc:
+                continue
+            yield struct.unpack(frame_format(raw[1]), payload)
+
+
+def read_chunks(stream, size=4096):
+    while True:
+        data = stream.read(size)
+        if not data:
+            return
+        yield data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", help="raw capture file (default: stdin)")
+    parser.add_argument("--serial", help="read from this serial port instead (needs pyserial)")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("-o", "--output", help="CSV output file (default: stdout)")
+    parser.add_argument("--columnar", metavar="DIR", help="also write one file per field into DIR")
+    args = parser.parse_args()
+
+    if args.serial:
+        import serial  # pylint: disable=import-outside-toplevel
+        source = serial.Serial(args.serial, args.baud, timeout=1)
+        chunks = iter(lambda: source.read(4096) or b"", None)
+    elif args.input:
+        source = open(args.input, "rb")
+        chunks = read_chunks(source)
+    else:
+        chunks = read_chunks(sys.stdin.buffer)
+
+    output = open(args.output, "w", newline="") if args.output else sys.stdout
+    writer = csv.writer(output)
+
+    columns = None
+    if args.columnar:
+        os.makedirs(args.columnar, exist_ok=True)
+
+    count = 0
+    department_count = None
+    try:
+        for frame in decode_frames(chunks):
+            if department_count is None:
+                department_count = frame[1]
+                writer.writerow(fields(department_count))
+                if args.columnar:
+                    columns = [open(os.path.join(args.columnar, name + ".txt"), "w")
+                               for name in fields(department_count)]
+            elif frame[1] != department_count:
+                continue  # another build; its columns would not line up
+            writer.writerow(frame)
+            if columns:
+                for column, value in zip(columns, frame):
+                    column.write("%d\n" % value)
+            count += 1
+    except KeyboardInterrupt:
+        pass
+    finally:
+        output.flush()
+        for column in columns or []:
+            column.close()
+
+    print("%d frames decoded" % count, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
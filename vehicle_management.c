@@ -4,7 +4,24 @@
  *
  * This file implements functions to manage vehicle allocation, borrowing, and reallocation
  * among different departments such as Police, Fire, Ambulance, and Corona. It also includes
- * synchronization using FreeRTOS mutexes.
+ * synchronization using FreeRTOS mutexes. Every count is kept in arrays indexed by
+ * department, so the same code runs NUM_DEPARTMENTS departments.
+ *
+ * With VEHICLE_ALLOCATION_BATCHED, `allocateVehicles` combines the requests of
+ * every shard currently allocating: each caller publishes its request in a
+ * slot, and whichever caller gets the vehicle lock first decides all
+ * published requests in one critical section (flat combining). The decision
+ * is made for the batch as a whole: among the departments short of vehicles
+ * it serves the set with the most requests that the other departments' idle
+ * vehicles can cover, preferring the one that moves the fewest vehicles, and
+ * never takes vehicles another request of the batch needs. A department's
+ * requests are summed and granted together, and only once the policy has
+ * found every vehicle they lack. Only departments with a request in the
+ * batch can be short, so the sets tried are bounded by VEHICLE_BATCH_SLOTS,
+ * not by the number of departments. Which lenders give
+ * the vehicles is up to the active reallocation policy. Callers served by
+ * another's batch only take the lock to collect their result. Log output is
+ * written after the lock is released.
  *
  * @date Dec 29, 2024
  * @author Haim
@@ -14,28 +31,228 @@
 #include "project_defines.h"
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "task.h"
 #include "dispatcher.h"
 #include "logger.h"
+#include "profiler.h"
+#include "scenario.h"
+#include "reallocation_policy.h"
 
-// Static variables to hold the current vehicle counts for each department
-static int policeCount = POLICE_COUNT_INITIAL;      /**< Initial vehicle count for Police department */
-static int fireCount = FIRE_COUNT_INITIAL;          /**< Initial vehicle count for Fire department */
-static int ambulanceCount = AMBULANCE_COUNT_INITIAL;/**< Initial vehicle count for Ambulance department */
-static int coronaCount = CORONA_COUNT_INITIAL;      /**< Initial vehicle count for Corona department */
+static int vehicleCounts[NUM_DEPARTMENTS]; /**< Current vehicle count of each department */
 
 SemaphoreHandle_t vehicleMutex; /**< Mutex for synchronizing access to vehicle counts */
+static LockStats vehicleLockStats; /**< Acquisitions and hold times of vehicleMutex */
+static ReallocationHistory lendHistory; /**< Lenders so far, for the reallocation policies */
+
+static volatile bool reserveFloorsEnabled = RESERVE_FLOORS_ENABLED != 0; /**< Borrowing keeps the floors */
+static TickType_t lastLentAt[NUM_DEPARTMENTS]; /**< When each department last lent vehicles */
+static bool hasLent[NUM_DEPARTMENTS];          /**< Department has lent at least once */
+static TickType_t heldAt[NUM_DEPARTMENTS];     /**< When a floor last kept a department's vehicles */
+static int heldVehicles[NUM_DEPARTMENTS];      /**< Vehicles the floor kept then, 0 once accounted for */
+static uint32_t cascades = 0;            /**< Borrows by a department that had just lent */
+static uint32_t cascadesAvoided = 0;     /**< Own-fleet allocations only possible thanks to a floor */
+static uint32_t reserveHolds = 0;        /**< Times a floor kept a lender's last vehicles */
+static uint32_t reserveOverrides = 0;    /**< Borrows that took reserve vehicles */
+
+#if VEHICLE_ALLOCATION_BATCHED
+#define ALLOCATION_FREE 0      /**< Slot not in use */
+#define ALLOCATION_CLAIMED 1   /**< Slot owned by a caller, request not yet published */
+#define ALLOCATION_PENDING 2   /**< Request published, waiting for a combiner */
+#define ALLOCATION_GRANTED 3   /**< The department has the vehicles */
+#define ALLOCATION_DENIED 4    /**< Not enough idle vehicles this time */
+
+/**
+ * @brief One caller's request in the combining array.
+ */
+typedef struct {
+    volatile uint8_t state;    /**< ALLOCATION_FREE etc. */
+    uint8_t department;        /**< Requesting department */
+    uint8_t severity;          /**< IncidentSeverity, for the reserve floors */
+    int16_t required;          /**< Vehicles the incident needs */
+    int16_t available;         /**< Department's vehicles before the batch */
+    int16_t borrowed;          /**< Vehicles moved to the department for the batch */
+} AllocationSlot;
+
+/**
+ * @brief Vehicles moved by a batch, logged once the lock is released.
+ */
+typedef struct {
+    uint8_t from;
+    uint8_t to;
+    int16_t count;
+} VehicleMove;
+
+#if VEHICLE_BATCH_SLOTS > 12
+#error "Every set of the short departments of a batch is tried"
+#endif
+
+#define MAX_BATCH_MOVES 24     /**< Moves per batch; departments that could exceed it wait for the next batch */
+
+static AllocationSlot allocationSlots[VEHICLE_BATCH_SLOTS]; /**< Published requests */
+static uint32_t batchesDecided = 0;   /**< Critical sections that decided a batch */
+static uint32_t requestsDecided = 0;  /**< Requests decided in those batches */
+static uint32_t largestBatch = 0;     /**< Most requests decided in one batch */
+static uint32_t servedByOthers = 0;   /**< Requests decided in another caller's batch */
+static uint32_t requestsDenied = 0;   /**< Requests that had to retry */
+#endif
+
+/**
+ * @brief Takes the vehicle lock and counts the acquisition.
+ */
+static void lockVehicles(void) {
+    xSemaphoreTake(vehicleMutex, portMAX_DELAY);
+    lockStatsAcquired(&vehicleLockStats);
+}
+
+/**
+ * @brief Records the hold time and gives the vehicle lock back.
+ */
+static void unlockVehicles(void) {
+    lockStatsReleased(&vehicleLockStats);
+    xSemaphoreGive(vehicleMutex);
+}
+
+/**
+ * @brief Gets the vehicles a department can lend.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param count Its vehicles.
+ * @param keep Vehicles it keeps regardless of its floor.
+ * @param useReserve True if the borrower may take the reserve.
+ * @return Vehicles it can lend.
+ */
+static int lendableVehicles(uint8_t department, int count, int keep, bool useReserve) {
+    int floor = (reserveFloorsEnabled && !useReserve) ? scenarioDepartment(department)->reserve : 0;
+    int kept = (keep > floor) ? keep : floor;
+    return (count > kept) ? count - kept : 0;
+}
+
+/**
+ * @brief Plans a borrow with the active policy, keeping the lenders' floors.
+ *
+ * Call with the vehicle lock held. Also counts cascades, floors that held and
+ * overrides.
+ *
+ * @param department The department that needs vehicles.
+ * @param needed Vehicles it still needs.
+ * @param useReserve True if the incident may borrow reserve vehicles.
+ * @param counts Vehicles per department.
+ * @param keep Vehicles each department keeps regardless of its floor.
+ * @param take Receives the vehicles to take from each department.
+ * @return Vehicles still missing after the plan.
+ */
+static int planBorrow(uint8_t department, int needed, bool useReserve, const int counts[NUM_DEPARTMENTS],
+                      const int keep[NUM_DEPARTMENTS], int take[NUM_DEPARTMENTS]) {
+    static int lendable[NUM_DEPARTMENTS]; // Off the stack; only used under the vehicle lock
+    TickType_t now = xTaskGetTickCount();
+    bool borrowed = false;
+    bool overridden = false;
+
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+        lendable[d] = lendableVehicles(d, counts[d], keep[d], useReserve);
+    }
+    int missing = planReallocation(getActiveReallocationPolicy(), department, needed, lendable, &lendHistory, take);
+
+    taskENTER_CRITICAL();
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+        if (d == department) {
+            continue;
+        }
+        int routine = lendableVehicles(d, counts[d], keep[d], false);
+        int reserve = lendableVehicles(d, counts[d], keep[d], true) - routine;
+        if (take[d] > routine) {
+            overridden = true;
+        } else if (reserve > 0 && take[d] == routine && (take[d] > 0 || missing > 0)) {
+            // Without the floor the lender would have given these too
+            heldAt[d] = now;
+            heldVehicles[d] = reserve;
+            reserveHolds++;
+        }
+        if (take[d] > 0) {
+            borrowed = true;
+            lastLentAt[d] = now;
+            hasLent[d] = true;
+        }
+    }
+    if (borrowed && hasLent[department] && (now - lastLentAt[department]) < pdMS_TO_TICKS(RESERVE_CASCADE_WINDOW_MS)) {
+        cascades++;
+    }
+    reserveOverrides += overridden ? 1 : 0;
+    taskEXIT_CRITICAL();
+    return missing;
+}
+
+/**
+ * @brief Records an allocation, to count the cascades the floors avoided.
+ *
+ * An allocation counts as a cascade avoided when the department served it
+ * from its own vehicles shortly after a floor kept them, and would have had
+ * to borrow without those vehicles.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param requiredVehicles Vehicles the incident needed.
+ * @param availableVehicles The department's vehicles before any borrowing.
+ * @param borrowed True if the allocation borrowed vehicles.
+ */
+void reserveRecordAllocation(uint8_t department, int requiredVehicles, int availableVehicles, bool borrowed) {
+    if (department >= NUM_DEPARTMENTS) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    if (!borrowed && heldVehicles[department] > 0 &&
+        (xTaskGetTickCount() - heldAt[department]) < pdMS_TO_TICKS(RESERVE_CASCADE_WINDOW_MS)) {
+        if (availableVehicles - heldVehicles[department] < requiredVehicles) {
+            cascadesAvoided++;
+        }
+        heldVehicles[department] = 0;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Checks whether borrowing keeps the reserve floors.
+ *
+ * @return True if the floors are enforced.
+ */
+bool getReserveFloorsEnabled(void) {
+    return reserveFloorsEnabled;
+}
+
+/**
+ * @brief Enables or disables the reserve floors.
+ *
+ * @param enabled True to enforce the floors.
+ */
+void setReserveFloorsEnabled(bool enabled) {
+    reserveFloorsEnabled = enabled;
+}
+
+/**
+ * @brief Logs the reserve floor and cascade statistics.
+ */
+void reserveReport(void) {
+    logMessage("Reserve floors %s: %lu cascades, %lu avoided, %lu holds, %lu severity overrides\n",
+               reserveFloorsEnabled ? "on" : "off", (unsigned long)cascades, (unsigned long)cascadesAvoided,
+               (unsigned long)reserveHolds, (unsigned long)reserveOverrides);
+}
 
 /**
  * @brief Initializes the vehicle management system.
  *
- * This function creates a mutex to ensure thread-safe access to vehicle counts.
+ * This function creates a mutex to ensure thread-safe access to vehicle counts
+ * and sets the initial fleets from the active scenario.
  */
 void initVehicleManagement(void) {
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+        vehicleCounts[d] = scenarioDepartment(d)->fleet;
+    }
+
     vehicleMutex = xSemaphoreCreateMutex();
+    profilerRegisterLock("vehicleMutex", &vehicleLockStats);
     if (vehicleMutex != NULL) {
-        logMessage("Vehicle management system initialized successfully\r\n");
+        LOG_INFO(LOG_MODULE_VEHICLE, "Vehicle management system initialized successfully\r\n");
     } else {
-        logMessage("Failed to initialize vehicle management system\r\n");
+        LOG_ERROR(LOG_MODULE_VEHICLE, "Failed to initialize vehicle management system\r\n");
     }
 }
 
@@ -48,17 +265,19 @@ void initVehicleManagement(void) {
  * @param from Pointer to the vehicle count of the source department.
  * @param to Pointer to the vehicle count of the target department.
  * @param needed The number of vehicles needed by the target department.
- * @param fromDept Name of the source department (for logging purposes).
- * @param toDept Name of the target department (for logging purposes).
+ * @param fromDepartment Index of the source department (for logging purposes).
+ * @param toDepartment Index of the target department; borrows are aggregated per borrower.
  * @return The number of vehicles still needed after borrowing.
  */
-int borrowVehicles(int *from, int *to, int needed, const char *fromDept, const char *toDept) {
+int borrowVehicles(int *from, int *to, int needed, uint8_t fromDepartment, uint8_t toDepartment) {
     if (*from > 0 && needed > 0) { // Only borrow if needed
         int borrowed = (*from >= needed) ? needed : *from;
         *from -= borrowed;
         *to += borrowed;
         needed -= borrowed;
-        logMessage("Borrowed %d vehicles from %s to %s\r\n", borrowed, fromDept, toDept);
+        LOG_INFO_AGG(LOG_MODULE_VEHICLE, toDepartment, "Vehicles borrowed", borrowed,
+                     "Borrowed %d vehicles from %s to %s\r\n", borrowed, departmentName(fromDepartment),
+                     departmentName(toDepartment));
     }
     return needed;
 }
@@ -67,63 +286,60 @@ int borrowVehicles(int *from, int *to, int needed, const char *fromDept, const c
  * @brief Reallocates vehicles to fulfill a department's request.
  *
  * This function redistributes vehicles from other departments to the requesting department
- * to fulfill its required vehicles. It prioritizes borrowing from departments with available
- * vehicles.
+ * to fulfill its required vehicles. The active reallocation policy decides which departments
+ * lend and how many vehicles each gives. Lenders keep their reserve floor unless the request's
+ * severity is RESERVE_OVERRIDE_SEVERITY or above.
  *
  * @param request The dispatch request containing the department and required vehicles.
  */
 void reallocateVehicles(DispatchRequest request) {
-    const char *departmentNames[] = DEPARTMENT_NAMES;
-    xSemaphoreTake(vehicleMutex, portMAX_DELAY);
+    PROFILE_BEGIN(PROF_REALLOCATE);
+    lockVehicles();
 
     int needed = request.requiredVehicles; // Vehicles still needed
     if (needed <= 0) {
-        logMessage("No reallocation needed for department %s\r\n", departmentNames[request.department]);
-        xSemaphoreGive(vehicleMutex);
+        LOG_DEBUG(LOG_MODULE_VEHICLE, "No reallocation needed for department %s\r\n", departmentName(request.department));
+        unlockVehicles();
+        PROFILE_END(PROF_REALLOCATE);
         return;
     }
 
-    logMessage("Reallocating vehicles for department %s, need %d\r\n", departmentNames[request.department], needed);
+    LOG_INFO_AGG(LOG_MODULE_VEHICLE, request.department, "Reallocation", needed,
+                 "Reallocating vehicles for department %s, need %d\r\n", departmentName(request.department), needed);
 
-    switch (request.department) {
-        case POLICE:
-            needed = borrowVehicles(&fireCount, &policeCount, needed, "Fire", "Police");
-            needed = borrowVehicles(&ambulanceCount, &policeCount, needed, "Ambulance", "Police");
-            needed = borrowVehicles(&coronaCount, &policeCount, needed, "Corona", "Police");
-            break;
-
-        case FIRE:
-            needed = borrowVehicles(&policeCount, &fireCount, needed, "Police", "Fire");
-            needed = borrowVehicles(&ambulanceCount, &fireCount, needed, "Ambulance", "Fire");
-            needed = borrowVehicles(&coronaCount, &fireCount, needed, "Corona", "Fire");
-            break;
-
-        case AMBULANCE:
-            needed = borrowVehicles(&policeCount, &ambulanceCount, needed, "Police", "Ambulance");
-            needed = borrowVehicles(&fireCount, &ambulanceCount, needed, "Fire", "Ambulance");
-            needed = borrowVehicles(&coronaCount, &ambulanceCount, needed, "Corona", "Ambulance");
-            break;
-
-        case CORONA:
-            needed = borrowVehicles(&policeCount, &coronaCount, needed, "Police", "Corona");
-            needed = borrowVehicles(&fireCount, &coronaCount, needed, "Fire", "Corona");
-            needed = borrowVehicles(&ambulanceCount, &coronaCount, needed, "Ambulance", "Corona");
-            break;
-
-        default:
-            logMessage("Invalid department for reallocation\r\n");
-            break;
+    if (request.department < NUM_DEPARTMENTS) {
+        static int counts[NUM_DEPARTMENTS]; // Off the stack; only used under the vehicle lock
+        static int keep[NUM_DEPARTMENTS];
+        static int take[NUM_DEPARTMENTS];
+        for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+            counts[d] = vehicleCounts[d];
+            keep[d] = getCommittedVehicles(d); // Lenders keep the vehicles of their incidents in progress
+        }
+        // The active policy picks the donors; see reallocation_policy.c
+        needed = planBorrow(request.department, needed, request.severity >= RESERVE_OVERRIDE_SEVERITY, counts,
+                            keep, take);
+        for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+            if (take[d] > 0) {
+                (void)borrowVehicles(&vehicleCounts[d], &vehicleCounts[request.department], take[d], d,
+                                     request.department);
+            }
+        }
+    } else {
+        LOG_ERROR(LOG_MODULE_VEHICLE, "Invalid department for reallocation\r\n");
     }
 
     if (needed > 0) {
-        logMessage("Warning: Still need %d vehicles for department %s\r\n", needed, departmentNames[request.department]);
+        LOG_WARN(LOG_MODULE_VEHICLE, "Warning: Still need %d vehicles for department %s\r\n", needed, departmentName(request.department));
     }
 
-    // Log updated vehicle counts after reallocation
-    logMessage("After reallocation - Police:%d | Fire:%d | Ambulance:%d | Corona:%d\r\n",
-               policeCount, fireCount, ambulanceCount, coronaCount);
+    // Log the updated vehicle count after reallocation
+    if (request.department < NUM_DEPARTMENTS) {
+        LOG_DEBUG(LOG_MODULE_VEHICLE, "After reallocation - %s:%d\r\n", departmentName(request.department),
+                  vehicleCounts[request.department]);
+    }
 
-    xSemaphoreGive(vehicleMutex);
+    unlockVehicles();
+    PROFILE_END(PROF_REALLOCATE);
 }
 
 /**
@@ -135,27 +351,325 @@ void reallocateVehicles(DispatchRequest request) {
  * @return The current number of vehicles available in the department.
  */
 int getVehicleCount(uint8_t department) {
-    xSemaphoreTake(vehicleMutex, portMAX_DELAY);
+    PROFILE_BEGIN(PROF_GET_VEHICLE_COUNT);
     int count = 0;
 
-    switch (department) {
-        case POLICE:
-            count = policeCount;
-            break;
-        case FIRE:
-            count = fireCount;
-            break;
-        case AMBULANCE:
-            count = ambulanceCount;
-            break;
-        case CORONA:
-            count = coronaCount;
-            break;
-        default:
-            logMessage("Invalid department index for vehicle count\r\n");
-            break;
+    if (department < NUM_DEPARTMENTS) {
+        lockVehicles();
+        count = vehicleCounts[department];
+        unlockVehicles();
+    } else {
+        LOG_ERROR(LOG_MODULE_VEHICLE, "Invalid department index for vehicle count\r\n");
     }
 
-    xSemaphoreGive(vehicleMutex);
+    PROFILE_END(PROF_GET_VEHICLE_COUNT);
     return count;
 }
+
+/**
+ * @brief Gets the vehicle counts of all departments in one consistent read.
+ *
+ * @param counts Output array indexed by department (POLICE, FIRE, etc.).
+ */
+void getVehicleCounts(int counts[NUM_DEPARTMENTS]) {
+    lockVehicles();
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+        counts[d] = vehicleCounts[d];
+    }
+    unlockVehicles();
+}
+
+/**
+ * @brief Overwrites the vehicle counts of all departments.
+ *
+ * Used to restore a checkpoint before the simulation starts.
+ *
+ * @param counts Array indexed by department (POLICE, FIRE, etc.).
+ */
+void setVehicleCounts(const int counts[NUM_DEPARTMENTS]) {
+    lockVehicles();
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+        vehicleCounts[d] = counts[d];
+    }
+    unlockVehicles();
+}
+
+/**
+ * @brief Moves idle vehicles from one department to another ahead of demand.
+ *
+ * Vehicles needed by the incidents the source department is currently handling
+ * are not idle and stay where they are, and so does its reserve floor.
+ *
+ * @param from The source department index.
+ * @param to The target department index.
+ * @param count The number of vehicles to move.
+ * @return The number of vehicles actually moved.
+ */
+int moveIdleVehicles(uint8_t from, uint8_t to, int count) {
+    if (from >= NUM_DEPARTMENTS || to >= NUM_DEPARTMENTS || from == to || count <= 0) {
+        return 0;
+    }
+
+    lockVehicles();
+    // The shard marks its incident in progress before reading the count, so either it
+    // is seen here or the shard sees the count after the move
+    int idle = lendableVehicles(from, vehicleCounts[from], getCommittedVehicles(from), false);
+    int moved = (idle < count) ? idle : count;
+    if (moved > 0) {
+        vehicleCounts[from] -= moved;
+        vehicleCounts[to] += moved;
+    } else {
+        moved = 0;
+    }
+    unlockVehicles();
+
+    if (moved > 0) {
+        LOG_INFO_AGG(LOG_MODULE_VEHICLE, to, "Vehicles prepositioned", moved,
+                     "Moved %d idle vehicles from %s to %s\r\n", moved, departmentName(from), departmentName(to));
+    }
+    return moved;
+}
+
+#if VEHICLE_ALLOCATION_BATCHED
+/**
+ * @brief Decides every published request in one go and moves the vehicles.
+ *
+ * Call with the vehicle lock held.
+ *
+ * @param moves Receives the moves made.
+ * @return Number of moves.
+ */
+static int decideBatch(VehicleMove moves[MAX_BATCH_MOVES]) {
+    // Off the stack; only used under the vehicle lock
+    static int requests[NUM_DEPARTMENTS];  // Published requests per department
+    static int need[NUM_DEPARTMENTS];      // Vehicles of all published requests per department
+    static bool urgent[NUM_DEPARTMENTS];   // Department has a request that may use reserves
+    static bool served[NUM_DEPARTMENTS];   // Department is in the set served
+    static int available[NUM_DEPARTMENTS]; // Vehicles per department before the batch, less busy ones
+    static int counts[NUM_DEPARTMENTS];
+    static int keep[NUM_DEPARTMENTS];
+    static int deficit[NUM_DEPARTMENTS];
+    static int take[NUM_DEPARTMENTS];
+    uint8_t shortDepartments[VEHICLE_BATCH_SLOTS]; // Departments of the batch short of vehicles
+    int shortCount = 0;
+    int batchSize = 0;
+    int moveCount = 0;
+
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+        requests[d] = 0;
+        need[d] = 0;
+        urgent[d] = false;
+        served[d] = false;
+    }
+    taskENTER_CRITICAL();
+    for (int i = 0; i < VEHICLE_BATCH_SLOTS; i++) {
+        const AllocationSlot *slot = &allocationSlots[i];
+        if (slot->state == ALLOCATION_PENDING) {
+            requests[slot->department]++;
+            need[slot->department] += slot->required; // Every request of the department is served at once
+            urgent[slot->department] |= slot->severity >= RESERVE_OVERRIDE_SEVERITY;
+            batchSize++;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    // Lenders with floors, and lenders when every floor is ignored
+    int totalRoutine = 0;
+    int totalUrgent = 0;
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+        // The published requests are in progress already; the department's other incidents keep their vehicles
+        int busy = getBusyVehicles(d, need[d]);
+        counts[d] = vehicleCounts[d];
+        available[d] = (counts[d] > busy) ? counts[d] - busy : 0;
+        deficit[d] = (need[d] > available[d]) ? need[d] - available[d] : 0;
+        if (deficit[d] > 0) {
+            shortDepartments[shortCount++] = d; // At most one per slot
+        }
+        // A lender keeps what its own requests and its incidents in progress need
+        keep[d] = busy + need[d];
+        totalRoutine += lendableVehicles(d, counts[d], keep[d], false);
+        totalUrgent += lendableVehicles(d, counts[d], keep[d], true);
+    }
+
+    // Few short departments, so every set of them can be tried
+    uint32_t bestSet = 0;
+    int bestServed = -1;
+    int bestMoved = 0;
+    for (uint32_t set = 0; set < (1UL << shortCount); set++) {
+        int servedRequests = 0;
+        int moved = 0;
+        int movedRoutine = 0;
+        for (int i = 0; i < shortCount; i++) {
+            if (set & (1UL << i)) {
+                uint8_t d = shortDepartments[i];
+                servedRequests += requests[d];
+                moved += deficit[d];
+                movedRoutine += urgent[d] ? 0 : deficit[d];
+            }
+        }
+        if (movedRoutine <= totalRoutine && moved <= totalUrgent &&
+            (servedRequests > bestServed || (servedRequests == bestServed && moved < bestMoved))) {
+            bestSet = set;
+            bestServed = servedRequests;
+            bestMoved = moved;
+        }
+    }
+    for (int i = 0; i < shortCount; i++) {
+        served[shortDepartments[i]] = (bestSet & (1UL << i)) != 0;
+    }
+
+    // Routine departments first, so the urgent ones get the reserves on top of what is left
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < shortCount; i++) {
+            uint8_t d = shortDepartments[i];
+            if (!served[d] || urgent[d] != (pass == 1)) {
+                continue;
+            }
+            // Every lender gives at least one vehicle, so this bounds the moves of the plan
+            int maxLenders = (deficit[d] < NUM_DEPARTMENTS - 1) ? deficit[d] : NUM_DEPARTMENTS - 1;
+            if (moveCount + maxLenders > MAX_BATCH_MOVES) {
+                served[d] = false; // Retries in the next batch
+                continue;
+            }
+            for (uint8_t l = 0; l < NUM_DEPARTMENTS; l++) {
+                counts[l] = vehicleCounts[l];
+            }
+            // The set only compared totals; a policy can still fall short, e.g. of vehicles another request keeps
+            int missing = planBorrow(d, deficit[d], urgent[d], counts, keep, take);
+            for (uint8_t lender = 0; lender < NUM_DEPARTMENTS; lender++) {
+                if (take[lender] <= 0) {
+                    continue;
+                }
+                vehicleCounts[lender] -= take[lender];
+                vehicleCounts[d] += take[lender];
+                moves[moveCount++] = (VehicleMove){.from = lender, .to = d, .count = (int16_t)take[lender]};
+            }
+            if (missing > 0) {
+                // The vehicles moved stay with the department and count towards its retry
+                served[d] = false;
+            }
+        }
+    }
+
+    taskENTER_CRITICAL();
+    for (int i = 0; i < VEHICLE_BATCH_SLOTS; i++) {
+        AllocationSlot *slot = &allocationSlots[i];
+        if (slot->state != ALLOCATION_PENDING) {
+            continue;
+        }
+        uint8_t d = slot->department;
+        bool granted = deficit[d] == 0 || served[d];
+        slot->available = (int16_t)available[d];
+        slot->borrowed = (int16_t)(granted ? deficit[d] : 0);
+        slot->state = granted ? ALLOCATION_GRANTED : ALLOCATION_DENIED;
+        if (granted) {
+            deficit[d] = 0; // The borrow is reported once, by the department's first request
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    batchesDecided++;
+    requestsDecided += (uint32_t)batchSize;
+    if ((uint32_t)batchSize > largestBatch) {
+        largestBatch = (uint32_t)batchSize;
+    }
+    return moveCount;
+}
+
+/**
+ * @brief Allocates vehicles for one incident, batched with the other callers.
+ *
+ * Publishes the request, then takes the vehicle lock; if no other caller has
+ * decided the request meanwhile, decides the whole published batch.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param requiredVehicles Vehicles the incident needs.
+ * @param severity IncidentSeverity; RESERVE_OVERRIDE_SEVERITY and above may use reserve vehicles.
+ * @param available Receives the department's vehicles before the batch.
+ * @param borrowed Receives the vehicles moved to the department for it.
+ * @return True if the department has the vehicles; false to retry later.
+ */
+bool allocateVehicles(uint8_t department, int requiredVehicles, uint8_t severity, int *available, int *borrowed) {
+    AllocationSlot *slot = NULL;
+    VehicleMove moves[MAX_BATCH_MOVES];
+    int moveCount = 0;
+
+    if (department >= NUM_DEPARTMENTS) {
+        return false;
+    }
+    while (slot == NULL) {
+        taskENTER_CRITICAL();
+        for (int i = 0; i < VEHICLE_BATCH_SLOTS && slot == NULL; i++) {
+            if (allocationSlots[i].state == ALLOCATION_FREE) {
+                slot = &allocationSlots[i];
+                slot->state = ALLOCATION_CLAIMED;
+            }
+        }
+        taskEXIT_CRITICAL();
+        if (slot == NULL) {
+            taskYIELD(); // More callers than slots
+        }
+    }
+    slot->department = department;
+    slot->required = (int16_t)requiredVehicles;
+    slot->severity = severity;
+    slot->state = ALLOCATION_PENDING; // Visible to combiners from here on
+
+    lockVehicles();
+    if (slot->state == ALLOCATION_PENDING) {
+        moveCount = decideBatch(moves);
+    } else {
+        servedByOthers++;
+    }
+    bool granted = slot->state == ALLOCATION_GRANTED;
+    requestsDenied += granted ? 0 : 1;
+    *available = slot->available;
+    *borrowed = slot->borrowed;
+    slot->state = ALLOCATION_FREE;
+    unlockVehicles();
+
+    for (int i = 0; i < moveCount; i++) {
+        LOG_INFO_AGG(LOG_MODULE_VEHICLE, moves[i].to, "Vehicles borrowed", moves[i].count,
+                     "Borrowed %d vehicles from %s to %s\r\n", moves[i].count, departmentName(moves[i].from),
+                     departmentName(moves[i].to));
+    }
+    return granted;
+}
+
+/**
+ * @brief Gets how many vehicles an allocation lacks even after borrowing every idle one.
+ *
+ * The department's own incidents in progress keep their vehicles, lenders keep
+ * those of theirs, and their floors unless the severity may use reserves. Requests other shards are allocating
+ * at the same time are not taken into account.
+ *
+ * @param department The department index (POLICE, FIRE, etc.).
+ * @param requiredVehicles Vehicles the incident needs.
+ * @param severity The incident's IncidentSeverity.
+ * @return The missing vehicles, 0 if the fleet can cover the incident.
+ */
+int getAllocationShortfall(uint8_t department, int requiredVehicles, uint8_t severity) {
+    if (department >= NUM_DEPARTMENTS) {
+        return 0;
+    }
+    lockVehicles();
+    int missing = requiredVehicles - (vehicleCounts[department] - getBusyVehicles(department, requiredVehicles));
+    for (uint8_t d = 0; d < NUM_DEPARTMENTS; d++) {
+        if (d != department) {
+            missing -= lendableVehicles(d, vehicleCounts[d], getCommittedVehicles(d),
+                                        severity >= RESERVE_OVERRIDE_SEVERITY);
+        }
+    }
+    unlockVehicles();
+    return (missing > 0) ? missing : 0;
+}
+
+/**
+ * @brief Logs how the batched allocator combined requests.
+ */
+void vehicleAllocationReport(void) {
+    logMessage("Batched allocation: %lu batches, %lu requests (largest %lu), %lu decided by another caller, "
+               "%lu retried\n", (unsigned long)batchesDecided, (unsigned long)requestsDecided,
+               (unsigned long)largestBatch, (unsigned long)servedByOthers, (unsigned long)requestsDenied);
+}
+#endif
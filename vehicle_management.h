@@ -15,7 +15,15 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "dispatcher.h"
+#include "project_defines.h"
 
+#if NUM_DEPARTMENTS < 4
+#error "Police, Fire, Ambulance and Corona always exist"
+#endif
+
+/**
+ * @brief The first four departments; any further ones up to NUM_DEPARTMENTS are numbered on.
+ */
 enum {
     POLICE = 0,
     FIRE,
@@ -24,8 +32,20 @@ enum {
 };
 
 void initVehicleManagement(void);
-int borrowVehicles(int *from, int *to, int needed, const char *fromDept, const char *toDept);
+int borrowVehicles(int *from, int *to, int needed, uint8_t fromDepartment, uint8_t toDepartment);
 void reallocateVehicles(DispatchRequest request);
 int getVehicleCount(uint8_t department);
+void getVehicleCounts(int counts[NUM_DEPARTMENTS]);
+void setVehicleCounts(const int counts[NUM_DEPARTMENTS]);
+int moveIdleVehicles(uint8_t from, uint8_t to, int count);
+void reserveRecordAllocation(uint8_t department, int requiredVehicles, int availableVehicles, bool borrowed);
+bool getReserveFloorsEnabled(void);
+void setReserveFloorsEnabled(bool enabled);
+void reserveReport(void);
+#if VEHICLE_ALLOCATION_BATCHED
+bool allocateVehicles(uint8_t department, int requiredVehicles, uint8_t severity, int *available, int *borrowed);
+int getAllocationShortfall(uint8_t department, int requiredVehicles, uint8_t severity);
+void vehicleAllocationReport(void);
+#endif
 
 #endif /* INC_VEHICLE_MANAGEMENT_H_ */